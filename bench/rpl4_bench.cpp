@@ -0,0 +1,838 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rpl4/peripheral/aux_spi.hpp"
+#include "rpl4/peripheral/dma.hpp"
+#include "rpl4/peripheral/dma4.hpp"
+#include "rpl4/peripheral/dma_copy.hpp"
+#include "rpl4/peripheral/dma_plan.hpp"
+#include "rpl4/peripheral/gpio.hpp"
+#include "rpl4/peripheral/pwm.hpp"
+#include "rpl4/peripheral/pwm_audio.hpp"
+#include "rpl4/peripheral/spi.hpp"
+#include "rpl4/peripheral/ws2812.hpp"
+#include "rpl4/rpl4.hpp"
+#include "rpl4/system/dma_memory.hpp"
+#include "rpl4/system/metrics.hpp"
+
+// Benchmarks of the driver hot paths. The results are written as JSON in the
+// layout of Google Benchmark (--benchmark_format=json), so the same tools can
+// be used to compare two runs.
+//
+// With real registers (on a Raspberry Pi, as root) the peripherals are driven
+// and the numbers include the bus and the SPI clock. With memory-backed
+// registers the status bits are set so that every peripheral looks idle and
+// ready, which makes the numbers the cost of the driver code alone.
+
+namespace {
+
+constexpr uint32_t kTransferSizes[] = {1, 16, 256, 4096};
+
+enum class RegisterMode { kAuto, kDevice, kMemory };
+
+struct Options {
+  RegisterMode mode = RegisterMode::kAuto;
+  const char* output = nullptr;
+  const char* filter = nullptr;
+  double min_time_ms = 200.0;
+  uint8_t gpio_pin = 26;
+  bool metrics = false;
+};
+
+struct Result {
+  std::string name;
+  uint64_t iterations = 0;
+  double ns_per_op = 0.0;
+  uint64_t bytes_per_op = 0;
+  std::string error;
+};
+
+class Runner {
+ public:
+  explicit Runner(const Options& options) : options_(options) {}
+
+  /**
+   * @brief Measure body, which has to run the operation iterations times.
+   * @details The iteration count is increased until one run takes at least
+   *          the minimum time, so the loop and clock overhead is negligible.
+   */
+  void Run(const std::string& name, uint64_t bytes_per_op,
+           const std::function<void(uint64_t)>& body) {
+    if (!IsSelected(name)) { return; }
+    const double min_time_ns = options_.min_time_ms * 1e6;
+    uint64_t iterations = 1;
+    double elapsed_ns = 0.0;
+    while (true) {
+      auto start = std::chrono::steady_clock::now();
+      body(iterations);
+      std::chrono::duration<double, std::nano> elapsed =
+          std::chrono::steady_clock::now() - start;
+      elapsed_ns = elapsed.count();
+      if (elapsed_ns >= min_time_ns || iterations >= kMaxIterations) { break; }
+      // Aim a little above the minimum time, growing at most tenfold.
+      double scale = elapsed_ns > 0.0 ? min_time_ns * 1.2 / elapsed_ns : 10.0;
+      if (scale > 10.0) { scale = 10.0; }
+      if (scale < 2.0) { scale = 2.0; }
+      iterations = static_cast<uint64_t>(iterations * scale);
+    }
+
+    Result result;
+    result.name = name;
+    result.iterations = iterations;
+    result.ns_per_op = elapsed_ns / iterations;
+    result.bytes_per_op = bytes_per_op;
+    std::fprintf(stderr, "%-48s %12.1f ns %12" PRIu64 " iterations\n",
+                 name.c_str(), result.ns_per_op, iterations);
+    results_.push_back(result);
+  }
+
+  void Skip(const std::string& name, const std::string& reason) {
+    if (!IsSelected(name)) { return; }
+    Result result;
+    result.name = name;
+    result.error = reason;
+    std::fprintf(stderr, "%-48s skipped: %s\n", name.c_str(), reason.c_str());
+    results_.push_back(result);
+  }
+
+  void WriteJson(FILE* stream, const char* registers) const {
+    char date[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S",
+                  std::localtime(&now));
+
+    std::fprintf(stream, "{\n  \"context\": {\n");
+    std::fprintf(stream, "    \"date\": \"%s\",\n", date);
+    std::fprintf(stream, "    \"executable\": \"rpl4_bench\",\n");
+    std::fprintf(stream, "    \"registers\": \"%s\",\n", registers);
+    std::fprintf(stream, "    \"log_level\": \"%s\",\n", GetLogLevelName());
+#ifdef RPL4_TRACE
+    std::fprintf(stream, "    \"trace\": true,\n");
+#else
+    std::fprintf(stream, "    \"trace\": false,\n");
+#endif
+#ifdef __OPTIMIZE__
+    std::fprintf(stream, "    \"optimized\": true,\n");
+#else
+    std::fprintf(stream, "    \"optimized\": false,\n");
+#endif
+    std::fprintf(stream, "    \"min_time_ms\": %.1f\n", options_.min_time_ms);
+    std::fprintf(stream, "  },\n  \"benchmarks\": [");
+    for (size_t i = 0; i < results_.size(); ++i) {
+      const Result& r = results_[i];
+      std::fprintf(stream, "%s\n    {\n", i == 0 ? "" : ",");
+      std::fprintf(stream, "      \"name\": \"%s\",\n", r.name.c_str());
+      std::fprintf(stream, "      \"run_name\": \"%s\",\n", r.name.c_str());
+      std::fprintf(stream, "      \"run_type\": \"iteration\",\n");
+      if (!r.error.empty()) {
+        std::fprintf(stream, "      \"error_occurred\": true,\n");
+        std::fprintf(stream, "      \"error_message\": \"%s\"\n    }",
+                     r.error.c_str());
+        continue;
+      }
+      std::fprintf(stream, "      \"iterations\": %" PRIu64 ",\n",
+                   r.iterations);
+      std::fprintf(stream, "      \"real_time\": %.3f,\n", r.ns_per_op);
+      std::fprintf(stream, "      \"cpu_time\": %.3f,\n", r.ns_per_op);
+      if (r.bytes_per_op > 0) {
+        std::fprintf(stream, "      \"bytes_per_second\": %.1f,\n",
+                     r.bytes_per_op * 1e9 / r.ns_per_op);
+      }
+      std::fprintf(stream, "      \"time_unit\": \"ns\"\n    }");
+    }
+    std::fprintf(stream, "\n  ]\n}\n");
+  }
+
+ private:
+  static constexpr uint64_t kMaxIterations = 1000000000;
+
+  bool IsSelected(const std::string& name) const {
+    return options_.filter == nullptr ||
+           name.find(options_.filter) != std::string::npos;
+  }
+
+  static const char* GetLogLevelName() {
+#ifdef RPL4_LOG_LEVEL
+    using rpl::LogLevel;
+    switch (RPL4_LOG_LEVEL) {
+      case LogLevel::Fatal:
+        return "FATAL";
+      case LogLevel::Error:
+        return "ERROR";
+      case LogLevel::Warning:
+        return "WARNING";
+      case LogLevel::Info:
+        return "INFO";
+      case LogLevel::Debug:
+        return "DEBUG";
+    }
+#endif
+    return "OFF";
+  }
+
+  const Options& options_;
+  std::vector<Result> results_;
+};
+
+// Makes the memory-backed peripherals look idle and always ready, so that the
+// busy-wait loops of the drivers end at the first check.
+void PresetMemoryBackedStatus() {
+  using CS = rpl::SpiRegisterMap::CS;
+  rpl::REG_SPI0->cs.txd = CS::TXD::kWritable;
+  rpl::REG_SPI0->cs.rxd = CS::RXD::kContains;
+  rpl::REG_SPI0->cs.done = CS::DONE::kCompleted;
+
+  // Idle, TX FIFO not full and RX FIFO not empty are all 0. The RX FIFO
+  // level is kept at the FIFO depth.
+  rpl::REG_SPI1->stat.rx_fifo_level = 4;
+
+  // The PWM FIFO is always empty, so it takes a whole burst.
+  rpl::REG_PWM0->sta.empt1 = rpl::PwmRegisterMap::STA::EMPT::kEmpty;
+}
+
+// Runs func with the standard output, where Log() prints, sent to /dev/null.
+void WithoutStdout(const std::function<void()>& func) {
+  std::cout.flush();
+  std::fflush(stdout);
+  int saved = dup(STDOUT_FILENO);
+  int null = open("/dev/null", O_WRONLY);
+  dup2(null, STDOUT_FILENO);
+  close(null);
+  func();
+  std::cout.flush();
+  std::fflush(stdout);
+  dup2(saved, STDOUT_FILENO);
+  close(saved);
+}
+
+void BenchGpio(Runner& runner, uint8_t pin) {
+  rpl::Gpio* gpio = rpl::Gpio::GetInstance(pin);
+  gpio->SetAltFunction(rpl::Gpio::AltFunction::kOutput);
+  runner.Run("gpio/write_toggle", 0, [gpio](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) { gpio->Write(i & 1); }
+  });
+  runner.Run("gpio/read", 0, [gpio](uint64_t iterations) {
+    volatile bool sink;
+    for (uint64_t i = 0; i < iterations; ++i) { sink = gpio->Read(); }
+    (void)sink;
+  });
+}
+
+void BenchSpiBase(Runner& runner, const std::string& prefix,
+                  rpl::SpiBase& spi) {
+  for (uint32_t size : kTransferSizes) {
+    std::vector<uint8_t> tx_buf(size, 0xa5);
+    std::vector<uint8_t> rx_buf(size);
+    std::string suffix = "/" + std::to_string(size);
+    runner.Run(prefix + "/transmit_and_receive" + suffix, size,
+               [&](uint64_t iterations) {
+                 for (uint64_t i = 0; i < iterations; ++i) {
+                   spi.TransmitAndReceiveBlocking(tx_buf.data(),
+                                                  rx_buf.data(), size);
+                 }
+               });
+    runner.Run(prefix + "/transmit" + suffix, size, [&](uint64_t iterations) {
+      for (uint64_t i = 0; i < iterations; ++i) {
+        spi.TransmitBlocking(tx_buf.data(), size);
+      }
+    });
+    runner.Run(prefix + "/receive" + suffix, size, [&](uint64_t iterations) {
+      for (uint64_t i = 0; i < iterations; ++i) {
+        spi.ReceiveBlocking(rx_buf.data(), size, 0xff);
+      }
+    });
+  }
+}
+
+void BenchSpi(Runner& runner) {
+  rpl::Spi* spi = rpl::Spi::GetInstance(rpl::Spi::Port::kSpi0);
+  spi->SetClockDivider(16);
+  spi->SetChipSelectForCommunication(rpl::Spi::ChipSelect::kChipSelect0);
+  BenchSpiBase(runner, "spi0", *spi);
+  for (uint32_t size : kTransferSizes) {
+    std::vector<uint8_t> tx_buf(size, 0xa5);
+    std::vector<uint8_t> rx_buf(size);
+    runner.Run("spi0/transmit_and_receive_packed/" + std::to_string(size),
+               size, [&](uint64_t iterations) {
+                 for (uint64_t i = 0; i < iterations; ++i) {
+                   spi->TransmitAndReceivePackedBlocking(tx_buf.data(),
+                                                         rx_buf.data(), size);
+                 }
+               });
+  }
+}
+
+void BenchAuxSpi(Runner& runner) {
+  rpl::AuxSpi* aux_spi = rpl::AuxSpi::GetInstance(rpl::AuxSpi::Port::kAuxSpi1);
+  aux_spi->Enable();
+  aux_spi->SetClockDivider(8);
+  aux_spi->SetBitLength(8);
+  aux_spi->SetChipSelectForCommunication(
+      rpl::AuxSpi::ChipSelect::kChipSelect0);
+  BenchSpiBase(runner, "aux_spi1", *aux_spi);
+}
+
+// Control blocks are built in normal memory here; see BenchDmaMemory() for
+// the uncached DMA memory they are normally built in.
+void BenchPwm(Runner& runner) {
+  // Duty updates of a motor control loop on a 20 kHz carrier.
+  using Channel = rpl::Pwm::Channel;
+  rpl::Pwm* pwm = rpl::Pwm::GetInstance(rpl::Pwm::Port::kPwm0);
+  pwm->SetFrequency(Channel::kChannel1, 20000.0);
+  runner.Run("pwm0/set_duty_cycle", 0, [pwm](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      pwm->SetDutyCycle(Channel::kChannel1, (i & 0xff) / 256.0);
+    }
+  });
+  runner.Run("pwm0/set_duty_cycle_q16", 0, [pwm](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      pwm->SetDutyCycleQ16(Channel::kChannel1,
+                           static_cast<uint32_t>(i & 0xffff));
+    }
+  });
+  runner.Run("pwm0/set_frequency_and_duty", 0, [pwm](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      pwm->SetFrequencyAndDuty(Channel::kChannel1, 20000.0,
+                               (i & 0xff) / 256.0);
+    }
+  });
+
+  // CPU-fed FIFO stream. Words that do not fit are dropped, so that a FIFO
+  // that is not drained does not stall the run.
+  constexpr size_t kNumOfWords = 256;
+  std::vector<uint32_t> words(kNumOfWords, 0x0f0f0f0f);
+  pwm->ClearFifo();
+  runner.Run("pwm0/write_fifo/polled/256", kNumOfWords * sizeof(uint32_t),
+             [&](uint64_t iterations) {
+               for (uint64_t i = 0; i < iterations; ++i) {
+                 for (uint32_t word : words) {
+                   if (!pwm->IsFifoFull()) { pwm->WriteFifo(word); }
+                 }
+               }
+             });
+  runner.Run("pwm0/write_fifo/batch/256", kNumOfWords * sizeof(uint32_t),
+             [&](uint64_t iterations) {
+               for (uint64_t i = 0; i < iterations; ++i) {
+                 pwm->WriteFifo(words.data(), kNumOfWords);
+               }
+             });
+}
+
+void BenchControlBlock(Runner& runner) {
+  alignas(32) static uint8_t storage[sizeof(rpl::DmaControlBlock)];
+  rpl::DmaControlBlock* control_block =
+      reinterpret_cast<rpl::DmaControlBlock*>(storage);
+  runner.Run("dma/configure_memory_to_memory", 0,
+             [control_block](uint64_t iterations) {
+               for (uint64_t i = 0; i < iterations; ++i) {
+                 rpl::Dma::ConfigureMemoryToMemory(control_block, 0x1000,
+                                                   0x2000, 4096);
+               }
+             });
+  runner.Run("dma/configure_memory_to_peripheral", 0,
+             [control_block](uint64_t iterations) {
+               for (uint64_t i = 0; i < iterations; ++i) {
+                 rpl::Dma::ConfigureMemoryToPeripheral(
+                     control_block, 0x1000, 0x7e20c018, 4096,
+                     rpl::DmaRegisterMap::TI::PERMAP::kPwm0);
+               }
+             });
+
+  alignas(32) static uint8_t storage4[sizeof(rpl::Dma4ControlBlock)];
+  rpl::Dma4ControlBlock* control_block4 =
+      reinterpret_cast<rpl::Dma4ControlBlock*>(storage4);
+  runner.Run("dma4/configure_memory_to_memory", 0,
+             [control_block4](uint64_t iterations) {
+               for (uint64_t i = 0; i < iterations; ++i) {
+                 rpl::Dma4::ConfigureMemoryToMemory(control_block4, 0x1000,
+                                                    0x2000, 4096);
+               }
+             });
+}
+
+void BenchWs2812Encoder(Runner& runner) {
+  // Encoded into normal memory; a frame of a real strip goes to DmaMemory.
+  constexpr size_t kNumOfLeds = 1000;
+  std::vector<uint32_t> pixels(kNumOfLeds);
+  for (size_t i = 0; i < kNumOfLeds; ++i) {
+    pixels[i] = static_cast<uint32_t>(i * 0x01020304u);
+  }
+  using ColorOrder = rpl::Ws2812Encoder::ColorOrder;
+  const std::pair<const char*, ColorOrder> orders[] = {
+      {"ws2812/encode/grb/1000", ColorOrder::kGrb},
+      {"ws2812/encode/grbw/1000", ColorOrder::kGrbw},
+  };
+  for (const auto& order : orders) {
+    rpl::Ws2812Encoder encoder(order.second);
+    std::vector<uint32_t> words(encoder.GetNumOfWords(kNumOfLeds));
+    runner.Run(order.first, kNumOfLeds * encoder.GetBytesPerLed(),
+               [&](uint64_t iterations) {
+                 for (uint64_t i = 0; i < iterations; ++i) {
+                   encoder.Encode(pixels.data(), kNumOfLeds, words.data());
+                 }
+               });
+  }
+}
+
+void BenchPwmAudioConverter(Runner& runner) {
+  // One period of stereo frames, converted into normal memory.
+  constexpr size_t kNumOfFrames = 1024;
+  std::vector<int16_t> samples(kNumOfFrames * 2);
+  std::vector<float> float_samples(kNumOfFrames * 2);
+  for (size_t i = 0; i < samples.size(); ++i) {
+    samples[i] = static_cast<int16_t>(i * 2654435761u >> 16);
+    float_samples[i] = samples[i] / 32768.0f;
+  }
+  std::vector<uint32_t> words(kNumOfFrames * 2);
+  using Shaping = rpl::PwmAudioConverter::Shaping;
+
+  struct Case {
+    const char* name;
+    Shaping shaping;
+    double input_rate;
+    bool is_float;
+  };
+  const Case cases[] = {
+      {"pwm_audio/convert/int16/round/1024", Shaping::kRound, 48000.0, false},
+      {"pwm_audio/convert/int16/noise_shaping/1024", Shaping::kNoiseShaping,
+       48000.0, false},
+      {"pwm_audio/convert/float/noise_shaping/1024", Shaping::kNoiseShaping,
+       48000.0, true},
+      {"pwm_audio/convert/int16/resample_44100/1024", Shaping::kNoiseShaping,
+       44100.0, false},
+  };
+  for (const Case& c : cases) {
+    rpl::PwmAudioConverter converter(2048, c.shaping, c.input_rate, 48000.0);
+    uint64_t bytes_per_op =
+        kNumOfFrames * 2 * (c.is_float ? sizeof(float) : sizeof(int16_t));
+    runner.Run(c.name, bytes_per_op, [&](uint64_t iterations) {
+      size_t consumed = 0;
+      for (uint64_t i = 0; i < iterations; ++i) {
+        if (c.is_float) {
+          converter.Convert(float_samples.data(), kNumOfFrames, words.data(),
+                            kNumOfFrames, &consumed);
+        } else {
+          converter.Convert(samples.data(), kNumOfFrames, words.data(),
+                            kNumOfFrames, &consumed);
+        }
+      }
+    });
+  }
+}
+
+void BenchDmaMemory(Runner& runner, bool available) {
+  const char* names[] = {
+      "dma_memory/allocate_free",
+      "dma_memory/get_physical_address",
+      "dma/configure_memory_to_peripheral/dma_memory",
+  };
+  if (!available) {
+    for (const char* name : names) {
+      runner.Skip(name, "needs /dev/vcio and /dev/mem of a Raspberry Pi");
+    }
+    return;
+  }
+
+  rpl::DmaMemory& dma_memory = rpl::DmaMemory::GetInstance();
+  // The blocks stay allocated, so the lookup has to search all of them.
+  constexpr size_t kNumOfBlocks = 8;
+  void* blocks[kNumOfBlocks];
+  for (void*& block : blocks) {
+    block = dma_memory.Allocate(4096);
+    if (block == nullptr) {
+      for (const char* name : names) {
+        runner.Skip(name, "DmaMemory::Allocate() failed");
+      }
+      return;
+    }
+  }
+
+  runner.Run(names[0], 0, [&dma_memory](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      dma_memory.Free(dma_memory.Allocate(64));
+    }
+  });
+  void* last = static_cast<uint8_t*>(blocks[kNumOfBlocks - 1]) + 64;
+  runner.Run(names[1], 0, [&dma_memory, last](uint64_t iterations) {
+    volatile uint32_t sink;
+    for (uint64_t i = 0; i < iterations; ++i) {
+      sink = dma_memory.GetPhysicalAddress(last);
+    }
+    (void)sink;
+  });
+  rpl::DmaControlBlock* control_block =
+      static_cast<rpl::DmaControlBlock*>(blocks[0]);
+  runner.Run(names[2], 0, [control_block](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      rpl::Dma::ConfigureMemoryToPeripheral(
+          control_block, 0x1000, 0x7e20c018, 4096,
+          rpl::DmaRegisterMap::TI::PERMAP::kPwm0);
+    }
+  });
+
+  for (void* block : blocks) { dma_memory.Free(block); }
+}
+
+void BenchDmaCopy(Runner& runner, bool available) {
+  const char* names[] = {
+      "dma_copy/cpu/4096",        "dma_copy/dma/4096",
+      "dma_copy/auto/4096",       "dma_copy/cpu/262144",
+      "dma_copy/dma/262144",      "dma_copy/auto/262144",
+      "dma_copy/dma/2ch/1048576",
+  };
+  if (!available) {
+    for (const char* name : names) {
+      runner.Skip(name, "needs /dev/vcio and /dev/mem of a Raspberry Pi");
+    }
+    return;
+  }
+
+  rpl::DmaMemory& dma_memory = rpl::DmaMemory::GetInstance();
+  constexpr size_t kMaxLength = 1024 * 1024;
+  void* src = dma_memory.Allocate(kMaxLength);
+  void* dest = dma_memory.Allocate(kMaxLength);
+  std::unique_ptr<rpl::DmaCopy> copy =
+      rpl::DmaCopy::Create(rpl::DmaCopy::Config());
+  if (src == nullptr || dest == nullptr || copy == nullptr) {
+    for (const char* name : names) {
+      runner.Skip(name, "DmaMemory::Allocate() or DmaCopy::Create() failed");
+    }
+    if (src != nullptr) { dma_memory.Free(src); }
+    if (dest != nullptr) { dma_memory.Free(dest); }
+    return;
+  }
+  size_t calibrated = copy->GetThreshold();
+  std::fprintf(stderr, "dma_copy threshold: %zu bytes\n", calibrated);
+
+  // Each case forces the path with the threshold.
+  const std::pair<size_t, size_t> cases[] = {
+      {4096, SIZE_MAX},   {4096, 1},   {4096, calibrated},
+      {262144, SIZE_MAX}, {262144, 1}, {262144, calibrated},
+      {kMaxLength, 1},
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    size_t length = cases[i].first;
+    copy->SetThreshold(cases[i].second);
+    runner.Run(names[i], length, [&](uint64_t iterations) {
+      for (uint64_t n = 0; n < iterations; ++n) {
+        copy->Copy(dest, src, length);
+      }
+    });
+  }
+
+  copy.reset();
+  dma_memory.Free(src);
+  dma_memory.Free(dest);
+}
+
+void BenchDmaBandwidth(Runner& runner, bool available) {
+  // Within the 64 KiB limit of a lite channel
+  constexpr uint32_t kLength = 32768;
+  using Options = rpl::Dma::TransferOptions;
+  Options burst4 = Options::Bulk();
+  burst4.burst_length = 4;
+  const std::pair<const char*, Options> settings[] = {
+      {"default", Options()},
+      {"peripheral_safe", Options::PeripheralSafe()},
+      {"burst4", burst4},
+      {"bulk", Options::Bulk()},
+  };
+  const std::pair<const char*, rpl::Dma::Channel> channels[] = {
+      {"full", rpl::Dma::Channel::kChannel2},
+      {"lite", rpl::Dma::Channel::kChannel7},
+  };
+  std::vector<std::string> names;
+  for (const auto& channel : channels) {
+    for (const auto& setting : settings) {
+      names.push_back(std::string("dma/copy/") + channel.first + "/" +
+                      setting.first + "/32768");
+    }
+  }
+  names.push_back("dma/copy/dma4/bulk/32768");
+  if (!available) {
+    for (const std::string& name : names) {
+      runner.Skip(name, "needs /dev/vcio and /dev/mem of a Raspberry Pi");
+    }
+    return;
+  }
+
+  rpl::DmaMemory& dma_memory = rpl::DmaMemory::GetInstance();
+  void* src = dma_memory.Allocate(kLength);
+  void* dest = dma_memory.Allocate(kLength);
+  void* control_block = dma_memory.Allocate(sizeof(rpl::DmaControlBlock));
+  if (src == nullptr || dest == nullptr || control_block == nullptr) {
+    for (const std::string& name : names) {
+      runner.Skip(name, "DmaMemory::Allocate() failed");
+    }
+    for (void* block : {src, dest, control_block}) {
+      if (block != nullptr) { dma_memory.Free(block); }
+    }
+    return;
+  }
+  uint32_t src_physical = dma_memory.GetPhysicalAddress(src);
+  uint32_t dest_physical = dma_memory.GetPhysicalAddress(dest);
+  uint32_t control_block_physical =
+      dma_memory.GetPhysicalAddress(control_block);
+
+  size_t index = 0;
+  for (const auto& channel : channels) {
+    rpl::Dma* dma = rpl::Dma::GetInstance(channel.second);
+    dma->Enable();
+    for (const auto& setting : settings) {
+      rpl::Dma::ConfigureMemoryToMemory(
+          static_cast<rpl::DmaControlBlock*>(control_block), src_physical,
+          dest_physical, kLength, setting.second);
+      runner.Run(names[index++], kLength,
+                 [dma, control_block_physical](uint64_t iterations) {
+                   for (uint64_t i = 0; i < iterations; ++i) {
+                     // CONBLK_AD is 0 after the last control block.
+                     dma->SetControlBlockAddress(control_block_physical);
+                     dma->Start();
+                     dma->WaitForCompletion(1000);
+                   }
+                 });
+    }
+    dma->Disable();
+  }
+
+  rpl::Dma4* dma4 = rpl::Dma4::GetInstance(rpl::Dma4::Channel::kChannel11);
+  rpl::Dma4::ConfigureMemoryToMemory(
+      static_cast<rpl::Dma4ControlBlock*>(control_block),
+      rpl::Dma4::GetMemoryAddress(src_physical),
+      rpl::Dma4::GetMemoryAddress(dest_physical), kLength);
+  uint64_t control_block4_physical =
+      rpl::Dma4::GetMemoryAddress(control_block_physical);
+  dma4->Enable();
+  runner.Run(names[index], kLength,
+             [dma4, control_block4_physical](uint64_t iterations) {
+               for (uint64_t i = 0; i < iterations; ++i) {
+                 dma4->SetControlBlockAddress(control_block4_physical);
+                 dma4->Start();
+                 dma4->WaitForCompletion(1000);
+               }
+             });
+  dma4->Disable();
+
+  for (void* block : {src, dest, control_block}) { dma_memory.Free(block); }
+}
+
+void BenchDmaPlan(Runner& runner, bool available) {
+  const char* names[] = {
+      "dma/rearm/configure/64",
+      "dma_plan/rearm/launch/64",
+      "dma_plan/rearm/set_length_launch/64",
+  };
+  if (!available) {
+    for (const char* name : names) {
+      runner.Skip(name, "needs /dev/vcio and /dev/mem of a Raspberry Pi");
+    }
+    return;
+  }
+
+  constexpr uint32_t kLength = 64;
+  rpl::DmaMemory& dma_memory = rpl::DmaMemory::GetInstance();
+  void* src = dma_memory.Allocate(kLength);
+  void* dest = dma_memory.Allocate(kLength);
+  void* control_block = dma_memory.Allocate(sizeof(rpl::DmaControlBlock));
+  std::unique_ptr<rpl::DmaPlan> plan =
+      rpl::DmaPlan::Create(rpl::Dma::Channel::kChannel2, 1);
+  if (src == nullptr || dest == nullptr || control_block == nullptr ||
+      plan == nullptr || !plan->SetMemoryToMemory(0, dest, src, kLength)) {
+    for (const char* name : names) {
+      runner.Skip(name, "DmaMemory::Allocate() or DmaPlan::Create() failed");
+    }
+    plan.reset();
+    for (void* block : {src, dest, control_block}) {
+      if (block != nullptr) { dma_memory.Free(block); }
+    }
+    return;
+  }
+
+  // What a periodic transfer costs without a plan: the pointers are
+  // translated and the control block is refilled for every launch.
+  rpl::Dma* dma = rpl::Dma::GetInstance(rpl::Dma::Channel::kChannel2);
+  runner.Run(names[0], kLength, [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      rpl::Dma::ConfigureMemoryToMemory(
+          static_cast<rpl::DmaControlBlock*>(control_block),
+          dma_memory.GetPhysicalAddress(src),
+          dma_memory.GetPhysicalAddress(dest), kLength);
+      dma->SetControlBlockAddress(dma_memory.GetPhysicalAddress(control_block));
+      dma->Start();
+      dma->WaitForCompletion(1000);
+    }
+  });
+  runner.Run(names[1], kLength, [&plan](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      plan->Launch();
+      plan->Wait(1000);
+    }
+  });
+  runner.Run(names[2], kLength, [&plan](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      plan->SetLength(0, kLength - (i & 1) * 4);
+      plan->Launch();
+      plan->Wait(1000);
+    }
+  });
+
+  plan.reset();
+  for (void* block : {src, dest, control_block}) { dma_memory.Free(block); }
+}
+
+void BenchLog(Runner& runner) {
+  WithoutStdout([&runner]() {
+    runner.Run("log/debug", 0, [](uint64_t iterations) {
+      for (uint64_t i = 0; i < iterations; ++i) {
+        rpl::Log(rpl::LogLevel::Debug, "[Bench] debug message %d.",
+                 static_cast<int>(i));
+      }
+    });
+    // Removed at compile time unless the build level is DEBUG.
+    runner.Run("log/debug_macro", 0, [](uint64_t iterations) {
+      for (uint64_t i = 0; i < iterations; ++i) {
+        RPL4_LOG(rpl::LogLevel::Debug, "[Bench] debug message %d.",
+                 static_cast<int>(i));
+      }
+    });
+    runner.Run("log/error", 0, [](uint64_t iterations) {
+      for (uint64_t i = 0; i < iterations; ++i) {
+        rpl::Log(rpl::LogLevel::Error, "[Bench] error message %d.",
+                 static_cast<int>(i));
+      }
+    });
+    // Most of these are dropped once the ring is full, which costs about as
+    // much as a push.
+    rpl::SetLogMode(rpl::LogMode::kAsynchronous);
+    runner.Run("log/error_async", 0, [](uint64_t iterations) {
+      for (uint64_t i = 0; i < iterations; ++i) {
+        rpl::Log(rpl::LogLevel::Error, "[Bench] error message %d.",
+                 static_cast<int>(i));
+      }
+    });
+    rpl::SetLogMode(rpl::LogMode::kSynchronous);
+  });
+}
+
+void PrintUsage() {
+  std::fprintf(
+      stderr,
+      "Usage: rpl4_bench [options]\n"
+      "  --registers=auto|device|memory  Register maps to run against.\n"
+      "                                  auto uses the device when /dev/mem\n"
+      "                                  can be opened (default: auto)\n"
+      "  --output=FILE                   Write the JSON to FILE instead of\n"
+      "                                  the standard output\n"
+      "  --filter=TEXT                   Run only benchmarks whose name\n"
+      "                                  contains TEXT\n"
+      "  --min_time_ms=N                 Minimum time per benchmark\n"
+      "                                  (default: 200)\n"
+      "  --gpio=N                        GPIO pin toggled as an output\n"
+      "                                  (default: 26)\n"
+      "  --metrics                       Write the driver metrics to the\n"
+      "                                  standard error at the end\n");
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = std::strchr(arg, '=');
+    value = value == nullptr ? "" : value + 1;
+    if (std::strncmp(arg, "--registers=", 12) == 0) {
+      if (std::strcmp(value, "auto") == 0) {
+        options.mode = RegisterMode::kAuto;
+      } else if (std::strcmp(value, "device") == 0) {
+        options.mode = RegisterMode::kDevice;
+      } else if (std::strcmp(value, "memory") == 0) {
+        options.mode = RegisterMode::kMemory;
+      } else {
+        return false;
+      }
+    } else if (std::strncmp(arg, "--output=", 9) == 0) {
+      options.output = value;
+    } else if (std::strncmp(arg, "--filter=", 9) == 0) {
+      options.filter = value;
+    } else if (std::strncmp(arg, "--min_time_ms=", 14) == 0) {
+      options.min_time_ms = std::atof(value);
+      if (options.min_time_ms <= 0.0) { return false; }
+    } else if (std::strncmp(arg, "--gpio=", 7) == 0) {
+      int pin = std::atoi(value);
+      if (pin < 0 || pin > 57) { return false; }
+      options.gpio_pin = static_cast<uint8_t>(pin);
+    } else if (std::strcmp(arg, "--metrics") == 0) {
+      options.metrics = true;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    PrintUsage();
+    return 1;
+  }
+
+  // Log() prints to the standard output, so it is sent to the standard error
+  // and the standard output only carries the JSON.
+  FILE* json = nullptr;
+  if (options.output != nullptr) {
+    json = std::fopen(options.output, "w");
+  } else {
+    json = fdopen(dup(STDOUT_FILENO), "w");
+  }
+  if (json == nullptr) {
+    std::perror("rpl4_bench: cannot open the output");
+    return 1;
+  }
+  dup2(STDERR_FILENO, STDOUT_FILENO);
+
+  bool use_device = options.mode == RegisterMode::kDevice;
+  if (options.mode == RegisterMode::kAuto) {
+    use_device = access("/dev/mem", R_OK | W_OK) == 0 && rpl::IsAvailable();
+  }
+  if (use_device) {
+    rpl::Init();
+  } else {
+    rpl::InitWithMemoryBackedRegisters();
+    PresetMemoryBackedStatus();
+  }
+
+  Runner runner(options);
+  BenchGpio(runner, options.gpio_pin);
+  BenchSpi(runner);
+  BenchAuxSpi(runner);
+  BenchPwm(runner);
+  BenchControlBlock(runner);
+  BenchWs2812Encoder(runner);
+  BenchPwmAudioConverter(runner);
+  BenchDmaMemory(runner, use_device && access("/dev/vcio", R_OK | W_OK) == 0);
+  BenchDmaCopy(runner, use_device && access("/dev/vcio", R_OK | W_OK) == 0);
+  BenchDmaBandwidth(runner,
+                    use_device && access("/dev/vcio", R_OK | W_OK) == 0);
+  BenchDmaPlan(runner, use_device && access("/dev/vcio", R_OK | W_OK) == 0);
+  BenchLog(runner);
+
+  runner.WriteJson(json, use_device ? "device" : "memory");
+  std::fclose(json);
+  if (options.metrics) { rpl::Metrics::WriteText(stderr); }
+  return 0;
+}
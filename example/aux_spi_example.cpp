@@ -12,8 +12,7 @@ int main(void) {
   rpl::Init();
   using namespace std::chrono_literals;
 
-  std::shared_ptr<rpl::AuxSpi> spi =
-      rpl::AuxSpi::GetInstance(rpl::AuxSpi::Port::kAuxSpi1);
+  rpl::AuxSpi* spi = rpl::AuxSpi::GetInstance(rpl::AuxSpi::Port::kAuxSpi1);
 
   // GPIO configuration
   rpl::Gpio::SetAltFunction(16, rpl::Gpio::AltFunction::kAlt4);  // SPI1_CE2
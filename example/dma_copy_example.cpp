@@ -0,0 +1,69 @@
+#include <chrono>
+#include <iostream>
+
+#include "rpl4/peripheral/dma_copy.hpp"
+#include "rpl4/rpl4.hpp"
+#include "rpl4/system/dma_memory.hpp"
+
+int main(void) {
+  rpl::Init();
+
+  std::cout << "DmaCopy Example - CPU/DMA Crossover" << std::endl;
+
+  // The threshold is calibrated here.
+  auto copy = rpl::DmaCopy::Create(rpl::DmaCopy::Config());
+  if (copy == nullptr) {
+    std::cerr << "Failed to create DmaCopy" << std::endl;
+    return 1;
+  }
+  std::cout << "Threshold: " << copy->GetThreshold() << " bytes" << std::endl;
+
+  auto& dma_memory = rpl::DmaMemory::GetInstance();
+  constexpr size_t kMaxLength = 1024 * 1024;
+  uint8_t* src = static_cast<uint8_t*>(dma_memory.Allocate(kMaxLength));
+  uint8_t* dst = static_cast<uint8_t*>(dma_memory.Allocate(kMaxLength));
+  if (src == nullptr || dst == nullptr) {
+    std::cerr << "Failed to allocate DMA memory" << std::endl;
+    return 1;
+  }
+  // !! Do not use memset due to alignment requirements !!
+  for (size_t i = 0; i < kMaxLength; i++) {
+    src[i] = static_cast<uint8_t>(i * 7);
+    dst[i] = 0;
+  }
+
+  for (size_t length = 1024; length <= kMaxLength; length *= 4) {
+    auto start = std::chrono::steady_clock::now();
+    if (!copy->Copy(dst, src, length)) {
+      std::cerr << "Copy of " << length << " bytes failed" << std::endl;
+      return 1;
+    }
+    std::chrono::duration<double, std::micro> elapsed =
+        std::chrono::steady_clock::now() - start;
+    bool matched = true;
+    for (size_t i = 0; i < length; i++) {
+      if (dst[i] != src[i]) {
+        matched = false;
+        break;
+      }
+    }
+    std::cout << length << " bytes by "
+              << (length < copy->GetThreshold() ? "CPU" : "DMA") << ": "
+              << elapsed.count() << " us, "
+              << (matched ? "verified" : "MISMATCH") << std::endl;
+  }
+
+  // Start() returns while the DMA copies, so the CPU can do other work.
+  copy->Start(dst, src, kMaxLength);
+  std::cout << "Busy after Start(): " << std::boolalpha << copy->IsBusy()
+            << std::endl;
+  copy->Wait();
+
+  std::cout << "CPU copies: " << copy->GetCpuCopyCount()
+            << ", DMA copies: " << copy->GetDmaCopyCount() << std::endl;
+
+  copy.reset();
+  dma_memory.Free(src);
+  dma_memory.Free(dst);
+  return 0;
+}
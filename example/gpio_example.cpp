@@ -5,11 +5,11 @@
 #include "rpl4/peripheral/gpio.hpp"
 #include "rpl4/rpl4.hpp"
 
-std::shared_ptr<rpl::Gpio> gpio = rpl::Gpio::GetInstance(4);  // GPIO pin 4
-
 int main(void) {
   rpl::Init();
 
+  rpl::Gpio* gpio = rpl::Gpio::GetInstance(4);  // GPIO pin 4
+
   gpio->SetAltFunction(rpl::Gpio::AltFunction::kOutput);
   gpio->SetPullRegister(rpl::Gpio::PullRegister::kNoRegister);
 
@@ -0,0 +1,53 @@
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#include "rpl4/peripheral/gpio.hpp"
+#include "rpl4/peripheral/i2c.hpp"
+#include "rpl4/peripheral/i2c_scheduler.hpp"
+#include "rpl4/rpl4.hpp"
+
+int main(void) {
+  rpl::Init();
+  using namespace std::chrono_literals;
+
+  // GPIO configuration
+  rpl::Gpio::SetAltFunction(2, rpl::Gpio::AltFunction::kAlt0);  // SDA1
+  rpl::Gpio::SetAltFunction(3, rpl::Gpio::AltFunction::kAlt0);  // SCL1
+  rpl::Gpio::SetAltFunction(4, rpl::Gpio::AltFunction::kAlt5);  // SDA3
+  rpl::Gpio::SetAltFunction(5, rpl::Gpio::AltFunction::kAlt5);  // SCL3
+
+  // 100 kHz
+  rpl::I2c::GetInstance(rpl::I2c::Port::kI2c1)->SetClockDivider(5000);
+  rpl::I2c::GetInstance(rpl::I2c::Port::kI2c3)->SetClockDivider(5000);
+
+  // Read 6 bytes from register 0x3b of a sensor on each bus every 10 ms.
+  const uint8_t reg = 0x3b;
+  uint8_t rx_buf1[6];
+  uint8_t rx_buf3[6];
+
+  rpl::I2cScheduler scheduler;
+  auto job1 = scheduler.AddJob({rpl::I2c::Port::kI2c1, 0x68,
+                                rpl::I2cScheduler::JobType::kWriteRead, &reg,
+                                1, rx_buf1, sizeof(rx_buf1), 10000us});
+  auto job3 = scheduler.AddJob({rpl::I2c::Port::kI2c3, 0x68,
+                                rpl::I2cScheduler::JobType::kWriteRead, &reg,
+                                1, rx_buf3, sizeof(rx_buf3), 10000us});
+
+  for (int i = 0; i < 1000; ++i) {
+    scheduler.Poll();
+    std::this_thread::sleep_for(100us);
+  }
+
+  for (auto job : {job1, job3}) {
+    const auto& stats = scheduler.GetStatistics(job);
+    std::cout << "job " << job << ": transfers " << stats.transfers
+              << ", nacks " << stats.nacks << ", timeouts "
+              << stats.clock_stretch_timeouts << ", overruns "
+              << stats.overruns << ", max latency "
+              << stats.max_latency.count() << " ns" << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,44 @@
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "rpl4/peripheral/pwm_audio.hpp"
+#include "rpl4/rpl4.hpp"
+
+int main(void) {
+  rpl::Init();
+
+  std::cout << "PWM Audio Example - 440 Hz / 660 Hz on the headphone jack"
+            << std::endl;
+
+  rpl::PwmAudio::Config config;
+  auto audio = rpl::PwmAudio::Create(config);
+  if (audio == nullptr) {
+    std::cerr << "Failed to set up the PWM audio" << std::endl;
+    return 1;
+  }
+  std::cout << "Output sample rate: " << audio->GetOutputSampleRate() << " Hz"
+            << std::endl;
+
+  // 3 seconds of a tone on each side, written in blocks of 10 ms.
+  constexpr double kPi = 3.14159265358979323846;
+  constexpr size_t kBlockFrames = 480;
+  std::vector<int16_t> block(kBlockFrames * 2);
+  uint64_t frame = 0;
+  for (size_t n = 0; n < 300; ++n) {
+    for (size_t i = 0; i < kBlockFrames; ++i, ++frame) {
+      double t = frame / config.sample_rate;
+      block[i * 2] =
+          static_cast<int16_t>(8000.0 * std::sin(2.0 * kPi * 440.0 * t));
+      block[i * 2 + 1] =
+          static_cast<int16_t>(8000.0 * std::sin(2.0 * kPi * 660.0 * t));
+    }
+    audio->Write(block.data(), kBlockFrames);
+  }
+  audio->Drain();
+
+  std::cout << "Underruns: " << audio->GetUnderruns() << std::endl;
+  std::cout << "Example completed successfully!" << std::endl;
+  return 0;
+}
@@ -82,8 +82,7 @@ int main(void) {
   // Configure control block
   rpl::Dma::ConfigureMemoryToPeripheral(
       control_blocks, pattern_physical, pwm_fifo_physical,
-      (kPatternSize) * sizeof(uint32_t),
-      rpl::DmaRegisterMap::TI::PERMAP::kPwm0);
+      (kPatternSize) * sizeof(uint32_t), pwm->GetDreq());
 
   // Link to second control block (circular buffer)
   control_blocks->next_control_block = cb_physical;
@@ -0,0 +1,188 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#include "rpl4/registers/fields_dma.hpp"
+#include "rpl4/registers/fields_spi.hpp"
+
+// Compares per-field bitfield assignments with RegValue writes. The registers
+// are backed by normal memory so that this runs on any Linux host; on device
+// memory every access is much slower, so the difference grows. Build with
+// optimization (e.g. CMAKE_BUILD_TYPE=Release); without it the RegValue
+// helpers are not inlined.
+//
+// Each call is written once as a generic lambda. It is timed on a volatile
+// register and its accesses are counted on a CountingRegister, so the counts
+// are those of the code that is timed.
+
+namespace {
+
+using CS = rpl::SpiRegisterMap::CS;
+using TI = rpl::DmaRegisterMap::TI;
+
+// A register in normal memory. The register structs cannot be constructed,
+// so they share the storage with a word.
+template <typename Register>
+union RegisterStorage {
+  RegisterStorage() : word(0) {}
+
+  uint32_t word;
+  Register reg;
+};
+
+// The register as the drivers access it.
+template <typename Register>
+class DirectRegister {
+ public:
+  explicit DirectRegister(volatile Register& reg) : reg_(reg) {}
+
+  inline volatile Register* operator->() { return &reg_; }
+  inline void Write(rpl::RegValue<Register> value) {
+    rpl::WriteRegister(reg_, value);
+  }
+  inline void Modify(rpl::RegValue<Register> value) {
+    rpl::ModifyRegister(reg_, value);
+  }
+
+ private:
+  volatile Register& reg_;
+};
+
+// Counts the loads and stores of the same calls. A bitfield assignment to a
+// volatile register loads the whole register and stores it back, so
+// operator-> loads a copy that is stored when the assignment ends.
+template <typename Register>
+class CountingRegister {
+ public:
+  class FieldAccess {
+   public:
+    explicit FieldAccess(CountingRegister& owner) : owner_(owner) {
+      copy_.word = owner_.Load();
+    }
+    FieldAccess(const FieldAccess&) = delete;
+    FieldAccess& operator=(const FieldAccess&) = delete;
+    ~FieldAccess() { owner_.Store(copy_.word); }
+
+    inline Register* operator->() { return &copy_.reg; }
+
+   private:
+    CountingRegister& owner_;
+    RegisterStorage<Register> copy_;
+  };
+
+  inline FieldAccess operator->() { return FieldAccess(*this); }
+  inline void Write(rpl::RegValue<Register> value) {
+    Store(value.ApplyTo(0));
+  }
+  inline void Modify(rpl::RegValue<Register> value) {
+    Store(value.ApplyTo(Load()));
+  }
+
+  inline int GetReads() const { return reads_; }
+  inline int GetWrites() const { return writes_; }
+
+ private:
+  uint32_t Load() {
+    ++reads_;
+    return word_;
+  }
+  void Store(uint32_t word) {
+    ++writes_;
+    word_ = word;
+  }
+
+  uint32_t word_ = 0;
+  int reads_ = 0;
+  int writes_ = 0;
+};
+
+// Returns the time per call of func in nanoseconds.
+template <typename Register, typename Func>
+double Measure(volatile Register& reg, Func func) {
+  constexpr int kIterations = 1000000;
+  DirectRegister<Register> direct(reg);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kIterations; ++i) { func(direct); }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / kIterations;
+}
+
+// Prints the accesses and the time of one call.
+template <typename Register, typename Func>
+void Report(volatile Register& reg, Func func) {
+  CountingRegister<Register> counting;
+  func(counting);
+  std::printf("  %2d / %-2d %8.2f", counting.GetReads(), counting.GetWrites(),
+              Measure(reg, func));
+}
+
+template <typename Register, typename Before, typename After>
+void Compare(const char* name, volatile Register& reg, Before before,
+             After after) {
+  std::printf("%-28s", name);
+  Report(reg, before);
+  Report(reg, after);
+  std::printf("\n");
+}
+
+}  // namespace
+
+int main(void) {
+#ifndef __OPTIMIZE__
+  std::printf("Warning: built without optimization.\n");
+#endif
+  alignas(4) static volatile RegisterStorage<CS> spi_cs;
+  alignas(4) static volatile RegisterStorage<TI> dma_ti;
+
+  std::printf("%-28s  %-16s  %-16s\n", "", "bitfield", "RegValue");
+  std::printf("%-28s  %-7s %8s  %-7s %8s\n", "call", "rd / wr", "ns",
+              "rd / wr", "ns");
+
+  // Spi: clear the FIFOs and start a transfer.
+  Compare(
+      "Spi start transfer", spi_cs.reg,
+      [](auto& cs) {
+        cs->clear = CS::CLEAR::kClearBothFifo;
+        cs->ta = CS::TA::kActive;
+      },
+      [](auto& cs) {
+        cs.Modify(rpl::SpiFields::CS::kClear(CS::CLEAR::kClearBothFifo) |
+                  rpl::SpiFields::CS::kTa(CS::TA::kActive));
+      });
+
+  // Spi: start a packed transfer.
+  Compare(
+      "Spi start packed transfer", spi_cs.reg,
+      [](auto& cs) {
+        cs->clear = CS::CLEAR::kClearBothFifo;
+        cs->dmaen = CS::DMAEN::kEnable;
+        cs->ta = CS::TA::kActive;
+      },
+      [](auto& cs) {
+        cs.Modify(rpl::SpiFields::CS::kClear(CS::CLEAR::kClearBothFifo) |
+                  rpl::SpiFields::CS::kDmaen(CS::DMAEN::kEnable) |
+                  rpl::SpiFields::CS::kTa(CS::TA::kActive));
+      });
+
+  // Dma: transfer information of a memory-to-peripheral control block.
+  Compare(
+      "Dma control block TI", dma_ti.reg,
+      [](auto& ti) {
+        ti->src_inc = TI::SRC_INC::kEnable;
+        ti->dest_dreq = TI::DEST_DREQ::kEnable;
+        ti->wait_resp = TI::WAIT_RESP::kEnable;
+        ti->no_wide_bursts = TI::NO_WIDE_BURSTS::kEnable;
+        ti->permap = TI::PERMAP::kPwm0;
+      },
+      [](auto& ti) {
+        ti.Write(rpl::DmaFields::TI::kSrcInc(TI::SRC_INC::kEnable) |
+                 rpl::DmaFields::TI::kDestDreq(TI::DEST_DREQ::kEnable) |
+                 rpl::DmaFields::TI::kWaitResp(TI::WAIT_RESP::kEnable) |
+                 rpl::DmaFields::TI::kNoWideBursts(
+                     TI::NO_WIDE_BURSTS::kEnable) |
+                 rpl::DmaFields::TI::kPermap(TI::PERMAP::kPwm0));
+      });
+
+  return 0;
+}
@@ -0,0 +1,50 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+
+#include "rpl4/peripheral/software_pwm.hpp"
+#include "rpl4/rpl4.hpp"
+
+int main(void) {
+  rpl::Init();
+
+  std::cout << "Software PWM Example - Servo on GPIO 17, LED on GPIO 27"
+            << std::endl;
+
+  rpl::SoftwarePwm::Config config;
+  config.step_us = 5.0;
+  config.period_us = 20000.0;
+  auto software_pwm = rpl::SoftwarePwm::Create(config);
+  if (software_pwm == nullptr) {
+    std::cerr << "Failed to set up the software PWM" << std::endl;
+    return 1;
+  }
+  std::cout << software_pwm->GetNumOfSteps() << " steps of "
+            << software_pwm->GetStepTime() << " us" << std::endl;
+
+  constexpr uint8_t kServoPin = 17;
+  constexpr uint8_t kLedPin = 27;
+  if (!software_pwm->AddChannel(kServoPin) ||
+      !software_pwm->AddChannel(kLedPin)) {
+    std::cerr << "Failed to add the channels" << std::endl;
+    return 1;
+  }
+
+  // Sweep the servo from 1 ms to 2 ms and back while fading the LED.
+  using namespace std::chrono_literals;
+  for (int cycle = 0; cycle < 3; ++cycle) {
+    for (int i = 0; i <= 100; ++i) {
+      int position = cycle % 2 == 0 ? i : 100 - i;
+      software_pwm->SetPulseWidth(kServoPin, 1000.0 + position * 10.0);
+      software_pwm->SetDutyCycle(kLedPin, position / 100.0);
+      std::this_thread::sleep_for(20ms);
+    }
+  }
+
+  software_pwm->RemoveChannel(kServoPin);
+  software_pwm->RemoveChannel(kLedPin);
+
+  std::cout << "Example completed successfully!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,79 @@
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "rpl4/peripheral/aux_spi.hpp"
+#include "rpl4/peripheral/gpio.hpp"
+#include "rpl4/peripheral/spi.hpp"
+#include "rpl4/rpl4.hpp"
+
+namespace {
+
+// Returns the throughput of func in bytes per second.
+double Measure(uint32_t data_length, const std::function<void()>& func) {
+  constexpr int kIterations = 100;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kIterations; ++i) { func(); }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return data_length * kIterations / elapsed.count();
+}
+
+void Compare(const char* name, rpl::SpiBase& spi) {
+  std::cout << name << std::endl;
+  std::cout << "  bytes\tcombined[B/s]\ttransmit[B/s]\treceive[B/s]"
+            << std::endl;
+  for (uint32_t data_length : {16u, 64u, 256u, 1024u, 4096u}) {
+    std::vector<uint8_t> tx_buf(data_length, 0xa5);
+    std::vector<uint8_t> rx_buf(data_length);
+    double combined = Measure(data_length, [&]() {
+      spi.TransmitAndReceiveBlocking(tx_buf.data(), rx_buf.data(),
+                                     data_length);
+    });
+    double transmit = Measure(data_length, [&]() {
+      spi.TransmitBlocking(tx_buf.data(), data_length);
+    });
+    double receive = Measure(data_length, [&]() {
+      spi.ReceiveBlocking(rx_buf.data(), data_length, 0xff);
+    });
+    std::cout << "  " << data_length << "\t" << combined << "\t" << transmit
+              << "\t" << receive << std::endl;
+  }
+}
+
+}  // namespace
+
+int main(void) {
+  rpl::Init();
+
+  // SPI0
+  rpl::Gpio::SetAltFunction(8, rpl::Gpio::AltFunction::kAlt0);   // SPI0_CE0
+  rpl::Gpio::SetAltFunction(9, rpl::Gpio::AltFunction::kAlt0);   // SPI0_MISO
+  rpl::Gpio::SetAltFunction(10, rpl::Gpio::AltFunction::kAlt0);  // SPI0_MOSI
+  rpl::Gpio::SetAltFunction(11, rpl::Gpio::AltFunction::kAlt0);  // SPI0_SCLK
+
+  // SPI1
+  rpl::Gpio::SetAltFunction(18, rpl::Gpio::AltFunction::kAlt4);  // SPI1_CE0
+  rpl::Gpio::SetAltFunction(19, rpl::Gpio::AltFunction::kAlt4);  // SPI1_MISO
+  rpl::Gpio::SetAltFunction(20, rpl::Gpio::AltFunction::kAlt4);  // SPI1_MOSI
+  rpl::Gpio::SetAltFunction(21, rpl::Gpio::AltFunction::kAlt4);  // SPI1_SCLK
+
+  rpl::Spi* spi = rpl::Spi::GetInstance(rpl::Spi::Port::kSpi0);
+  spi->SetClockDivider(16);
+  spi->SetChipSelectForCommunication(rpl::Spi::ChipSelect::kChipSelect0);
+
+  rpl::AuxSpi* aux_spi = rpl::AuxSpi::GetInstance(rpl::AuxSpi::Port::kAuxSpi1);
+  aux_spi->Enable();
+  aux_spi->SetClockDivider(8);
+  aux_spi->SetBitLength(8);
+  aux_spi->SetChipSelectForCommunication(
+      rpl::AuxSpi::ChipSelect::kChipSelect0);
+
+  Compare("Spi0", *spi);
+  Compare("AuxSpi1", *aux_spi);
+
+  return 0;
+}
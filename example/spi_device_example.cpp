@@ -0,0 +1,58 @@
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#include "rpl4/peripheral/gpio.hpp"
+#include "rpl4/peripheral/spi.hpp"
+#include "rpl4/peripheral/spi_device.hpp"
+#include "rpl4/rpl4.hpp"
+
+int main(void) {
+  rpl::Init();
+
+  // GPIO configuration
+  rpl::Gpio::SetAltFunction(7, rpl::Gpio::AltFunction::kAlt0);   // SPI0_CE1
+  rpl::Gpio::SetAltFunction(8, rpl::Gpio::AltFunction::kAlt0);   // SPI0_CE0
+  rpl::Gpio::SetAltFunction(9, rpl::Gpio::AltFunction::kAlt0);   // SPI0_MISO
+  rpl::Gpio::SetAltFunction(10, rpl::Gpio::AltFunction::kAlt0);  // SPI0_MOSI
+  rpl::Gpio::SetAltFunction(11, rpl::Gpio::AltFunction::kAlt0);  // SPI0_SCLK
+
+  rpl::Spi* spi = rpl::Spi::GetInstance(rpl::Spi::Port::kSpi0);
+
+  // Two devices with different modes and clocks on the same bus.
+  rpl::SpiDevice<rpl::Spi> adc(
+      spi, {rpl::Spi::ChipSelect::kChipSelect0, rpl::Spi::ClockPhase::kMiddle,
+            rpl::Spi::ClockPolarity::kLow, rpl::Spi::CsPolarity::kLow, 64});
+  rpl::SpiDevice<rpl::Spi> flash(
+      spi, {rpl::Spi::ChipSelect::kChipSelect1,
+            rpl::Spi::ClockPhase::kBeginning, rpl::Spi::ClockPolarity::kHigh,
+            rpl::Spi::CsPolarity::kLow, 8});
+
+  std::thread adc_thread([&]() {
+    uint8_t tx_buf[3] = {0x01, 0x80, 0x00};
+    uint8_t rx_buf[3];
+    for (int i = 0; i < 1000; ++i) {
+      adc.TransmitAndReceiveBlocking(tx_buf, rx_buf, sizeof(tx_buf));
+    }
+    std::cout << "adc: " << (((rx_buf[1] & 0x03) << 8) | rx_buf[2])
+              << std::endl;
+  });
+
+  std::thread flash_thread([&]() {
+    uint8_t id[3];
+    for (int i = 0; i < 1000; ++i) {
+      // Keep the bus for the whole command.
+      auto transaction = flash.Begin();
+      const uint8_t command = 0x9f;
+      rpl::SpiSegment segments[] = {{&command, nullptr, 1},
+                                    {nullptr, id, sizeof(id)}};
+      transaction->Transfer(segments, 2);
+    }
+    std::printf("flash: %02x %02x %02x\n", id[0], id[1], id[2]);
+  });
+
+  adc_thread.join();
+  flash_thread.join();
+
+  return 0;
+}
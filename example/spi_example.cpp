@@ -12,7 +12,7 @@ int main(void) {
   rpl::Init();
   using namespace std::chrono_literals;
 
-  std::shared_ptr<rpl::Spi> spi = rpl::Spi::GetInstance(rpl::Spi::Port::kSpi0);
+  rpl::Spi* spi = rpl::Spi::GetInstance(rpl::Spi::Port::kSpi0);
 
   // GPIO configuration
   rpl::Gpio::SetAltFunction(7, rpl::Gpio::AltFunction::kAlt0);   // SPI0_CE1
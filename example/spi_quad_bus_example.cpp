@@ -13,10 +13,10 @@ int main(void) {
   rpl::Init();
   using namespace std::chrono_literals;
 
-  std::shared_ptr<rpl::Spi> spi0 = rpl::Spi::GetInstance(rpl::Spi::Port::kSpi0);
-  std::shared_ptr<rpl::Spi> spi3 = rpl::Spi::GetInstance(rpl::Spi::Port::kSpi3);
-  std::shared_ptr<rpl::Spi> spi4 = rpl::Spi::GetInstance(rpl::Spi::Port::kSpi4);
-  std::shared_ptr<rpl::Spi> spi5 = rpl::Spi::GetInstance(rpl::Spi::Port::kSpi5);
+  rpl::Spi* spi0 = rpl::Spi::GetInstance(rpl::Spi::Port::kSpi0);
+  rpl::Spi* spi3 = rpl::Spi::GetInstance(rpl::Spi::Port::kSpi3);
+  rpl::Spi* spi4 = rpl::Spi::GetInstance(rpl::Spi::Port::kSpi4);
+  rpl::Spi* spi5 = rpl::Spi::GetInstance(rpl::Spi::Port::kSpi5);
 
   rpl::Gpio::SetAltFunction(8, rpl::Gpio::AltFunction::kAlt0);   // SPI0_CE0
   rpl::Gpio::SetAltFunction(9, rpl::Gpio::AltFunction::kAlt0);   // SPI0_MISO
@@ -0,0 +1,59 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+
+#include "rpl4/peripheral/ws2812.hpp"
+#include "rpl4/rpl4.hpp"
+
+// Color wheel: 0 ~ 255 -> red -> green -> blue -> red
+static uint32_t Wheel(uint8_t position) {
+  if (position < 85) {
+    return ((255 - position * 3) << 16) | ((position * 3) << 8);
+  } else if (position < 170) {
+    position -= 85;
+    return ((255 - position * 3) << 8) | (position * 3);
+  }
+  position -= 170;
+  return ((position * 3) << 16) | (255 - position * 3);
+}
+
+int main(void) {
+  rpl::Init();
+
+  std::cout << "WS2812 Example - Rainbow on GPIO 18" << std::endl;
+
+  rpl::Ws2812::Config config;
+  config.pin = 18;
+  config.num_leds = 60;
+  config.brightness = 64;
+  auto strip = rpl::Ws2812::Create(config);
+  if (strip == nullptr) {
+    std::cerr << "Failed to set up the LED strip" << std::endl;
+    return 1;
+  }
+
+  // 60 fps for 5 seconds
+  using namespace std::chrono_literals;
+  auto next_frame = std::chrono::steady_clock::now();
+  for (uint32_t frame = 0; frame < 300; ++frame) {
+    for (size_t i = 0; i < strip->GetNumOfLeds(); ++i) {
+      strip->SetPixel(i, Wheel(static_cast<uint8_t>(i * 256 /
+                                                    strip->GetNumOfLeds() +
+                                                    frame)));
+    }
+    if (!strip->Show()) {
+      std::cerr << "Frame " << frame << " was not sent" << std::endl;
+    }
+    next_frame += 16667us;
+    std::this_thread::sleep_until(next_frame);
+  }
+
+  // Turn the LEDs off.
+  for (size_t i = 0; i < strip->GetNumOfLeds(); ++i) { strip->SetPixel(i, 0); }
+  strip->Show();
+  strip->Wait();
+
+  std::cout << "Example completed successfully!" << std::endl;
+  return 0;
+}
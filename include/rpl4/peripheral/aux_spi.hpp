@@ -7,6 +7,10 @@
 #include "rpl4/peripheral/spi_base.hpp"
 #include "rpl4/registers/registers_aux.hpp"
 #include "rpl4/registers/registers_aux_spi.hpp"
+#include "rpl4/registers/shadow_register.hpp"
+#include "rpl4/system/instance_registry.hpp"
+#include "rpl4/system/metrics.hpp"
+#include "rpl4/system/trace.hpp"
 
 namespace rpl {
 
@@ -21,12 +25,13 @@ class AuxSpi : public SpiBase {
    * @brief Get the AuxSpi instance of specified spi port.
    * @details To save memory, only the port instance obtained with GetInstance()
    *          is created. If a port instance has already been created, the same
-   *          instance will be returned.
+   *          instance will be returned. It is safe to call this concurrently;
+   *          the instance is created exactly once.
    *
    * @param port
-   * @return std::shared_ptr<AuxSpi>
+   * @return AuxSpi* nullptr if RPL is not initialized.
    */
-  static std::shared_ptr<AuxSpi> GetInstance(Port port);
+  static AuxSpi* GetInstance(Port port);
 
   AuxSpi(const AuxSpi&) = delete;
   AuxSpi& operator=(const AuxSpi&) = delete;
@@ -36,6 +41,8 @@ class AuxSpi : public SpiBase {
 
   /**
    * @brief Get the AuxSpiRegisterMap pointer.
+   * @note CNTL0 and CNTL1 are cached. Writing them through the register map is
+   *       not seen by this class.
    *
    * @return AuxSpiRegisterMap*
    */
@@ -45,12 +52,15 @@ class AuxSpi : public SpiBase {
    * @brief Enable the AuxSpi peripheral.
    */
   inline void Enable() {
-    register_map_->cntl_0.enable = AuxSpiRegisterMap::CNTL0::Enable::kEnable;
+    cntl_0_->enable = AuxSpiRegisterMap::CNTL0::Enable::kEnable;
+    cntl_0_.Commit();
     if (register_map_ == REG_SPI1) {
       REG_AUX->enables.spi1 = AuxRegisterMap::Enables::Spi1Enable::kEnabled;
     } else if (register_map_ == REG_SPI2) {
       REG_AUX->enables.spi2 = AuxRegisterMap::Enables::Spi2Enable::kEnabled;
     }
+    Trace::CountRead(kTracePeripheral);
+    Trace::CountWrite(kTracePeripheral);
     ConfigureDataShiftTx();
     ConfigureDataShiftRx();
   }
@@ -60,12 +70,15 @@ class AuxSpi : public SpiBase {
    * @details The FIFOs can still be written to or read from when disabled.
    */
   inline void Disable() {
-    register_map_->cntl_0.enable = AuxSpiRegisterMap::CNTL0::Enable::kDisable;
+    cntl_0_->enable = AuxSpiRegisterMap::CNTL0::Enable::kDisable;
+    cntl_0_.Commit();
     if (register_map_ == REG_SPI1) {
       REG_AUX->enables.spi1 = AuxRegisterMap::Enables::Spi1Enable::kDisabled;
     } else if (register_map_ == REG_SPI2) {
       REG_AUX->enables.spi2 = AuxRegisterMap::Enables::Spi2Enable::kDisabled;
     }
+    Trace::CountRead(kTracePeripheral);
+    Trace::CountWrite(kTracePeripheral);
   }
 
   void SetChipSelectForCommunication(uint8_t chip_select) override {
@@ -86,7 +99,8 @@ class AuxSpi : public SpiBase {
 
   using ChipSelect = AuxSpiRegisterMap::CNTL0::ChipSelect;
   inline void SetChipSelectForCommunication(ChipSelect chip_select) {
-    register_map_->cntl_0.chip_select = chip_select;
+    cntl_0_->chip_select = chip_select;
+    cntl_0_.Commit();
   }
 
   using MisoClockPhase = AuxSpiRegisterMap::CNTL0::InRising;
@@ -96,7 +110,8 @@ class AuxSpi : public SpiBase {
    * @param clock_phase
    */
   inline void SetMisoClockPhase(MisoClockPhase clock_phase) {
-    register_map_->cntl_0.in_rising = clock_phase;
+    cntl_0_->in_rising = clock_phase;
+    cntl_0_.Commit();
     ConfigureDataShiftRx();
   }
 
@@ -107,7 +122,12 @@ class AuxSpi : public SpiBase {
    * @param clock_phase
    */
   inline void SetMosiClockPhase(MosiClockPhase clock_phase) {
-    register_map_->cntl_0.out_rising = clock_phase;
+    if (!IsValidTxShift(cntl_0_->shift_length, cntl_0_->invert_spi_clock,
+                        clock_phase, "SetMosiClockPhase")) {
+      return;
+    }
+    cntl_0_->out_rising = clock_phase;
+    cntl_0_.Commit();
     ConfigureDataShiftTx();
   }
 
@@ -116,18 +136,14 @@ class AuxSpi : public SpiBase {
    *
    * @return ClockPhase
    */
-  inline MisoClockPhase GetMisoClockPhase() {
-    return register_map_->cntl_0.in_rising;
-  }
+  inline MisoClockPhase GetMisoClockPhase() { return cntl_0_->in_rising; }
 
   /**
    * @brief Get the MOSI Clock Phase
    *
    * @return ClockPhase
    */
-  inline MosiClockPhase GetMosiClockPhase() {
-    return register_map_->cntl_0.out_rising;
-  }
+  inline MosiClockPhase GetMosiClockPhase() { return cntl_0_->out_rising; }
 
   using ClockPolarity = AuxSpiRegisterMap::CNTL0::InvertSpiClock;
   /**
@@ -136,7 +152,12 @@ class AuxSpi : public SpiBase {
    * @param clock_polarity
    */
   inline void SetClockPolarity(ClockPolarity clock_polarity) {
-    register_map_->cntl_0.invert_spi_clock = clock_polarity;
+    if (!IsValidTxShift(cntl_0_->shift_length, clock_polarity,
+                        cntl_0_->out_rising, "SetClockPolarity")) {
+      return;
+    }
+    cntl_0_->invert_spi_clock = clock_polarity;
+    cntl_0_.Commit();
     ConfigureDataShiftTx();
     ConfigureDataShiftRx();
   }
@@ -149,7 +170,7 @@ class AuxSpi : public SpiBase {
    *    If kHigh is set, SCLK is high in the idle state.
    */
   inline ClockPolarity GetClockPolarity() {
-    return register_map_->cntl_0.invert_spi_clock;
+    return cntl_0_->invert_spi_clock;
   }
 
   /**
@@ -163,13 +184,15 @@ class AuxSpi : public SpiBase {
 
   using MisoBitOrder = AuxSpiRegisterMap::CNTL1::ShiftInMsBitFirst;
   inline void SetMisoBitOrder(MisoBitOrder bit_order) {
-    register_map_->cntl_1.shift_in_ms_bit_first = bit_order;
+    cntl_1_->shift_in_ms_bit_first = bit_order;
+    cntl_1_.Commit();
     ConfigureDataShiftRx();
   }
 
   using MosiBitOrder = AuxSpiRegisterMap::CNTL0::ShiftOutMsBitFirst;
   inline void SetMosiBitOrder(MosiBitOrder bit_order) {
-    register_map_->cntl_0.shift_out_ms_bit_first = bit_order;
+    cntl_0_->shift_out_ms_bit_first = bit_order;
+    cntl_0_.Commit();
     ConfigureDataShiftTx();
   }
 
@@ -183,30 +206,68 @@ class AuxSpi : public SpiBase {
    */
   void SetCsHighCycles(uint8_t cycles);
 
+  /**
+   * @brief Set the number of bits shifted per FIFO entry.
+   *
+   * @param bit_length Must be 1 ~ 32. 32 bits cannot be shifted out on the
+   *        early edge, because the FIFO word would have to be shifted by one
+   *        more bit. Changing the clock to the early edge with 32 bits is
+   *        rejected too.
+   */
   void SetBitLength(uint8_t bit_length);
 
+  /**
+   * @brief Settings of one device on the bus. Used by SpiDevice.
+   */
+  struct DeviceConfig {
+    ChipSelect chip_select = ChipSelect::kChipSelect0;
+    MisoClockPhase miso_clock_phase = MisoClockPhase::kRisingEdge;
+    MosiClockPhase mosi_clock_phase = MosiClockPhase::kFallingEdge;
+    ClockPolarity clock_polarity = ClockPolarity::kLow;
+    MisoBitOrder miso_bit_order = MisoBitOrder::kMsbFirst;
+    MosiBitOrder mosi_bit_order = MosiBitOrder::kMsbFirst;
+    uint16_t clock_divider = 0;  // Must be 0 ~ 4095
+    uint8_t bit_length = 8;      // Must be 1 ~ 32, see SetBitLength()
+  };
+
+  /**
+   * @brief Apply all the settings of a device at once.
+   * @details The settings are staged in the cached registers and written with
+   *          one store per register. The data shifts are recalculated once at
+   *          the end instead of after every setting.
+   *
+   * @param config
+   */
+  void ApplyDeviceConfig(const DeviceConfig& config);
+
   inline bool IsTransmissionCompleted() {
+    Trace::CountRead(kTracePeripheral);
     return register_map_->stat.busy == AuxSpiRegisterMap::STAT::Busy::kIdle;
   }
 
   inline bool IsTxFifoWritable() {
+    Trace::CountRead(kTracePeripheral);
     return register_map_->stat.tx_full !=
            AuxSpiRegisterMap::STAT::TxFull::kFull;
   }
 
   inline bool IsRxFifoReadable() {
+    Trace::CountRead(kTracePeripheral);
     return register_map_->stat.rx_empty !=
            AuxSpiRegisterMap::STAT::RxEmpty::kEmpty;
   }
 
   inline void WriteDataToTxFifo(uint32_t data) {
     register_map_->tx_hold_a.data = data;
+    Trace::CountWrite(kTracePeripheral);
   }
   inline void WriteFinalDataToTxFifo(uint32_t data) {
     register_map_->io_a.data = data;
+    Trace::CountWrite(kTracePeripheral);
   }
 
   inline uint32_t ReadDataFromRxFifo() const {
+    Trace::CountRead(kTracePeripheral);
     return register_map_->io_a.data;
   }
 
@@ -214,21 +275,82 @@ class AuxSpi : public SpiBase {
                                   uint8_t* receive_buf,
                                   uint32_t data_length) override;
 
+  void TransmitBlocking(const uint8_t* transmit_buf,
+                        uint32_t data_length) override;
+
+  void ReceiveBlocking(uint8_t* receive_buf, uint32_t data_length,
+                       uint8_t fill = 0) override;
+
+  void Transfer(const SpiSegment* segments, size_t num_segments) override;
+
+  /**
+   * @brief Transfer data_length words of up to 16 bits each.
+   * @details Each element is shifted as one FIFO entry of the length set by
+   *          SetBitLength(), so a 16-bit device needs one FIFO access per word
+   *          instead of two.
+   */
+  void TransmitAndReceiveBlocking(const uint16_t* transmit_buf,
+                                  uint16_t* receive_buf, uint32_t data_length);
+
+  /**
+   * @brief Transfer data_length words of up to 32 bits each.
+   * @details Each element is shifted as one FIFO entry of the length set by
+   *          SetBitLength(). For example a 24-bit ADC sample is moved with
+   *          one FIFO access instead of three.
+   * @note 32-bit words are only available when MOSI is not driven on the
+   *       early edge. See SetBitLength().
+   */
+  void TransmitAndReceiveBlocking(const uint32_t* transmit_buf,
+                                  uint32_t* receive_buf, uint32_t data_length);
+
+  /**
+   * @brief Get the counters and the latency of the blocking transfers.
+   *
+   * @return const PeripheralMetrics&
+   */
+  inline const PeripheralMetrics& GetMetrics() const { return metrics_; }
+
  private:
-  AuxSpi(AuxSpiRegisterMap* register_map);
+  static constexpr Trace::Peripheral kTracePeripheral =
+      Trace::Peripheral::kAuxSpi;
+
+  // Number of entries in each of the TX and RX FIFOs.
+  static constexpr uint32_t kFifoDepth = 4;
+
+  AuxSpi(AuxSpiRegisterMap* register_map, uint32_t instance);
 
   static constexpr size_t kNumOfInstances = 5;
-  static std::array<std::shared_ptr<AuxSpi>, kNumOfInstances> instances_;
+  static InstanceRegistry<AuxSpi, kNumOfInstances> instances_;
 
   AuxSpiRegisterMap* register_map_;
 
+  // Cached control registers. All their bits are settings, so they are
+  // committed without reading the device.
+  ShadowRegister<AuxSpiRegisterMap::CNTL0> cntl_0_;
+  ShadowRegister<AuxSpiRegisterMap::CNTL1> cntl_1_;
+
   // How many bit are right shifted when writing to FIFO.
   uint8_t data_shift_tx_ = 0;
   // How many bit are right shifted when reading from FIFO.
   uint8_t data_shift_rx_ = 0;
 
+  PeripheralMetrics metrics_;
+
+  // Whether MOSI is driven on the edge before the sampling edge, which
+  // shifts the FIFO word by one more bit.
+  static bool IsEarlyEdge(ClockPolarity clock_polarity,
+                          MosiClockPhase clock_phase);
+  // Log an error if 32-bit words would be shifted out on the early edge.
+  static bool IsValidTxShift(uint32_t bit_length, ClockPolarity clock_polarity,
+                             MosiClockPhase clock_phase, const char* method);
   void ConfigureDataShiftTx();
   void ConfigureDataShiftRx();
+  // Discard the words left in the RX FIFO before a transfer.
+  void DrainRxFifo();
+
+  template <typename T>
+  void TransferWords(const T* transmit_buf, T* receive_buf,
+                     uint32_t data_length);
 };
 
 }  // namespace rpl
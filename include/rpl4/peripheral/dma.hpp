@@ -2,13 +2,63 @@
 #define RPL4_PERIPHERAL_DMA_HPP_
 
 #include <array>
+#include <chrono>
 #include <cstdint>
 #include <memory>
 
 #include "rpl4/registers/registers_dma.hpp"
+#include "rpl4/system/instance_registry.hpp"
+#include "rpl4/system/metrics.hpp"
+#include "rpl4/system/trace.hpp"
 
 namespace rpl {
 
+/**
+ * @brief Tuning of the transfer information of a control block.
+ * @details The defaults are what the Configure*() helpers have always
+ *          written. The presets are for the two common cases.
+ */
+// Out-of-range values make the Configure*() helpers of Dma log an error and
+// leave the control block untouched.
+struct DmaTransferOptions {
+  // Words per burst, 0 : single transfers, up to 15
+  uint8_t burst_length = 0;
+  // Set to keep the AXI bursts to single beats, for peripherals that cannot
+  // take 2-beat bursts. 0 allows the engine to use them.
+  bool no_wide_bursts = false;
+  // Dummy cycles after each transfer, 0 ~ 31, to slow the DMA down
+  uint8_t waits = 0;
+  // 128-bit reads or writes. Need 16-byte aligned addresses and length.
+  bool wide_source = false;
+  bool wide_dest = false;
+  // Wait for the write response of each write, so that END means the data
+  // has arrived.
+  bool wait_resp = true;
+
+  /**
+   * @brief Fastest memory-to-memory setting: 128-bit reads and writes in
+   *        bursts of 8 words.
+   * @note The 128-bit widths need 16-byte aligned addresses and length.
+   */
+  static constexpr DmaTransferOptions Bulk() {
+    DmaTransferOptions options;
+    options.burst_length = 8;
+    options.wide_source = true;
+    options.wide_dest = true;
+    return options;
+  }
+
+  /**
+   * @brief Single 32-bit transfers without wide bursts, which any
+   *        peripheral FIFO accepts.
+   */
+  static constexpr DmaTransferOptions PeripheralSafe() {
+    DmaTransferOptions options;
+    options.no_wide_bursts = true;
+    return options;
+  }
+};
+
 class Dma {
  public:
   enum class Channel : size_t {
@@ -29,16 +79,20 @@ class Dma {
     kChannel14 = 14,
   };
 
+  using TransferOptions = DmaTransferOptions;
+
   /**
    * @brief Get the Dma instance of specified channel.
    * @details To save memory, only the channel instance obtained with
    *          GetInstance() is created. If a channel instance has already
-   *          been created, the same instance will be returned.
+   *          been created, the same instance will be returned. It is safe
+   *          to call this concurrently; the instance is created exactly
+   *          once.
    *
    * @param channel DMA channel
-   * @return std::shared_ptr<Dma>
+   * @return Dma* nullptr if RPL is not initialized.
    */
-  static std::shared_ptr<Dma> GetInstance(Channel channel);
+  static Dma* GetInstance(Channel channel);
 
   Dma(const Dma&) = delete;
   Dma& operator=(const Dma&) = delete;
@@ -115,6 +169,15 @@ class Dma {
    */
   void SetControlBlockAddress(uint32_t control_block_physical_addr);
 
+  /**
+   * @brief Get the address of the control block being processed
+   * @details Used to follow the progress of a chain or a ring of control
+   *          blocks. 0 after the last control block of a chain.
+   *
+   * @return uint32_t Physical address of the control block
+   */
+  uint32_t GetControlBlockAddress();
+
   /**
    * @brief Start DMA transfer
    */
@@ -122,12 +185,23 @@ class Dma {
 
   /**
    * @brief Wait for DMA transfer to complete
+   * @details Errors and timeouts are counted in the metrics, and the time
+   *          from Start() to the completion is recorded as the latency.
    *
    * @param timeout_ms Timeout in milliseconds (0 = no timeout)
    * @return true if completed, false if timeout
    */
   bool WaitForCompletion(uint32_t timeout_ms = 0);
 
+  /**
+   * @brief Get the counters and the latency of the transfers.
+   * @note Bytes are not counted, as Start() does not know the length of the
+   *       control block chain.
+   *
+   * @return const PeripheralMetrics&
+   */
+  inline const PeripheralMetrics& GetMetrics() const { return metrics_; }
+
   /**
    * @brief Set DMA priority
    *
@@ -149,11 +223,12 @@ class Dma {
    * @param src_physical Source physical address
    * @param dest_physical Destination physical address
    * @param length Transfer length in bytes
+   * @param options Burst and width tuning, e.g. TransferOptions::Bulk()
    */
-  static void ConfigureMemoryToMemory(DmaControlBlock* control_block,
-                                      uint32_t src_physical,
-                                      uint32_t dest_physical,
-                                      uint32_t length);
+  static void ConfigureMemoryToMemory(
+      DmaControlBlock* control_block, uint32_t src_physical,
+      uint32_t dest_physical, uint32_t length,
+      const TransferOptions& options = TransferOptions());
 
   /**
    * @brief Configure a memory-to-peripheral transfer
@@ -163,11 +238,13 @@ class Dma {
    * @param dest_physical Destination physical address (peripheral register)
    * @param length Transfer length in bytes
    * @param dreq DREQ signal mapping
+   * @param options Burst and width tuning
    */
   static void ConfigureMemoryToPeripheral(
       DmaControlBlock* control_block, uint32_t src_physical,
       uint32_t dest_physical, uint32_t length,
-      DmaRegisterMap::TI::PERMAP dreq);
+      DmaRegisterMap::TI::PERMAP dreq,
+      const TransferOptions& options = TransferOptions());
 
   /**
    * @brief Configure a peripheral-to-memory transfer
@@ -177,20 +254,28 @@ class Dma {
    * @param dest_physical Destination physical address
    * @param length Transfer length in bytes
    * @param dreq DREQ signal mapping
+   * @param options Burst and width tuning
    */
   static void ConfigurePeripheralToMemory(
       DmaControlBlock* control_block, uint32_t src_physical,
       uint32_t dest_physical, uint32_t length,
-      DmaRegisterMap::TI::PERMAP dreq);
+      DmaRegisterMap::TI::PERMAP dreq,
+      const TransferOptions& options = TransferOptions());
 
  private:
+  static constexpr Trace::Peripheral kTracePeripheral = Trace::Peripheral::kDma;
+
   Dma(DmaRegisterMap* register_map, Channel channel);
 
   static constexpr size_t kNumOfInstances = 15;
-  static std::array<std::shared_ptr<Dma>, kNumOfInstances> instances_;
+  static InstanceRegistry<Dma, kNumOfInstances> instances_;
 
   DmaRegisterMap* register_map_;
   Channel channel_;
+
+  PeripheralMetrics metrics_;
+  // When Start() was last called.
+  std::chrono::steady_clock::time_point start_time_;
 };
 
 }  // namespace rpl
@@ -0,0 +1,272 @@
+#ifndef RPL4_PERIPHERAL_DMA4_HPP_
+#define RPL4_PERIPHERAL_DMA4_HPP_
+
+#include <chrono>
+#include <cstdint>
+
+#include "rpl4/registers/registers_dma4.hpp"
+#include "rpl4/system/instance_registry.hpp"
+#include "rpl4/system/metrics.hpp"
+#include "rpl4/system/trace.hpp"
+
+namespace rpl {
+
+/**
+ * @brief DMA4 engine, channels 11 ~ 14 of BCM2711.
+ * @details DMA4 takes 40-bit addresses, so it reaches all the memory, and
+ *          moves up to 128 bits per beat in bursts of up to 16 beats. It is
+ *          the fastest engine for bulk memory-to-memory copies. The control
+ *          blocks have their own layout, Dma4ControlBlock, and their
+ *          addresses are given shifted right by 5.
+ * @note Memory addresses are ARM physical addresses. The bus addresses from
+ *       DmaMemory::GetPhysicalAddress() carry the 0xC0000000 alias and have
+ *       to be converted with GetMemoryAddress(), and peripheral addresses
+ *       with GetPeripheralAddress().
+ */
+class Dma4 {
+ public:
+  enum class Channel : size_t {
+    kChannel11 = 11,
+    kChannel12 = 12,
+    kChannel13 = 13,
+    kChannel14 = 14,
+  };
+
+  // LEN is 30 bits.
+  static constexpr uint32_t kMaxLength = (1u << 30) - 1;
+
+  /**
+   * @brief Get the Dma4 instance of specified channel.
+   * @details Only the channel instance obtained with GetInstance() is
+   *          created, exactly once.
+   * @note Dma::GetInstance() of channels 11 ~ 13 accesses the same engines
+   *       with the legacy register layout. Do not use both.
+   *
+   * @param channel DMA4 channel
+   * @return Dma4* nullptr if RPL is not initialized.
+   */
+  static Dma4* GetInstance(Channel channel);
+
+  Dma4(const Dma4&) = delete;
+  Dma4& operator=(const Dma4&) = delete;
+  Dma4(Dma4&&) = delete;
+  Dma4& operator=(Dma4&&) = delete;
+  ~Dma4() = default;
+
+  /**
+   * @brief Get the Dma4RegisterMap pointer.
+   *
+   * @return Dma4RegisterMap*
+   */
+  inline Dma4RegisterMap* GetRegister() const { return register_map_; }
+
+  /**
+   * @brief Get the channel number
+   *
+   * @return Channel number
+   */
+  inline Channel GetChannel() const { return channel_; }
+
+  /**
+   * @brief Enable the DMA channel
+   */
+  void Enable();
+
+  /**
+   * @brief Disable the DMA channel
+   */
+  void Disable();
+
+  /**
+   * @brief Abort any transfer and clear the END and INT flags.
+   * @details DMA4 has no reset bit, so this is the closest to Dma::Reset().
+   */
+  void Reset();
+
+  /**
+   * @brief Abort the current DMA transfer
+   */
+  void Abort();
+
+  /**
+   * @brief Check if DMA transfer is active
+   *
+   * @return true if active, false otherwise
+   */
+  bool IsActive();
+
+  /**
+   * @brief Check if DMA transfer has completed
+   *
+   * @return true if completed, false otherwise
+   */
+  bool IsComplete();
+
+  /**
+   * @brief Check if DMA has error
+   *
+   * @return true if error, false otherwise
+   */
+  bool HasError();
+
+  /**
+   * @brief Clear interrupt flag
+   */
+  void ClearInterrupt();
+
+  /**
+   * @brief Set control block address
+   *
+   * @param control_block_physical_addr Physical address of the control block,
+   *        32-byte aligned
+   */
+  void SetControlBlockAddress(uint64_t control_block_physical_addr);
+
+  /**
+   * @brief Get the address of the control block being processed
+   *
+   * @return uint64_t Physical address of the control block. 0 after the last
+   *         control block of a chain.
+   */
+  uint64_t GetControlBlockAddress();
+
+  /**
+   * @brief Start DMA transfer
+   * @details The END flag is cleared by the same store, and END is only set
+   *          after all the writes have completed, so the data is in memory
+   *          when WaitForCompletion() returns.
+   */
+  void Start();
+
+  /**
+   * @brief Wait for DMA transfer to complete
+   * @details Errors and timeouts are counted in the metrics, and the time
+   *          from Start() to the completion is recorded as the latency.
+   *
+   * @param timeout_ms Timeout in milliseconds (0 = no timeout)
+   * @return true if completed, false if error or timeout
+   */
+  bool WaitForCompletion(uint32_t timeout_ms = 0);
+
+  /**
+   * @brief Get the counters and the latency of the transfers.
+   *
+   * @return const PeripheralMetrics&
+   */
+  inline const PeripheralMetrics& GetMetrics() const { return metrics_; }
+
+  /**
+   * @brief Set the AXI QoS of the transfers
+   *
+   * @param qos 0 ~ 15, higher is more important. Otherwise nothing changes.
+   */
+  void SetQos(uint8_t qos);
+
+  /**
+   * @brief Set the AXI QoS used while the peripheral requests panic
+   *
+   * @param panic_qos 0 ~ 15. Otherwise nothing changes.
+   */
+  void SetPanicQos(uint8_t panic_qos);
+
+  /**
+   * @brief Convert a legacy peripheral bus address (0x7Exx_xxxx), e.g.
+   *        Pwm::GetFifoPhysicalAddress(), to the DMA4 view.
+   *
+   * @param bus_address
+   * @return uint64_t
+   */
+  static inline uint64_t GetPeripheralAddress(uint32_t bus_address) {
+    return kDma4PeripheralBusBase | bus_address;
+  }
+
+  /**
+   * @brief Convert a legacy memory bus address, e.g.
+   *        DmaMemory::GetPhysicalAddress(), to the ARM physical address that
+   *        DMA4 takes.
+   * @details DMA4 would read the 0xC0000000 alias as memory at 3 GiB.
+   *
+   * @param bus_address
+   * @return uint64_t
+   */
+  static inline uint64_t GetMemoryAddress(uint32_t bus_address) {
+    return bus_address & kDma4MemoryBusAliasMask;
+  }
+
+  /**
+   * @brief Configure a memory-to-memory copy
+   * @details When both addresses and the length are multiples of 16 bytes,
+   *          the copy uses 128-bit beats, otherwise 32-bit beats. Both are in
+   *          bursts of 8 beats.
+   *
+   * @param control_block Control block to configure
+   * @param src_physical Source physical address
+   * @param dest_physical Destination physical address
+   * @param length Transfer length in bytes, up to kMaxLength. Otherwise an
+   *        error is logged and the control block is not written.
+   */
+  static void ConfigureMemoryToMemory(Dma4ControlBlock* control_block,
+                                      uint64_t src_physical,
+                                      uint64_t dest_physical, uint32_t length);
+
+  /**
+   * @brief Configure a memory-to-peripheral transfer
+   *
+   * @param control_block Control block to configure
+   * @param src_physical Source physical address
+   * @param dest_address Peripheral address from GetPeripheralAddress()
+   * @param length Transfer length in bytes, up to kMaxLength
+   * @param dreq DREQ signal mapping
+   */
+  static void ConfigureMemoryToPeripheral(
+      Dma4ControlBlock* control_block, uint64_t src_physical,
+      uint64_t dest_address, uint32_t length,
+      Dma4RegisterMap::TI::PERMAP dreq);
+
+  /**
+   * @brief Configure a peripheral-to-memory transfer
+   *
+   * @param control_block Control block to configure
+   * @param src_address Peripheral address from GetPeripheralAddress()
+   * @param dest_physical Destination physical address
+   * @param length Transfer length in bytes, up to kMaxLength
+   * @param dreq DREQ signal mapping
+   */
+  static void ConfigurePeripheralToMemory(
+      Dma4ControlBlock* control_block, uint64_t src_address,
+      uint64_t dest_physical, uint32_t length,
+      Dma4RegisterMap::TI::PERMAP dreq);
+
+  /**
+   * @brief Link a control block to the next one
+   *
+   * @param control_block
+   * @param next_physical Physical address of the next control block, 32-byte
+   *        aligned. 0 ends the chain.
+   */
+  static void SetNextControlBlock(Dma4ControlBlock* control_block,
+                                  uint64_t next_physical);
+
+ private:
+  static constexpr Trace::Peripheral kTracePeripheral = Trace::Peripheral::kDma;
+  static constexpr size_t kFirstChannel = 11;
+
+  Dma4(Dma4RegisterMap* register_map, Channel channel);
+
+  static constexpr size_t kNumOfInstances = 4;
+  static InstanceRegistry<Dma4, kNumOfInstances> instances_;
+
+  Dma4RegisterMap* register_map_;
+  Channel channel_;
+  // Written by Start() together with ACTIVE
+  uint32_t qos_ = 0;
+  uint32_t panic_qos_ = 0;
+
+  PeripheralMetrics metrics_;
+  // When Start() was last called.
+  std::chrono::steady_clock::time_point start_time_;
+};
+
+}  // namespace rpl
+
+#endif  // RPL4_PERIPHERAL_DMA4_HPP_
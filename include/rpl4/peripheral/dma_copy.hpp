@@ -0,0 +1,137 @@
+#ifndef RPL4_PERIPHERAL_DMA_COPY_HPP_
+#define RPL4_PERIPHERAL_DMA_COPY_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "rpl4/peripheral/dma.hpp"
+#include "rpl4/system/metrics.hpp"
+
+namespace rpl {
+
+/**
+ * @brief Copies between buffers, by the CPU when they are short and by DMA
+ *        when they are long.
+ * @details Setting up a transfer and polling for its end cost more than a
+ *          short copy, so copies below the threshold are done by the CPU.
+ *          The threshold is where the DMA becomes faster, measured by
+ *          Calibrate() in Create() unless it is configured. Long copies are
+ *          split into one part per channel, which run at the same time. Only
+ *          buffers in DmaMemory have bus addresses, so copies involving
+ *          other memory are always done by the CPU.
+ * @note DmaMemory is uncached and is copied by the CPU word by word, without
+ *       memcpy, for the same reason as the note of DmaMemory.
+ */
+class DmaCopy {
+ public:
+  struct Config {
+    // Full channels, 0 ~ 6. Not the defaults of Ws2812, PwmAudio and
+    // SoftwarePwm.
+    std::vector<Dma::Channel> channels = {Dma::Channel::kChannel2,
+                                          Dma::Channel::kChannel3};
+    // Bytes from which DMA is used. 0 : measured by Calibrate()
+    size_t threshold = 0;
+    // A copy is split only into parts of at least this many bytes.
+    size_t min_split_size = 64 * 1024;
+    // Timeout of each DMA transfer
+    uint32_t timeout_ms = 1000;
+  };
+
+  /**
+   * @brief Allocate the control blocks and calibrate the threshold.
+   *
+   * @param config
+   * @return std::unique_ptr<DmaCopy> nullptr if RPL is not initialized, a
+   *         channel is invalid or DMA memory cannot be allocated.
+   */
+  static std::unique_ptr<DmaCopy> Create(const Config& config);
+
+  DmaCopy(const DmaCopy&) = delete;
+  DmaCopy& operator=(const DmaCopy&) = delete;
+
+  /**
+   * @brief Wait for the copy in flight and free the control blocks.
+   */
+  ~DmaCopy();
+
+  /**
+   * @brief Copy and wait for the end.
+   *
+   * @param dest
+   * @param src
+   * @param length Bytes
+   * @return false if a DMA transfer failed or timed out
+   */
+  bool Copy(void* dest, const void* src, size_t length);
+
+  /**
+   * @brief Start a copy without waiting for a DMA transfer.
+   * @details A copy done by the CPU has ended when this returns. A copy in
+   *          flight is waited for first. The buffers must not be touched
+   *          until Wait() returns.
+   *
+   * @param dest
+   * @param src
+   * @param length Bytes
+   * @return false if the previous copy failed
+   */
+  bool Start(void* dest, const void* src, size_t length);
+
+  /**
+   * @brief Wait for the copy started by Start().
+   *
+   * @return false if a DMA transfer failed or timed out
+   */
+  bool Wait();
+
+  /**
+   * @brief Check whether a DMA copy is still running, without waiting.
+   *
+   * @return bool
+   */
+  bool IsBusy();
+
+  /**
+   * @brief Measure the CPU and a single-channel DMA copy in DmaMemory at
+   *        sizes from 256 B to 256 KiB, and set the threshold to the first
+   *        size at which the DMA is faster, or to 256 KiB if it never is.
+   *
+   * @return size_t The new threshold. Unchanged if the measurement failed.
+   */
+  size_t Calibrate();
+
+  inline size_t GetThreshold() const { return threshold_; }
+  inline void SetThreshold(size_t threshold) { threshold_ = threshold; }
+
+  /**
+   * @brief Get the number of copies done by the CPU and by DMA.
+   */
+  inline uint64_t GetCpuCopyCount() const { return cpu_copies_.Get(); }
+  inline uint64_t GetDmaCopyCount() const { return dma_copies_.Get(); }
+
+ private:
+  DmaCopy(const Config& config, std::vector<Dma*> dmas);
+
+  bool AllocateControlBlocks();
+  // Start the parts on num_channels channels.
+  void StartDma(uint32_t dest_physical, uint32_t src_physical, size_t length,
+                size_t num_channels);
+  static void CopyByCpu(void* dest, const void* src, size_t length);
+
+  Config config_;
+  std::vector<Dma*> dmas_;
+  size_t threshold_;
+  DmaControlBlock* control_blocks_ = nullptr;
+  uint32_t control_blocks_physical_ = 0;
+  // Channels running the copy in flight
+  size_t num_in_flight_ = 0;
+
+  MetricsCounter cpu_copies_;
+  MetricsCounter dma_copies_;
+};
+
+}  // namespace rpl
+
+#endif  // RPL4_PERIPHERAL_DMA_COPY_HPP_
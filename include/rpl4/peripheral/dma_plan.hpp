@@ -0,0 +1,186 @@
+#ifndef RPL4_PERIPHERAL_DMA_PLAN_HPP_
+#define RPL4_PERIPHERAL_DMA_PLAN_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "rpl4/peripheral/dma.hpp"
+
+namespace rpl {
+
+/**
+ * @brief A chain of control blocks that is built once and launched many
+ *        times.
+ * @details The control blocks stay in DmaMemory with their bus addresses
+ *          resolved and linked in order, so Launch() is only the CONBLK_AD
+ *          write and Start(). Between launches the length and the addresses
+ *          of a control block can be patched with one store each. This suits
+ *          periodic transfers, e.g. reading a sensor every millisecond.
+ * @note Patching a control block while the plan is running changes the
+ *       running transfer if the DMA has not reached it yet. Wait() first.
+ */
+class DmaPlan {
+ public:
+  /**
+   * @brief Allocate a chain of control blocks, all empty transfers.
+   *
+   * @param channel DMA channel that runs the plan
+   * @param num_control_blocks
+   * @return std::unique_ptr<DmaPlan> nullptr if RPL is not initialized or
+   *         DMA memory cannot be allocated.
+   */
+  static std::unique_ptr<DmaPlan> Create(Dma::Channel channel,
+                                         size_t num_control_blocks);
+
+  DmaPlan(const DmaPlan&) = delete;
+  DmaPlan& operator=(const DmaPlan&) = delete;
+
+  /**
+   * @brief Wait for the launch in flight and free the chain.
+   */
+  ~DmaPlan();
+
+  inline size_t GetNumOfControlBlocks() const { return num_control_blocks_; }
+
+  /**
+   * @brief Set a control block to a memory-to-memory transfer.
+   *
+   * @param index Index of the control block
+   * @param dest Destination in DmaMemory
+   * @param src Source in DmaMemory
+   * @param length Transfer length in bytes
+   * @param options
+   * @return false if the index is invalid or a buffer is not in DmaMemory
+   */
+  bool SetMemoryToMemory(size_t index, void* dest, const void* src,
+                         uint32_t length,
+                         const Dma::TransferOptions& options =
+                             Dma::TransferOptions());
+
+  /**
+   * @brief Set a control block to a memory-to-peripheral transfer.
+   *
+   * @param index Index of the control block
+   * @param dest_physical Peripheral register, e.g.
+   *        Pwm::GetFifoPhysicalAddress()
+   * @param src Source in DmaMemory
+   * @param length Transfer length in bytes
+   * @param dreq DREQ signal mapping
+   * @param options
+   * @return false if the index is invalid or the buffer is not in DmaMemory
+   */
+  bool SetMemoryToPeripheral(size_t index, uint32_t dest_physical,
+                             const void* src, uint32_t length,
+                             DmaRegisterMap::TI::PERMAP dreq,
+                             const Dma::TransferOptions& options =
+                                 Dma::TransferOptions());
+
+  /**
+   * @brief Set a control block to a peripheral-to-memory transfer.
+   *
+   * @param index Index of the control block
+   * @param dest Destination in DmaMemory
+   * @param src_physical Peripheral register
+   * @param length Transfer length in bytes
+   * @param dreq DREQ signal mapping
+   * @param options
+   * @return false if the index is invalid or the buffer is not in DmaMemory
+   */
+  bool SetPeripheralToMemory(size_t index, void* dest, uint32_t src_physical,
+                             uint32_t length, DmaRegisterMap::TI::PERMAP dreq,
+                             const Dma::TransferOptions& options =
+                                 Dma::TransferOptions());
+
+  /**
+   * @brief Patch the length of a control block.
+   *
+   * @param index Index of the control block, not checked
+   * @param length Transfer length in bytes
+   */
+  inline void SetLength(size_t index, uint32_t length) {
+    control_blocks_[index].transfer_length = length;
+  }
+
+  /**
+   * @brief Patch the source of a control block with a resolved address.
+   *
+   * @param index Index of the control block, not checked
+   * @param src_physical e.g. from GetPhysicalAddress() called once
+   */
+  inline void SetSourceAddress(size_t index, uint32_t src_physical) {
+    control_blocks_[index].source_addr = src_physical;
+  }
+
+  /**
+   * @brief Patch the destination of a control block with a resolved address.
+   *
+   * @param index Index of the control block, not checked
+   * @param dest_physical
+   */
+  inline void SetDestinationAddress(size_t index, uint32_t dest_physical) {
+    control_blocks_[index].dest_addr = dest_physical;
+  }
+
+  /**
+   * @brief Patch the source of a control block with a pointer, which is
+   *        resolved by DmaMemory.
+   *
+   * @param index Index of the control block
+   * @param src Source in DmaMemory
+   * @return false if the index is invalid or the buffer is not in DmaMemory
+   */
+  bool SetSource(size_t index, const void* src);
+
+  /**
+   * @brief Patch the destination of a control block with a pointer.
+   *
+   * @param index Index of the control block
+   * @param dest Destination in DmaMemory
+   * @return false if the index is invalid or the buffer is not in DmaMemory
+   */
+  bool SetDestination(size_t index, void* dest);
+
+  /**
+   * @brief Start the chain from its first control block.
+   * @details A launch in flight is waited for first.
+   *
+   * @return false if the previous launch failed
+   */
+  bool Launch();
+
+  /**
+   * @brief Wait for the launch in flight.
+   *
+   * @param timeout_ms Timeout in milliseconds (0 = no timeout)
+   * @return false if the transfer failed or timed out. It is aborted then.
+   */
+  bool Wait(uint32_t timeout_ms = 0);
+
+  /**
+   * @brief Get the number of launches.
+   *
+   * @return uint64_t
+   */
+  inline uint64_t GetLaunchCount() const { return launches_.Get(); }
+
+ private:
+  DmaPlan(Dma* dma, size_t num_control_blocks);
+
+  bool Allocate();
+  bool IsValidIndex(size_t index, const char* method) const;
+  // Restore the link that Dma::Configure*() cleared.
+  void Link(size_t index);
+
+  Dma* dma_;
+  size_t num_control_blocks_;
+  DmaControlBlock* control_blocks_ = nullptr;
+  uint32_t control_blocks_physical_ = 0;
+  bool in_flight_ = false;
+
+  MetricsCounter launches_;
+};
+
+}  // namespace rpl
+
+#endif  // RPL4_PERIPHERAL_DMA_PLAN_HPP_
@@ -5,6 +5,9 @@
 #include <cstdint>
 #include <memory>
 
+#include "rpl4/system/instance_registry.hpp"
+#include "rpl4/system/metrics.hpp"
+
 namespace rpl {
 
 class Gpio {
@@ -35,12 +38,13 @@ class Gpio {
    * @brief Get the Gpio instance of specified pin.
    * @details To save memory, only the pin instance obtained with GetInstance()
    *          is created. If a pin instance has already been created, the same
-   *          instance will be returned.
+   *          instance will be returned. It is safe to call this concurrently;
+   *          the instance is created exactly once.
    *
    * @param pin GPIO pin number (0 ~ 57)
-   * @return std::shared_ptr<Gpio>
+   * @return Gpio* nullptr if RPL is not initialized.
    */
-  static std::shared_ptr<Gpio> GetInstance(uint8_t pin);
+  static Gpio* GetInstance(uint8_t pin);
 
   Gpio(const Gpio&) = delete;
   Gpio& operator=(const Gpio&) = delete;
@@ -97,6 +101,13 @@ class Gpio {
 
   bool operator=(bool output) { return Write(output); }
 
+  /**
+   * @brief Get the number of reads and writes of the pin.
+   *
+   * @return const PeripheralMetrics&
+   */
+  inline const PeripheralMetrics& GetMetrics() const { return metrics_; }
+
  private:
   /**
    * @brief Construct a new Gpio object
@@ -106,9 +117,10 @@ class Gpio {
   Gpio(uint8_t pin);
 
   static constexpr size_t kNumOfInstances = 58;
-  static std::array<std::shared_ptr<Gpio>, kNumOfInstances> instances_;
+  static InstanceRegistry<Gpio, kNumOfInstances> instances_;
 
   uint8_t pin_;
+  PeripheralMetrics metrics_;
 };
 
 }  // namespace rpl
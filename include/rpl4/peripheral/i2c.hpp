@@ -0,0 +1,150 @@
+#ifndef RPL4_PERIPHERAL_I2C_HPP_
+#define RPL4_PERIPHERAL_I2C_HPP_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+#include "rpl4/registers/registers_bsc.hpp"
+#include "rpl4/system/instance_registry.hpp"
+
+namespace rpl {
+
+class I2c {
+ public:
+  enum class Port : size_t {
+    kI2c0 = 0,
+    kI2c1 = 1,
+    kI2c3 = 2,
+    kI2c4 = 3,
+    kI2c5 = 4,
+    kI2c6 = 5,
+  };
+
+  /**
+   * @brief State of the transfer started with StartWrite() or StartRead().
+   */
+  enum class Status : uint8_t {
+    kIdle = 0,             // No transfer has been started.
+    kBusy,                 // The transfer is in progress.
+    kDone,                 // The transfer completed successfully.
+    kNack,                 // The slave did not acknowledge.
+    kClockStretchTimeout,  // The slave held SCL low for too long.
+    kInvalid,              // The transfer was not started: invalid length.
+  };
+
+  /**
+   * @brief Get the I2c instance of specified BSC controller.
+   * @details To save memory, only the port instance obtained with GetInstance()
+   *          is created. If a port instance has already been created, the same
+   *          instance will be returned. It is safe to call this concurrently;
+   *          the instance is created exactly once.
+   *
+   * @param port
+   * @return I2c* nullptr if RPL is not initialized.
+   */
+  static I2c* GetInstance(Port port);
+
+  I2c(const I2c&) = delete;
+  I2c& operator=(const I2c&) = delete;
+  I2c(I2c&&) = delete;
+  I2c& operator=(I2c&&) = delete;
+  ~I2c() = default;
+
+  /**
+   * @brief Get the BSC register pointer.
+   *
+   * @return BSC_Typedef*
+   */
+  inline BSC_Typedef* GetRegister() const { return register_map_; }
+
+  inline Port GetPort() const { return port_; }
+
+  /**
+   * @brief Specifies the SCL frequency.
+   *
+   * @param divider
+   *
+   * @note SCL frequency is core clock / divider. If 0 is set to divider, the
+   *       divisor is 32768. Odd numbers are rounded down.
+   */
+  inline void SetClockDivider(uint16_t divider) {
+    register_map_->DIV = static_cast<uint32_t>(divider);
+  }
+
+  /**
+   * @brief Specifies how many SCL cycles the slave may stretch the clock
+   *        before the transfer is aborted with kClockStretchTimeout.
+   *
+   * @param cycles 0 disables the timeout.
+   */
+  inline void SetClockStretchTimeout(uint16_t cycles) {
+    register_map_->CLKT = static_cast<uint32_t>(cycles);
+  }
+
+  /**
+   * @brief Start writing data_length bytes to the slave without waiting.
+   * @details The FIFO is pre-filled and the remaining bytes are pushed by
+   *          Poll(). transmit_buf must stay valid until Poll() returns a
+   *          value other than kBusy.
+   *
+   * @param address 7-bit slave address
+   * @param transmit_buf
+   * @param data_length Must be 1 ~ 65535, otherwise Poll() returns kInvalid
+   */
+  void StartWrite(uint8_t address, const uint8_t* transmit_buf,
+                  uint32_t data_length);
+
+  /**
+   * @brief Start reading data_length bytes from the slave without waiting.
+   * @details receive_buf must stay valid until Poll() returns a value other
+   *          than kBusy.
+   *
+   * @param address 7-bit slave address
+   * @param receive_buf
+   * @param data_length Must be 1 ~ 65535, otherwise Poll() returns kInvalid
+   */
+  void StartRead(uint8_t address, uint8_t* receive_buf, uint32_t data_length);
+
+  /**
+   * @brief Service the FIFO of the current transfer once.
+   *
+   * @return Status kBusy while the transfer is in progress.
+   */
+  Status Poll();
+
+  /**
+   * @brief Whether a transfer started with StartWrite() or StartRead() is
+   *        still in progress.
+   */
+  inline bool IsBusy() const { return status_ == Status::kBusy; }
+
+  Status WriteBlocking(uint8_t address, const uint8_t* transmit_buf,
+                       uint32_t data_length);
+
+  Status ReadBlocking(uint8_t address, uint8_t* receive_buf,
+                      uint32_t data_length);
+
+ private:
+  I2c(BSC_Typedef* register_map, Port port);
+
+  static constexpr size_t kNumOfInstances = 6;
+  static InstanceRegistry<I2c, kNumOfInstances> instances_;
+
+  BSC_Typedef* register_map_;
+  Port port_;
+
+  // State of the transfer in progress.
+  Status status_ = Status::kIdle;
+  const uint8_t* transmit_buf_ = nullptr;
+  uint8_t* receive_buf_ = nullptr;
+  uint32_t data_length_ = 0;
+  uint32_t data_index_ = 0;
+
+  void FillTxFifo();
+  void DrainRxFifo();
+};
+
+}  // namespace rpl
+
+#endif  // RPL4_PERIPHERAL_I2C_HPP_
@@ -0,0 +1,121 @@
+#ifndef RPL4_PERIPHERAL_I2C_SCHEDULER_HPP_
+#define RPL4_PERIPHERAL_I2C_SCHEDULER_HPP_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "rpl4/peripheral/i2c.hpp"
+
+namespace rpl {
+
+/**
+ * @brief Runs periodic I2C read/write jobs on several BSC controllers in
+ *        parallel.
+ * @details Each controller has its own queue. Poll() services every busy
+ *          controller once and starts the next queued job on a controller as
+ *          soon as the previous one has finished, so that the controllers
+ *          shift data concurrently and one polling cycle takes as long as the
+ *          busiest bus instead of the sum of all buses.
+ */
+class I2cScheduler {
+ public:
+  using JobId = size_t;
+
+  enum class JobType : uint8_t {
+    kWrite,      // Write transmit_buf.
+    kRead,       // Read into receive_buf.
+    kWriteRead,  // Write transmit_buf, then read into receive_buf.
+  };
+
+  struct Job {
+    I2c::Port port;
+    uint8_t address;  // 7-bit slave address
+    JobType type;
+    const uint8_t* transmit_buf;
+    uint32_t transmit_length;
+    uint8_t* receive_buf;
+    uint32_t receive_length;
+    // The job is queued again this long after it was last queued. 0 queues
+    // the job on every Poll().
+    std::chrono::microseconds period;
+  };
+
+  struct Statistics {
+    uint32_t transfers = 0;               // Successfully completed jobs
+    uint32_t nacks = 0;                   // Jobs aborted by a NACK
+    uint32_t clock_stretch_timeouts = 0;  // Jobs aborted by CLKT
+    // The job was due again while it was still queued or in flight.
+    uint32_t overruns = 0;
+    // Time from being queued to completion.
+    std::chrono::nanoseconds last_latency{0};
+    std::chrono::nanoseconds min_latency{std::chrono::nanoseconds::max()};
+    std::chrono::nanoseconds max_latency{0};
+    std::chrono::nanoseconds total_latency{0};
+  };
+
+  I2cScheduler() = default;
+  I2cScheduler(const I2cScheduler&) = delete;
+  I2cScheduler& operator=(const I2cScheduler&) = delete;
+
+  /**
+   * @brief Register a job. The job is due immediately.
+   * @details A job with a length outside 1 ~ 65535 is logged, and its
+   *          transfers end with I2c::Status::kInvalid without being counted.
+   *
+   * @param job The buffers must stay valid while the scheduler is used.
+   * @return JobId Used to look up the statistics of the job.
+   */
+  JobId AddJob(const Job& job);
+
+  /**
+   * @brief Queue the due jobs and service every controller once without
+   *        blocking.
+   *
+   * @return true if any job is still queued or in flight.
+   */
+  bool Poll();
+
+  /**
+   * @brief Queue the due jobs and poll until all of them have finished.
+   */
+  void RunCycle();
+
+  const Statistics& GetStatistics(JobId id) const { return jobs_[id].stats; }
+
+  void ResetStatistics();
+
+ private:
+  static constexpr size_t kNumOfPorts = 6;
+
+  struct JobState {
+    Job job;
+    Statistics stats;
+    std::chrono::steady_clock::time_point next_due;
+    std::chrono::steady_clock::time_point queued_at;
+    bool pending = false;
+    bool write_phase_done = false;
+  };
+
+  struct Bus {
+    I2c* i2c = nullptr;
+    std::deque<JobId> queue;
+    bool active = false;
+  };
+
+  std::vector<JobState> jobs_;
+  std::array<Bus, kNumOfPorts> buses_;
+
+  void QueueDueJobs(std::chrono::steady_clock::time_point now);
+  // Returns true if any job is still queued or in flight.
+  bool Service();
+  void StartJob(Bus& bus, JobState& state);
+  void FinishJob(Bus& bus, JobState& state, I2c::Status status);
+};
+
+}  // namespace rpl
+
+#endif  // RPL4_PERIPHERAL_I2C_SCHEDULER_HPP_
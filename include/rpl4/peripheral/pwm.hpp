@@ -2,10 +2,16 @@
 #define RPL4_PERIPHERAL_PWM_HPP_
 
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <memory>
 
+#include "rpl4/registers/registers_dma.hpp"
 #include "rpl4/registers/registers_pwm.hpp"
+#include "rpl4/registers/shadow_register.hpp"
+#include "rpl4/system/instance_registry.hpp"
+#include "rpl4/system/metrics.hpp"
+#include "rpl4/system/trace.hpp"
 
 namespace rpl {
 
@@ -25,12 +31,13 @@ class Pwm {
    * @brief Get the Pwm instance of specified port.
    * @details To save memory, only the port instance obtained with GetInstance()
    *          is created. If a port instance has already been created, the same
-   *          instance will be returned.
+   *          instance will be returned. It is safe to call this concurrently;
+   *          the instance is created exactly once.
    *
    * @param port PWM port
-   * @return std::shared_ptr<Pwm>
+   * @return Pwm* nullptr if RPL is not initialized.
    */
-  static std::shared_ptr<Pwm> GetInstance(Port port);
+  static Pwm* GetInstance(Port port);
 
   Pwm(const Pwm&) = delete;
   Pwm& operator=(const Pwm&) = delete;
@@ -40,6 +47,8 @@ class Pwm {
 
   /**
    * @brief Get the PwmRegisterMap pointer.
+   * @note CTL, DMAC and the ranges are cached. Writing them through the
+   *       register map is not seen by this class.
    *
    * @return PwmRegisterMap*
    */
@@ -53,13 +62,55 @@ class Pwm {
    */
   static bool ConfigureGpioPin(uint8_t pin);
 
+  /**
+   * @brief Configure GPIO pin for the output of one channel
+   *
+   * @param port PWM port
+   * @param channel PWM channel
+   * @param pin GPIO pin number
+   * @return false if the pin has no function of that channel
+   */
+  static bool ConfigureGpioPin(Port port, Channel channel, uint8_t pin);
+
+  /**
+   * @brief Get the PWM channel a GPIO pin can output.
+   *
+   * @param pin GPIO pin number
+   * @param port Set to the port of the pin
+   * @param channel Set to the channel of the pin
+   * @return false if the pin has no PWM function
+   */
+  static bool GetGpioPinChannel(uint8_t pin, Port* port, Channel* channel);
+
   /**
    * @brief Initialize PWM clock
+   * @details The source and the divisor are chosen by ClockManager. GetRange
+   *          based settings such as SetFrequency() use the frequency actually
+   *          generated. Both ports run from this clock, so changing it also
+   *          retimes the other port.
    *
    * @param frequency Clock frequency in Hz
    */
   void InitializeClock(double frequency);
 
+  /**
+   * @brief Get the frequency of the PWM clock actually generated.
+   *
+   * @return double Hz
+   */
+  inline double GetClockFrequency() const {
+    return clock_frequency_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Check if a channel of the other port is enabled.
+   * @details The clock is shared, so it should not be changed while the
+   *          other port is running.
+   *
+   * @return true if the other port is in use
+   */
+  bool IsClockUsedByOtherPort() const;
+
   /**
    * @brief Enable PWM channel
    *
@@ -74,6 +125,14 @@ class Pwm {
    */
   void Disable(Channel channel);
 
+  /**
+   * @brief Check if PWM channel is enabled
+   *
+   * @param channel PWM channel
+   * @return true if enabled
+   */
+  bool IsEnabled(Channel channel) const;
+
   /**
    * @brief Set PWM frequency
    *
@@ -84,14 +143,38 @@ class Pwm {
 
   /**
    * @brief Set PWM duty cycle
+   * @details The duty is applied to the cached range, so nothing is read from
+   *          the device.
    *
    * @param channel PWM channel
    * @param duty Duty cycle (0.0 to 1.0)
    */
   void SetDutyCycle(Channel channel, double duty);
 
+  /**
+   * @brief Set PWM duty cycle in Q16 fixed point
+   * @details Integer only, for control loops that update the duty at a high
+   *          rate. One store to DAT and no read from the device.
+   *
+   * @param channel PWM channel
+   * @param duty 0 : 0%, 65536 : 100%. Larger values are 100%.
+   */
+  void SetDutyCycleQ16(Channel channel, uint32_t duty);
+
+  /**
+   * @brief Set PWM frequency and duty cycle together
+   * @details Calculated as SetFrequency() and SetDutyCycle() and written with
+   *          SetRangeAndData().
+   *
+   * @param channel PWM channel
+   * @param frequency Frequency in Hz
+   * @param duty Duty cycle (0.0 to 1.0)
+   */
+  void SetFrequencyAndDuty(Channel channel, double frequency, double duty);
+
   /**
    * @brief Set PWM range (period)
+   * @details The range is cached for the duty cycle settings.
    *
    * @param channel PWM channel
    * @param range Range value
@@ -106,13 +189,24 @@ class Pwm {
    */
   void SetData(Channel channel, uint32_t data);
 
+  /**
+   * @brief Set PWM range and data in raw counts
+   * @details RNG is written before DAT, each with one store and no load.
+   *
+   * @param channel PWM channel
+   * @param range Range value
+   * @param data Data value
+   */
+  void SetRangeAndData(Channel channel, uint32_t range, uint32_t data);
+
   /**
    * @brief Get PWM range
+   * @details Returns the cached value without reading the device.
    *
    * @param channel PWM channel
    * @return Range value
    */
-  uint32_t GetRange(Channel channel);
+  uint32_t GetRange(Channel channel) const;
 
   /**
    * @brief Get PWM data
@@ -162,6 +256,7 @@ class Pwm {
 
   /**
    * @brief Clear PWM FIFO
+   * @details Each port has one FIFO, shared by its two channels.
    */
   void ClearFifo();
 
@@ -172,6 +267,32 @@ class Pwm {
    */
   void WriteFifo(uint32_t data);
 
+  /**
+   * @brief Write words to FIFO in bursts without blocking
+   * @details STA is read once per burst. When it shows the FIFO empty, up to
+   *          the FIFO depth of 8 words are written without another read,
+   *          otherwise one word if the FIFO is not full. Gaps and errors
+   *          seen in these reads are counted and cleared as by
+   *          CheckFifoStatus().
+   *
+   * @param data Words to write
+   * @param count Number of words
+   * @return size_t Number of words written. Less than count if the FIFO
+   *         became full.
+   */
+  size_t WriteFifo(const uint32_t* data, size_t count);
+
+  /**
+   * @brief Get the number of batch writes that found the FIFO empty after
+   *        an earlier one had filled it.
+   * @details The FIFO ran dry between the writes. Together with the gap
+   *          counter of GetMetrics() this shows a CPU-fed stream that is not
+   *          fed fast enough. ClearFifo() starts a new stream.
+   *
+   * @return uint64_t
+   */
+  inline uint64_t GetFifoEmptyCount() const { return fifo_empty_.Get(); }
+
   /**
    * @brief Check if FIFO is full
    *
@@ -206,15 +327,61 @@ class Pwm {
    */
   uint32_t GetFifoPhysicalAddress() const;
 
+  /**
+   * @brief Get the DREQ of this port for DMA control blocks
+   *
+   * @return DmaRegisterMap::TI::PERMAP kPwm0 or kPwm1
+   */
+  inline DmaRegisterMap::TI::PERMAP GetDreq() const {
+    return port_ == Port::kPwm0 ? DmaRegisterMap::TI::PERMAP::kPwm0
+                                : DmaRegisterMap::TI::PERMAP::kPwm1;
+  }
+
+  /**
+   * @brief Count and clear the FIFO gap and error flags.
+   * @details STA is read once. A gap on channel 1 or 2 means the FIFO ran
+   *          empty while the channel was transmitting, and is counted as an
+   *          underflow. FIFO read, write and bus errors are counted as
+   *          errors. The flags that were set are cleared with one store.
+   *          Call this periodically while feeding the FIFO.
+   *
+   * @return true if no gap or error occurred since the last call
+   */
+  bool CheckFifoStatus();
+
+  /**
+   * @brief Get the counters of FIFO writes, underflows and errors.
+   *
+   * @return const PeripheralMetrics&
+   */
+  inline const PeripheralMetrics& GetMetrics() const { return metrics_; }
+
  private:
+  static constexpr Trace::Peripheral kTracePeripheral = Trace::Peripheral::kPwm;
+
   Pwm(PwmRegisterMap* register_map, Port port);
 
+  // Count and clear the gap and error flags of STA.
+  bool CountFifoFlags(uint32_t status);
+
   static constexpr size_t kNumOfInstances = 2;
-  static std::array<std::shared_ptr<Pwm>, kNumOfInstances> instances_;
+  // Words in the FIFO of a port
+  static constexpr size_t kFifoDepth = 8;
+  static InstanceRegistry<Pwm, kNumOfInstances> instances_;
 
   PwmRegisterMap* register_map_;
   Port port_;
-  double clock_frequency_;
+  // Cached configuration registers. Each setting is one store and no read.
+  ShadowRegister<PwmRegisterMap::CTL> ctl_;
+  ShadowRegister<PwmRegisterMap::DMAC> dmac_;
+  // Ranges of channel 1 and 2, so that a duty setting does not read RNG.
+  std::array<uint32_t, 2> ranges_;
+  // Both ports share one clock.
+  static std::atomic<double> clock_frequency_;
+  PeripheralMetrics metrics_;
+  MetricsCounter fifo_empty_;
+  // Whether a batch write has filled the FIFO since it was cleared
+  bool fifo_streaming_ = false;
   static constexpr double kDefaultClockFrequency = 25000000.0;  // 25 MHz
 };
 
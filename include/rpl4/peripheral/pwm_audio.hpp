@@ -0,0 +1,211 @@
+#ifndef RPL4_PERIPHERAL_PWM_AUDIO_HPP_
+#define RPL4_PERIPHERAL_PWM_AUDIO_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "rpl4/peripheral/dma.hpp"
+#include "rpl4/peripheral/pwm.hpp"
+#include "rpl4/system/metrics.hpp"
+
+namespace rpl {
+
+/**
+ * @brief Converts interleaved stereo PCM into PWM FIFO words.
+ * @details The samples are resampled by linear interpolation when the input
+ *          and output rates differ, and quantized to 0 ~ range. All the
+ *          arithmetic is in 32/64-bit integers with the sample in 1/65536 of
+ *          an output step. Dithering adds triangular noise of +-1 step, and
+ *          noise shaping also feeds the quantization error back through
+ *          (1 - z^-1)^2, which moves the noise above the audible band. The
+ *          error feedback is a recurrence in time, so the two channels are
+ *          processed together in one branch-free loop body instead of
+ *          vectorising across samples.
+ */
+class PwmAudioConverter {
+ public:
+  enum class Shaping : uint8_t {
+    kRound,         // Round to the nearest step
+    kDither,        // TPDF dither
+    kNoiseShaping,  // TPDF dither and 2nd order noise shaping
+  };
+
+  /**
+   * @param range PWM range, 16 ~ 4096
+   * @param shaping
+   * @param input_rate Sample rate of the input in Hz
+   * @param output_rate Sample rate of the PWM in Hz
+   */
+  PwmAudioConverter(uint32_t range, Shaping shaping, double input_rate,
+                    double output_rate);
+
+  /**
+   * @brief Convert as many frames as fit in the output.
+   *
+   * @param input Interleaved left and right samples
+   * @param num_input_frames
+   * @param output Interleaved left and right PWM values
+   * @param num_output_frames
+   * @param consumed Set to the number of input frames used
+   * @return size_t Number of output frames written
+   */
+  size_t Convert(const int16_t* input, size_t num_input_frames,
+                 uint32_t* output, size_t num_output_frames, size_t* consumed);
+
+  /**
+   * @brief Convert float samples in -1.0 ~ 1.0. Values outside are clipped.
+   */
+  size_t Convert(const float* input, size_t num_input_frames,
+                 uint32_t* output, size_t num_output_frames, size_t* consumed);
+
+  inline uint32_t GetRange() const { return range_; }
+
+ private:
+  template <typename Sample>
+  size_t ConvertFrames(const Sample* input, size_t num_input_frames,
+                       uint32_t* output, size_t num_output_frames,
+                       size_t* consumed);
+
+  // Quantize one sample of -32768 ~ 32767.
+  inline uint32_t Quantize(size_t channel, int32_t sample);
+
+  uint32_t range_;
+  Shaping shaping_;
+  // Input frames per output frame in Q16. 65536 : no resampling
+  uint32_t step_;
+  // Position between previous_ and next_ in Q16
+  uint32_t phase_ = 65536;
+  int32_t previous_[2] = {0, 0};
+  int32_t next_[2] = {0, 0};
+  // Last two quantization errors of each channel in 1/65536 step
+  int32_t error_[2][2] = {{0, 0}, {0, 0}};
+  // Set from shaping_ so that the loop does not branch on it
+  uint32_t dither_mask_;  // 0 or 0xffffffff
+  int32_t feedback_;      // 0 or 1
+  uint32_t random_ = 0x12345678;
+};
+
+/**
+ * @brief Stereo audio output through both channels of a PWM port.
+ * @details Both channels read the FIFO, so the FIFO words alternate between
+ *          left and right. A ring of periods in DmaMemory is fed to the FIFO
+ *          by a ring of control blocks, so the DMA runs without the CPU.
+ *          Write() converts the samples straight into the free periods of
+ *          the ring and sleeps while the ring is full. Played periods are
+ *          refilled with silence, so an underrun plays silence instead of
+ *          stale audio, and is counted in GetUnderruns().
+ * @note Write() has to be called at least once per ring length (periods *
+ *       period frames) while playing, to follow the DMA position. The PWM
+ *       clock is shared by PWM0 and PWM1. If the other port is already
+ *       running, its clock is kept and the range is chosen to fit the sample
+ *       rate.
+ */
+class PwmAudio {
+ public:
+  struct Config {
+    // PWM1 drives the headphone jack of the Raspberry Pi 4 on GPIO 40 and 41.
+    Pwm::Port port = Pwm::Port::kPwm1;
+    uint8_t left_pin = 40;
+    uint8_t right_pin = 41;
+    Dma::Channel dma_channel = Dma::Channel::kChannel4;
+    // Sample rate of the samples passed to Write()
+    double sample_rate = 48000.0;
+    // PWM steps per sample. The PWM clock is sample_rate * range, unless the
+    // other port is already running.
+    uint32_t range = 2048;
+    size_t period_frames = 512;
+    size_t num_periods = 4;
+    PwmAudioConverter::Shaping shaping =
+        PwmAudioConverter::Shaping::kNoiseShaping;
+  };
+
+  /**
+   * @brief Set up the PWM, the DMA ring and start playing silence.
+   *
+   * @param config
+   * @return std::unique_ptr<PwmAudio> nullptr if RPL is not initialized, a
+   *         setting is invalid or DMA memory cannot be allocated.
+   */
+  static std::unique_ptr<PwmAudio> Create(const Config& config);
+
+  PwmAudio(const PwmAudio&) = delete;
+  PwmAudio& operator=(const PwmAudio&) = delete;
+
+  /**
+   * @brief Stop the output and free the ring.
+   */
+  ~PwmAudio();
+
+  /**
+   * @brief Get the sample rate generated by the PWM clock.
+   *
+   * @return double Hz
+   */
+  inline double GetOutputSampleRate() const { return output_rate_; }
+
+  /**
+   * @brief Queue frames, blocking while the ring is full.
+   *
+   * @param frames Interleaved left and right samples
+   * @param num_frames
+   */
+  void Write(const int16_t* frames, size_t num_frames);
+
+  void Write(const float* frames, size_t num_frames);
+
+  /**
+   * @brief Wait until all the queued frames have been played.
+   */
+  void Drain();
+
+  /**
+   * @brief Get the number of periods that were played before they had been
+   *        written.
+   *
+   * @return uint64_t
+   */
+  inline uint64_t GetUnderruns() const { return underruns_.Get(); }
+
+ private:
+  PwmAudio(const Config& config, Pwm* pwm, Dma* dma, double output_rate);
+
+  bool AllocateRing();
+  void SetUpPwm();
+
+  template <typename Sample>
+  void WriteFrames(const Sample* frames, size_t num_frames);
+
+  // Follow the DMA position, silence the periods played since the last call
+  // and detect underruns.
+  void Update();
+  void FillSilence(size_t slot);
+  inline uint32_t* GetPeriod(size_t slot) {
+    return words_ + slot * config_.period_frames * 2;
+  }
+  void Sleep();
+
+  Config config_;
+  Pwm* pwm_;
+  Dma* dma_;
+  double output_rate_;
+  PwmAudioConverter converter_;
+  MetricsCounter underruns_;
+
+  uint32_t* words_ = nullptr;
+  DmaControlBlock* control_blocks_ = nullptr;
+  uint32_t control_blocks_physical_ = 0;
+
+  // Number of the period being played, counted from the start
+  uint64_t played_ = 0;
+  // Number of the period being written
+  uint64_t written_ = 1;
+  // Frames already written in that period
+  size_t write_offset_ = 0;
+  // Whether Write() has been called since the last Drain()
+  bool streaming_ = false;
+};
+
+}  // namespace rpl
+
+#endif  // RPL4_PERIPHERAL_PWM_AUDIO_HPP_
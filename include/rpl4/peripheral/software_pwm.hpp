@@ -0,0 +1,164 @@
+#ifndef RPL4_PERIPHERAL_SOFTWARE_PWM_HPP_
+#define RPL4_PERIPHERAL_SOFTWARE_PWM_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "rpl4/peripheral/dma.hpp"
+#include "rpl4/peripheral/pwm.hpp"
+
+namespace rpl {
+
+/**
+ * @brief PWM on any GPIO pin, generated by one cyclic DMA chain.
+ * @details The period is divided into steps. For each step the chain has
+ *          three control blocks: one writes the set masks to GPSET0/1, one
+ *          writes the clear masks to GPCLR0/1, and one writes a word to the
+ *          FIFO of a PWM port, which paces the chain at one word per step.
+ *          Every pin of a channel is set at step 0 and cleared at the step of
+ *          its pulse width. Changing a width edits mask words in place, so
+ *          the chain is never rebuilt and the CPU is not involved while the
+ *          pulses run.
+ * @note The FIFO of the pacing port is used by the chain, so that port cannot
+ *       drive a Ws2812 or PwmAudio at the same time. If the other port is
+ *       running, its clock is kept and the step is rounded to it.
+ */
+class SoftwarePwm {
+ public:
+  struct Config {
+    // Port whose FIFO paces the chain. No pin of it is used.
+    Pwm::Port pacing_port = Pwm::Port::kPwm0;
+    Dma::Channel dma_channel = Dma::Channel::kChannel6;
+    // Resolution of the pulse widths, 1 ~ 10 us
+    double step_us = 5.0;
+    // 20 ms is the frame of hobby servos.
+    double period_us = 20000.0;
+  };
+
+  /**
+   * @brief Set up the pacing PWM and start the DMA chain with all the
+   *        channels off.
+   *
+   * @param config
+   * @return std::unique_ptr<SoftwarePwm> nullptr if RPL is not initialized, a
+   *         setting is invalid or DMA memory cannot be allocated.
+   */
+  static std::unique_ptr<SoftwarePwm> Create(const Config& config);
+
+  SoftwarePwm(const SoftwarePwm&) = delete;
+  SoftwarePwm& operator=(const SoftwarePwm&) = delete;
+
+  /**
+   * @brief Stop the chain, drive the channel pins low and free the chain.
+   */
+  ~SoftwarePwm();
+
+  /**
+   * @brief Get the number of steps in a period.
+   *
+   * @return uint32_t
+   */
+  inline uint32_t GetNumOfSteps() const { return num_steps_; }
+
+  /**
+   * @brief Get the duration of a step after rounding to the PWM clock.
+   *
+   * @return double us
+   */
+  inline double GetStepTime() const { return step_us_; }
+
+  /**
+   * @brief Make a pin an output driven by the chain, starting low.
+   *
+   * @param pin GPIO pin number, 0 ~ 57
+   * @return false if the pin number is invalid
+   */
+  bool AddChannel(uint8_t pin);
+
+  /**
+   * @brief Stop driving a pin. It is left low and an output.
+   *
+   * @param pin GPIO pin number
+   */
+  void RemoveChannel(uint8_t pin);
+
+  /**
+   * @brief Set the pulse width in steps.
+   * @details Takes effect from the next period. A period that is running
+   *          while the width changes ends at the old or the new width, never
+   *          later.
+   *
+   * @param pin GPIO pin number added by AddChannel()
+   * @param steps 0 : always low, GetNumOfSteps() or more : always high
+   * @return false if the pin has not been added
+   */
+  bool SetPulseSteps(uint8_t pin, uint32_t steps);
+
+  /**
+   * @brief Set the pulse width in microseconds, rounded to a step.
+   *
+   * @param pin GPIO pin number added by AddChannel()
+   * @param width_us e.g. 1000 ~ 2000 for a servo
+   * @return false if the pin has not been added
+   */
+  bool SetPulseWidth(uint8_t pin, double width_us);
+
+  /**
+   * @brief Set the duty cycle, rounded to a step.
+   *
+   * @param pin GPIO pin number added by AddChannel()
+   * @param duty 0.0 ~ 1.0
+   * @return false if the pin has not been added
+   */
+  bool SetDutyCycle(uint8_t pin, double duty);
+
+  /**
+   * @brief Get the pulse width in steps.
+   *
+   * @param pin GPIO pin number
+   * @return uint32_t 0 if the pin has not been added
+   */
+  uint32_t GetPulseSteps(uint8_t pin) const;
+
+ private:
+  static constexpr size_t kNumOfPins = 58;
+  // Words of one step: GPSET0, GPSET1, GPCLR0, GPCLR1
+  static constexpr size_t kWordsPerStep = 4;
+  static constexpr size_t kControlBlocksPerStep = 3;
+
+  struct Channel {
+    bool added = false;
+    uint32_t steps = 0;
+  };
+
+  SoftwarePwm(const Config& config, Pwm* pwm, Dma* dma, uint32_t num_steps,
+              double step_us);
+
+  bool AllocateChain();
+  void SetUpPwm(uint32_t range);
+
+  // Set or clear the bit of a pin in the set or clear mask of a step. Only a
+  // change is stored to DmaMemory.
+  void UpdateMask(uint32_t step, bool clear_mask, uint8_t pin, bool value);
+
+  Config config_;
+  Pwm* pwm_;
+  Dma* dma_;
+  uint32_t num_steps_;
+  double step_us_;
+  std::array<Channel, kNumOfPins> channels_;
+
+  // Masks in DmaMemory, read by the chain, followed by the pacing word. The
+  // copy in normal memory makes an update only stores to DmaMemory, in
+  // program order.
+  volatile uint32_t* masks_ = nullptr;
+  std::vector<uint32_t> shadow_masks_;
+  DmaControlBlock* control_blocks_ = nullptr;
+};
+
+}  // namespace rpl
+
+#endif  // RPL4_PERIPHERAL_SOFTWARE_PWM_HPP_
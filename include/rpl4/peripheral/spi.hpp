@@ -5,7 +5,12 @@
 #include <memory>
 
 #include "rpl4/peripheral/spi_base.hpp"
+#include "rpl4/registers/fields_spi.hpp"
 #include "rpl4/registers/registers_spi.hpp"
+#include "rpl4/registers/shadow_register.hpp"
+#include "rpl4/system/instance_registry.hpp"
+#include "rpl4/system/metrics.hpp"
+#include "rpl4/system/trace.hpp"
 
 namespace rpl {
 
@@ -23,12 +28,13 @@ class Spi : public SpiBase {
    * @brief Get the Spi instance of specified spi port.
    * @details To save memory, only the port instance obtained with GetInstance()
    *          is created. If a port instance has already been created, the same
-   *          instance will be returned.
+   *          instance will be returned. It is safe to call this concurrently;
+   *          the instance is created exactly once.
    *
    * @param port
-   * @return std::shared_ptr<Spi>
+   * @return Spi* nullptr if RPL is not initialized.
    */
-  static std::shared_ptr<Spi> GetInstance(Port port);
+  static Spi* GetInstance(Port port);
 
   Spi(const Spi&) = delete;
   Spi& operator=(const Spi&) = delete;
@@ -38,6 +44,8 @@ class Spi : public SpiBase {
 
   /**
    * @brief Get the SpiRegisterMap pointer.
+   * @note CS, CLK and DC are cached. Writing their settings through the
+   *       register map is not seen by the getters of this class.
    *
    * @return SpiRegisterMap*
    */
@@ -61,7 +69,8 @@ class Spi : public SpiBase {
 
   using ChipSelect = SpiRegisterMap::CS::CS_;
   inline void SetChipSelectForCommunication(ChipSelect chip_select) {
-    register_map_->cs.cs = chip_select;
+    cs_->cs = chip_select;
+    cs_.CommitChanged();
   }
 
   using ClockPhase = SpiRegisterMap::CS::CPHA;
@@ -75,7 +84,8 @@ class Spi : public SpiBase {
    *    the receiver should sample the data bit on the second edge of SCLK.
    */
   inline void SetClockPhase(ClockPhase clock_phase) {
-    register_map_->cs.cpha = clock_phase;
+    cs_->cpha = clock_phase;
+    cs_.CommitChanged();
   }
 
   /**
@@ -87,7 +97,7 @@ class Spi : public SpiBase {
    *    If kMiddle is set, SCLK transitions in the middle of the data bit, and
    *    the receiver should sample the data bit on the second edge of SCLK.
    */
-  inline ClockPhase GetClockPhase() { return register_map_->cs.cpha; }
+  inline ClockPhase GetClockPhase() { return cs_->cpha; }
 
   using ClockPolarity = SpiRegisterMap::CS::CPOL;
   /**
@@ -96,7 +106,8 @@ class Spi : public SpiBase {
    * @param clock_polarity
    */
   inline void SetClockPolarity(ClockPolarity clock_polarity) {
-    register_map_->cs.cpol = clock_polarity;
+    cs_->cpol = clock_polarity;
+    cs_.CommitChanged();
   }
 
   /**
@@ -106,7 +117,7 @@ class Spi : public SpiBase {
    *    If kLow is set, SCLK is low in the idle state.
    *    If kHigh is set, SCLK is high in the idle state.
    */
-  inline ClockPolarity GetClockPolarity() { return register_map_->cs.cpol; }
+  inline ClockPolarity GetClockPolarity() { return cs_->cpol; }
 
   using CsPolarity = SpiRegisterMap::CS::CSPOL;
   /**
@@ -115,7 +126,8 @@ class Spi : public SpiBase {
    * @param cs_polarity
    */
   inline void SetCs0Polarity(CsPolarity cs_polarity) {
-    register_map_->cs.cspol0 = cs_polarity;
+    cs_->cspol0 = cs_polarity;
+    cs_.CommitChanged();
   }
 
   /**
@@ -124,7 +136,8 @@ class Spi : public SpiBase {
    * @param cs_polarity
    */
   inline void SetCs1Polarity(CsPolarity cs_polarity) {
-    register_map_->cs.cspol1 = cs_polarity;
+    cs_->cspol1 = cs_polarity;
+    cs_.CommitChanged();
   }
 
   /**
@@ -133,15 +146,20 @@ class Spi : public SpiBase {
    * @param cs_polarity
    */
   inline void SetCs2Polarity(CsPolarity cs_polarity) {
-    register_map_->cs.cspol2 = cs_polarity;
+    cs_->cspol2 = cs_polarity;
+    cs_.CommitChanged();
   }
 
   inline void EnableDma() {
     register_map_->cs.dmaen = SpiRegisterMap::CS::DMAEN::kEnable;
+    Trace::CountRead(kTracePeripheral);
+    Trace::CountWrite(kTracePeripheral);
   }
 
   inline void DisableDma() {
     register_map_->cs.dmaen = SpiRegisterMap::CS::DMAEN::kDisable;
+    Trace::CountRead(kTracePeripheral);
+    Trace::CountWrite(kTracePeripheral);
   }
 
   /**
@@ -155,43 +173,71 @@ class Spi : public SpiBase {
    *       will be 5MHz.
    */
   inline void SetClockDivider(uint16_t divider) {
-    register_map_->clk.cdiv = static_cast<uint32_t>(divider);
+    clk_->cdiv = static_cast<uint32_t>(divider);
+    clk_.Commit();
   }
 
   inline void ClearTxFifo() {
     register_map_->cs.clear = SpiRegisterMap::CS::CLEAR::kClearTxFifo;
+    Trace::CountRead(kTracePeripheral);
+    Trace::CountWrite(kTracePeripheral);
   }
 
   inline void ClearRxFifo() {
     register_map_->cs.clear = SpiRegisterMap::CS::CLEAR::kClearRxFifo;
+    Trace::CountRead(kTracePeripheral);
+    Trace::CountWrite(kTracePeripheral);
   }
 
   inline void ClearTxAndRxFifo() {
     register_map_->cs.clear = SpiRegisterMap::CS::CLEAR::kClearBothFifo;
+    Trace::CountRead(kTracePeripheral);
+    Trace::CountWrite(kTracePeripheral);
   }
 
   inline void StartTransmission() {
     register_map_->cs.ta = SpiRegisterMap::CS::TA::kActive;
+    Trace::CountRead(kTracePeripheral);
+    Trace::CountWrite(kTracePeripheral);
+  }
+
+  /**
+   * @brief Clear both FIFOs and start a transfer with one register write.
+   * @details The FIFOs are cleared before the transfer becomes active.
+   */
+  inline void ClearFifoAndStartTransmission() {
+    ModifyRegister(
+        register_map_->cs,
+        SpiFields::CS::kClear(SpiRegisterMap::CS::CLEAR::kClearBothFifo) |
+            SpiFields::CS::kTa(SpiRegisterMap::CS::TA::kActive));
+    Trace::CountRead(kTracePeripheral);
+    Trace::CountWrite(kTracePeripheral);
   }
 
   inline void EndTransmission() {
     register_map_->cs.ta = SpiRegisterMap::CS::TA::kInactive;
+    Trace::CountRead(kTracePeripheral);
+    Trace::CountWrite(kTracePeripheral);
   }
 
   inline bool IsTransmissionCompleted() {
+    Trace::CountRead(kTracePeripheral);
     return register_map_->cs.done == SpiRegisterMap::CS::DONE::kCompleted;
   }
 
   inline bool IsTxFifoWritable() {
+    Trace::CountRead(kTracePeripheral);
     return register_map_->cs.txd == SpiRegisterMap::CS::TXD::kWritable;
   }
 
   inline bool IsRxFifoReadable() {
+    Trace::CountRead(kTracePeripheral);
     return register_map_->cs.rxd == SpiRegisterMap::CS::RXD::kContains;
   }
 
   inline void WriteDataToTxFifo(uint32_t data) {
     register_map_->fifo.data = data;
+    Trace::CountWrite(kTracePeripheral);
   }
 
   using ReadEnable = SpiRegisterMap::CS::REN;
@@ -203,24 +249,139 @@ class Spi : public SpiBase {
    *        read mode and does not output any signal.
    */
   inline void SetReadEnable(ReadEnable read_enable) {
-    register_map_->cs.ren = read_enable;
+    cs_->ren = read_enable;
+    cs_.CommitChanged();
   }
 
+  /**
+   * @brief Settings of one device on the bus. Used by SpiDevice.
+   */
+  struct DeviceConfig {
+    ChipSelect chip_select = ChipSelect::kChipSelect0;
+    ClockPhase clock_phase = ClockPhase::kBeginning;
+    ClockPolarity clock_polarity = ClockPolarity::kLow;
+    CsPolarity cs_polarity = CsPolarity::kLow;
+    uint16_t clock_divider = 0;
+  };
+
+  /**
+   * @brief Apply all the settings of a device at once.
+   * @details The settings are staged in the cached registers and written with
+   *          one store per register.
+   *
+   * @param config
+   */
+  void ApplyDeviceConfig(const DeviceConfig& config);
+
   inline uint32_t ReadDataFromRxFifo() const {
+    Trace::CountRead(kTracePeripheral);
     return register_map_->fifo.data;
   }
 
+  /**
+   * @brief Set the number of bytes to transfer in DMA mode.
+   *
+   * @param data_length
+   */
+  inline void SetDataLength(uint16_t data_length) {
+    register_map_->dlen.len = static_cast<uint32_t>(data_length);
+    Trace::CountRead(kTracePeripheral);
+    Trace::CountWrite(kTracePeripheral);
+  }
+
+  /**
+   * @brief Set the FIFO levels at which DREQ and Panic are generated for an
+   *        external DMA engine.
+   *
+   * @param tx_dreq DREQ to the TX DMA engine while the TX FIFO level is less
+   *                than or equal to this amount.
+   * @param tx_panic Panic to the TX DMA engine while the TX FIFO level is
+   *                 less than or equal to this amount.
+   * @param rx_dreq DREQ to the RX DMA engine while the RX FIFO level is
+   *                greater than this amount.
+   * @param rx_panic Panic to the RX DMA engine while the RX FIFO level is
+   *                 greater than this amount.
+   */
+  inline void SetDmaThresholds(uint8_t tx_dreq, uint8_t tx_panic,
+                               uint8_t rx_dreq, uint8_t rx_panic) {
+    dc_->tdreq = tx_dreq;
+    dc_->tpanic = tx_panic;
+    dc_->rdreq = rx_dreq;
+    dc_->rpanic = rx_panic;
+    dc_.Commit();
+  }
+
+  using Lossi = SpiRegisterMap::CS::LEN;
+  /**
+   * @brief Select between SPI master and LoSSI master.
+   *
+   * @param lossi kEnable : the serial interface behaves as a LoSSI master.
+   */
+  inline void SetLossiMode(Lossi lossi) {
+    cs_->len = lossi;
+    cs_.CommitChanged();
+  }
+
+  /**
+   * @brief Set the LoSSI output hold delay.
+   *
+   * @param apb_clocks Must be 0 ~ 15. 0 causes a 1 clock delay.
+   */
+  void SetLossiOutputHoldDelay(uint8_t apb_clocks);
+
   void TransmitAndReceiveBlocking(const uint8_t* transmit_buf,
                                   uint8_t* receive_buf,
                                   uint32_t data_length) override;
 
+  void TransmitBlocking(const uint8_t* transmit_buf,
+                        uint32_t data_length) override;
+
+  void ReceiveBlocking(uint8_t* receive_buf, uint32_t data_length,
+                       uint8_t fill = 0) override;
+
+  void Transfer(const SpiSegment* segments, size_t num_segments) override;
+
+  /**
+   * @brief Transfer data by writing and reading the FIFO four bytes at a
+   *        time.
+   * @details The peripheral is driven in DMA mode (DMAEN with DLEN) by the
+   *          CPU, so every FIFO access carries four bytes instead of one.
+   *          Bytes are shifted out in buffer order. The transfer pauses every
+   *          64 bytes until the FIFO is clocked out. DMAEN is restored.
+   *
+   * @param transmit_buf
+   * @param receive_buf
+   * @param data_length Must be 1 ~ 65535
+   */
+  void TransmitAndReceivePackedBlocking(const uint8_t* transmit_buf,
+                                        uint8_t* receive_buf,
+                                        uint32_t data_length);
+
+  /**
+   * @brief Get the counters and the latency of the blocking transfers.
+   *
+   * @return const PeripheralMetrics&
+   */
+  inline const PeripheralMetrics& GetMetrics() const { return metrics_; }
+
  private:
-  Spi(SpiRegisterMap* register_map);
+  static constexpr Trace::Peripheral kTracePeripheral = Trace::Peripheral::kSpi;
+
+  Spi(SpiRegisterMap* register_map, uint32_t instance);
 
   static constexpr size_t kNumOfInstances = 5;
-  static std::array<std::shared_ptr<Spi>, kNumOfInstances> instances_;
+  static InstanceRegistry<Spi, kNumOfInstances> instances_;
 
   SpiRegisterMap* register_map_;
+
+  // Cached configuration registers. CS also holds TA, DMAEN and the status
+  // bits, which are accessed directly, so it is committed with
+  // CommitChanged().
+  ShadowRegister<SpiRegisterMap::CS> cs_;
+  ShadowRegister<SpiRegisterMap::CLK> clk_;
+  ShadowRegister<SpiRegisterMap::DC> dc_;
+
+  PeripheralMetrics metrics_;
 };
 
 }  // namespace rpl
@@ -5,9 +5,19 @@
 #include <memory>
 
 #include "rpl4/registers/registers_spi.hpp"
+#include "rpl4/system/bus_mutex.hpp"
 
 namespace rpl {
 
+/**
+ * @brief One part of a transaction passed to SpiBase::Transfer().
+ */
+struct SpiSegment {
+  const uint8_t* transmit_buf;  // nullptr : 0x00 is transmitted
+  uint8_t* receive_buf;         // nullptr : the received data is discarded
+  uint32_t data_length;
+};
+
 class SpiBase {
  public:
   SpiBase(const SpiBase&) = delete;
@@ -22,8 +32,132 @@ class SpiBase {
                                           uint8_t* receive_buf,
                                           uint32_t data_length) = 0;
 
+  /**
+   * @brief Transmit data and discard whatever is received.
+   *
+   * @param transmit_buf
+   * @param data_length
+   */
+  virtual void TransmitBlocking(const uint8_t* transmit_buf,
+                                uint32_t data_length) = 0;
+
+  /**
+   * @brief Receive data while transmitting a constant byte.
+   *
+   * @param receive_buf
+   * @param data_length
+   * @param fill The byte transmitted for every received byte.
+   */
+  virtual void ReceiveBlocking(uint8_t* receive_buf, uint32_t data_length,
+                               uint8_t fill = 0) = 0;
+
+  /**
+   * @brief Transfer several segments as one transaction.
+   * @details The chip select stays asserted from the first byte of the first
+   *          segment to the last byte of the last segment, so a command,
+   *          an address and a payload can be sent from separate buffers
+   *          without copying them into one.
+   *
+   * @param segments
+   * @param num_segments
+   */
+  virtual void Transfer(const SpiSegment* segments, size_t num_segments) = 0;
+
+  /**
+   * @brief Mutex that serialises the transactions of the devices sharing this
+   *        bus. SpiDevice takes it for every transaction.
+   */
+  inline BusMutex& GetBusMutex() { return bus_mutex_; }
+
+  /**
+   * @brief Record that the device identified by device_id is using the bus.
+   * @note Must be called with the bus mutex held.
+   *
+   * @param device_id Non-zero id of the device.
+   * @return true if the bus was last configured by someone else, so the
+   *         settings of the device need to be applied again.
+   */
+  inline bool ClaimBus(uint32_t device_id) {
+    if (owner_id_ == device_id) { return false; }
+    owner_id_ = device_id;
+    return true;
+  }
+
+  /**
+   * @brief Forget which device configured the bus last.
+   * @details Call this after changing the settings directly so that the next
+   *          SpiDevice transaction applies its settings again.
+   */
+  inline void InvalidateBusOwner() { owner_id_ = 0; }
+
  protected:
   SpiBase() = default;
+
+  BusMutex bus_mutex_;
+  // Id of the SpiDevice whose settings are currently applied. 0 : none
+  uint32_t owner_id_ = 0;
+
+  // Number of bytes transferred by a list of segments.
+  static inline uint64_t GetTotalLength(const SpiSegment* segments,
+                                        size_t num_segments) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < num_segments; ++i) {
+      total += segments[i].data_length;
+    }
+    return total;
+  }
+
+  /**
+   * @brief Walks the bytes of a list of segments in order.
+   */
+  class SegmentCursor {
+   public:
+    SegmentCursor(const SpiSegment* segments, size_t num_segments)
+        : segments_(segments), num_segments_(num_segments) {
+      SkipEmptySegments();
+    }
+
+    inline bool AtEnd() const { return index_ >= num_segments_; }
+
+    // Whether the current byte is the last one of the whole transaction.
+    inline bool AtLast() const {
+      if (offset_ + 1 < segments_[index_].data_length) { return false; }
+      for (size_t i = index_ + 1; i < num_segments_; ++i) {
+        if (segments_[i].data_length != 0) { return false; }
+      }
+      return true;
+    }
+
+    inline uint8_t Transmit() const {
+      const uint8_t* buf = segments_[index_].transmit_buf;
+      return buf == nullptr ? 0 : buf[offset_];
+    }
+
+    inline void Receive(uint8_t data) const {
+      uint8_t* buf = segments_[index_].receive_buf;
+      if (buf != nullptr) { buf[offset_] = data; }
+    }
+
+    inline void Next() {
+      if (++offset_ >= segments_[index_].data_length) {
+        offset_ = 0;
+        ++index_;
+        SkipEmptySegments();
+      }
+    }
+
+   private:
+    inline void SkipEmptySegments() {
+      while (index_ < num_segments_ && segments_[index_].data_length == 0) {
+        ++index_;
+      }
+    }
+
+    const SpiSegment* segments_;
+    size_t num_segments_;
+    size_t index_ = 0;
+    uint32_t offset_ = 0;
+  };
 };
 
 }  // namespace rpl
@@ -0,0 +1,110 @@
+#ifndef RPL4_PERIPHERAL_SPI_DEVICE_HPP_
+#define RPL4_PERIPHERAL_SPI_DEVICE_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "rpl4/peripheral/spi_base.hpp"
+
+namespace rpl {
+
+/**
+ * @brief Handle for one chip select on a shared Spi or AuxSpi bus.
+ * @details Every transaction locks the bus. The settings of the device are
+ *          only written to the registers when another device used the bus
+ *          since this device's last transaction, so consecutive transactions
+ *          of the same device cost one uncontended lock and unlock.
+ *
+ * @tparam Bus Spi or AuxSpi
+ */
+template <typename Bus>
+class SpiDevice {
+ public:
+  using Config = typename Bus::DeviceConfig;
+
+  /**
+   * @brief Scoped transaction. The bus is locked and configured for the
+   *        device while this object exists.
+   */
+  class Transaction {
+   public:
+    explicit Transaction(SpiDevice& device) : bus_(device.bus_) {
+      bus_->GetBusMutex().lock();
+      if (bus_->ClaimBus(device.id_)) {
+        bus_->ApplyDeviceConfig(device.config_);
+      }
+    }
+    ~Transaction() { bus_->GetBusMutex().unlock(); }
+
+    Transaction(const Transaction&) = delete;
+    Transaction& operator=(const Transaction&) = delete;
+
+    inline Bus* operator->() const { return bus_; }
+
+   private:
+    Bus* bus_;
+  };
+
+  SpiDevice(Bus* bus, const Config& config)
+      : bus_(bus), config_(config), id_(NextId()) {}
+
+  SpiDevice(const SpiDevice&) = delete;
+  SpiDevice& operator=(const SpiDevice&) = delete;
+
+  inline Bus* GetBus() const { return bus_; }
+
+  inline const Config& GetConfig() const { return config_; }
+
+  /**
+   * @brief Change the settings of the device. They are applied by the next
+   *        transaction.
+   *
+   * @param config
+   */
+  void SetConfig(const Config& config) {
+    std::lock_guard<BusMutex> lock(bus_->GetBusMutex());
+    config_ = config;
+    // The owner is unknown from here, so whoever uses the bus next applies
+    // its settings again.
+    bus_->InvalidateBusOwner();
+  }
+
+  inline Transaction Begin() { return Transaction(*this); }
+
+  void TransmitAndReceiveBlocking(const uint8_t* transmit_buf,
+                                  uint8_t* receive_buf, uint32_t data_length) {
+    Transaction transaction(*this);
+    bus_->TransmitAndReceiveBlocking(transmit_buf, receive_buf, data_length);
+  }
+
+  void TransmitBlocking(const uint8_t* transmit_buf, uint32_t data_length) {
+    Transaction transaction(*this);
+    bus_->TransmitBlocking(transmit_buf, data_length);
+  }
+
+  void ReceiveBlocking(uint8_t* receive_buf, uint32_t data_length,
+                       uint8_t fill = 0) {
+    Transaction transaction(*this);
+    bus_->ReceiveBlocking(receive_buf, data_length, fill);
+  }
+
+  void Transfer(const SpiSegment* segments, size_t num_segments) {
+    Transaction transaction(*this);
+    bus_->Transfer(segments, num_segments);
+  }
+
+ private:
+  static uint32_t NextId() {
+    static std::atomic<uint32_t> next_id{1};
+    return next_id.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  Bus* bus_;
+  Config config_;
+  uint32_t id_;
+};
+
+}  // namespace rpl
+
+#endif  // RPL4_PERIPHERAL_SPI_DEVICE_HPP_
@@ -0,0 +1,207 @@
+#ifndef RPL4_PERIPHERAL_WS2812_HPP_
+#define RPL4_PERIPHERAL_WS2812_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "rpl4/peripheral/dma.hpp"
+#include "rpl4/peripheral/pwm.hpp"
+
+namespace rpl {
+
+/**
+ * @brief Encodes LED colors into the bitstream of the PWM serializer.
+ * @details Each data bit of the LED protocol is sent as 3 serializer bits,
+ *          100 for 0 and 110 for 1, so one color byte becomes 24 bits. These
+ *          are looked up in a 256 entry table that also applies the
+ *          brightness, and packed into 32-bit FIFO words with a 64-bit
+ *          accumulator. There is no branch per bit and the output is only
+ *          written, never read, so it can be uncached DMA memory.
+ */
+class Ws2812Encoder {
+ public:
+  /**
+   * @brief Order in which the color bytes are sent.
+   */
+  enum class ColorOrder : uint8_t {
+    kGrb,   // WS2812, WS2812B, SK6812 RGB
+    kRgb,   // WS2811
+    kBrg,
+    kGrbw,  // SK6812 RGBW
+    kRgbw,
+  };
+
+  explicit Ws2812Encoder(ColorOrder order = ColorOrder::kGrb);
+
+  /**
+   * @brief Scale all the colors.
+   *
+   * @param brightness 0 : off, 255 : full
+   */
+  void SetBrightness(uint8_t brightness);
+
+  inline uint32_t GetBytesPerLed() const { return bytes_per_led_; }
+
+  /**
+   * @brief Get the number of FIFO words of a frame without the reset time.
+   *
+   * @param num_leds
+   * @return size_t
+   */
+  inline size_t GetNumOfWords(size_t num_leds) const {
+    return (num_leds * bytes_per_led_ * 24 + 31) / 32;
+  }
+
+  /**
+   * @brief Encode a frame.
+   *
+   * @param pixels 0xWWRRGGBB per LED. White is used by the RGBW orders only.
+   * @param num_leds
+   * @param out GetNumOfWords(num_leds) words. The bits after the last LED
+   *            are 0.
+   */
+  void Encode(const uint32_t* pixels, size_t num_leds, uint32_t* out) const;
+
+ private:
+  // Serializer bits of each byte value after the brightness is applied.
+  std::array<uint32_t, 256> table_;
+  // Bit positions in 0xWWRRGGBB of the bytes in the order they are sent.
+  std::array<uint8_t, 4> shifts_;
+  uint32_t bytes_per_led_;
+};
+
+/**
+ * @brief WS2812 / SK6812 LED strip driven by the PWM serializer and DMA.
+ * @details The PWM clock is set to 3 times the 800 kHz bit rate and a channel
+ *          shifts out 32-bit words from the FIFO, which is fed by DMA from
+ *          one of two frame buffers in DmaMemory. Show() encodes the pixels
+ *          into the buffer that is not being sent while the previous frame is
+ *          still streaming, then waits for that frame and starts the new one,
+ *          so the CPU only spends the encoding time per frame. At 800 kHz a
+ *          frame of 1000 RGB LEDs takes 30 ms, which allows 33 fps per
+ *          strip.
+ * @note The PWM clock is shared by PWM0 and PWM1, and the serializer uses the
+ *       whole FIFO of the port, so the other channel of the port cannot be
+ *       used at the same time. To use the other port as well, create the strip
+ *       first. PwmAudio then fits its range to this clock.
+ */
+class Ws2812 {
+ public:
+  struct Config {
+    Pwm::Port port = Pwm::Port::kPwm0;
+    Pwm::Channel channel = Pwm::Channel::kChannel1;
+    // GPIO pin with the function of the PWM channel, e.g. 18 for PWM0_0
+    uint8_t pin = 18;
+    Dma::Channel dma_channel = Dma::Channel::kChannel5;
+    size_t num_leds = 0;
+    Ws2812Encoder::ColorOrder order = Ws2812Encoder::ColorOrder::kGrb;
+    uint8_t brightness = 255;
+  };
+
+  /**
+   * @brief Set up the PWM, the DMA channel and the frame buffers.
+   *
+   * @param config
+   * @return std::unique_ptr<Ws2812> nullptr if RPL is not initialized, the
+   *         pin is not the PWM channel, the other port runs the clock at
+   *         another frequency or DMA memory cannot be allocated.
+   */
+  static std::unique_ptr<Ws2812> Create(const Config& config);
+
+  Ws2812(const Ws2812&) = delete;
+  Ws2812& operator=(const Ws2812&) = delete;
+
+  /**
+   * @brief Stop the transfer and free the frame buffers.
+   */
+  ~Ws2812();
+
+  inline size_t GetNumOfLeds() const { return pixels_.size(); }
+
+  /**
+   * @brief Set the color of one LED for the next Show().
+   *
+   * @param index
+   * @param color 0xWWRRGGBB
+   */
+  inline void SetPixel(size_t index, uint32_t color) {
+    if (index < pixels_.size()) { pixels_[index] = color; }
+  }
+
+  inline uint32_t GetPixel(size_t index) const {
+    return index < pixels_.size() ? pixels_[index] : 0;
+  }
+
+  /**
+   * @brief Direct access to the colors, 0xWWRRGGBB per LED.
+   *
+   * @return uint32_t* GetNumOfLeds() entries
+   */
+  inline uint32_t* GetPixels() { return pixels_.data(); }
+
+  /**
+   * @brief Scale all the colors from the next Show().
+   *
+   * @param brightness 0 : off, 255 : full
+   */
+  inline void SetBrightness(uint8_t brightness) {
+    encoder_.SetBrightness(brightness);
+  }
+
+  /**
+   * @brief Send the current pixels.
+   * @details Returns as soon as the frame has started. The previous frame is
+   *          waited for after the new one has been encoded.
+   *
+   * @return false if the previous frame did not complete
+   */
+  bool Show();
+
+  /**
+   * @brief Wait until the last frame has been sent.
+   *
+   * @return false if the transfer failed or timed out
+   */
+  bool Wait();
+
+ private:
+  struct FrameBuffer {
+    uint32_t* words = nullptr;
+    DmaControlBlock* control_blocks = nullptr;
+    uint32_t control_blocks_physical = 0;
+  };
+
+  Ws2812(const Config& config, Pwm* pwm, Dma* dma);
+
+  bool AllocateFrameBuffer(FrameBuffer& buffer);
+  void FreeFrameBuffer(FrameBuffer& buffer);
+  void SetUpPwm();
+
+  // Bit rate of the LED protocol in Hz
+  static constexpr double kBitFrequency = 800000.0;
+  // The latch needs the line low for at least 280 us on newer parts.
+  static constexpr double kResetTime = 300e-6;
+  // Fewer bytes than the limit of the DMA lite channels, in whole words
+  static constexpr uint32_t kMaxControlBlockLength = 65532;
+
+  Config config_;
+  Pwm* pwm_;
+  Dma* dma_;
+  Ws2812Encoder encoder_;
+  std::vector<uint32_t> pixels_;
+
+  size_t data_words_;   // Words of the encoded LEDs
+  size_t total_words_;  // Data and the low reset time
+  size_t num_control_blocks_;
+  std::array<FrameBuffer, 2> buffers_;
+  size_t back_ = 0;  // Buffer encoded by the next Show()
+  bool in_flight_ = false;
+  uint32_t timeout_ms_;
+};
+
+}  // namespace rpl
+
+#endif  // RPL4_PERIPHERAL_WS2812_HPP_
@@ -0,0 +1,110 @@
+// Generated by util/generate_register_fields.py from registers_dma.hpp.
+// Do not edit by hand.
+
+#ifndef RPL4_REGISTERS_FIELDS_DMA_HPP_
+#define RPL4_REGISTERS_FIELDS_DMA_HPP_
+
+#include "rpl4/registers/register_field.hpp"
+#include "rpl4/registers/registers_dma.hpp"
+
+namespace rpl {
+
+struct DmaFields {
+  struct CS {
+    using Register = DmaRegisterMap::CS;
+    static constexpr RegField<Register, 0, 1, Register::ACTIVE> kActive{};
+    static constexpr RegField<Register, 1, 1, Register::END> kEnd{};
+    static constexpr RegField<Register, 2, 1, Register::INT> kInterrupt{};
+    static constexpr RegField<Register, 3, 1, Register::DREQ> kDreq{};
+    static constexpr RegField<Register, 4, 1, Register::PAUSED> kPaused{};
+    static constexpr RegField<Register, 5, 1, Register::DREQ_STOPS_DMA>
+        kDreqStopsDma{};
+    static constexpr RegField<Register, 6, 1,
+                              Register::WAITING_FOR_OUTSTANDING_WRITES>
+        kWaitingForOutstandingWrites{};
+    static constexpr RegField<Register, 8, 1, Register::ERROR> kError{};
+    static constexpr RegField<Register, 16, 4, Register::PRIORITY> kPriority{};
+    static constexpr RegField<Register, 20, 4, Register::PANIC_PRIORITY>
+        kPanicPriority{};
+    static constexpr RegField<Register, 28, 1,
+                              Register::WAIT_FOR_OUTSTANDING_WRITES>
+        kWaitForOutstandingWrites{};
+    static constexpr RegField<Register, 29, 1, Register::DISDEBUG> kDisdebug{};
+    static constexpr RegField<Register, 30, 1, Register::ABORT> kAbort{};
+    static constexpr RegField<Register, 31, 1, Register::RESET> kReset{};
+  };
+
+  struct CONBLK_AD {
+    using Register = DmaRegisterMap::CONBLK_AD;
+    static constexpr RegField<Register, 0, 32, uint32_t> kAddress{};
+  };
+
+  struct TI {
+    using Register = DmaRegisterMap::TI;
+    static constexpr RegField<Register, 0, 1, Register::INTEN> kInten{};
+    static constexpr RegField<Register, 1, 1, Register::TDMODE> kTdmode{};
+    static constexpr RegField<Register, 3, 1, Register::WAIT_RESP> kWaitResp{};
+    static constexpr RegField<Register, 4, 1, Register::DEST_INC> kDestInc{};
+    static constexpr RegField<Register, 5, 1, Register::DEST_WIDTH>
+        kDestWidth{};
+    static constexpr RegField<Register, 6, 1, Register::DEST_DREQ> kDestDreq{};
+    static constexpr RegField<Register, 7, 1, Register::DEST_IGNORE>
+        kDestIgnore{};
+    static constexpr RegField<Register, 8, 1, Register::SRC_INC> kSrcInc{};
+    static constexpr RegField<Register, 9, 1, Register::SRC_WIDTH> kSrcWidth{};
+    static constexpr RegField<Register, 10, 1, Register::SRC_DREQ> kSrcDreq{};
+    static constexpr RegField<Register, 11, 1, Register::SRC_IGNORE>
+        kSrcIgnore{};
+    static constexpr RegField<Register, 12, 4, Register::BURST_LENGTH>
+        kBurstLength{};
+    static constexpr RegField<Register, 16, 5, Register::PERMAP> kPermap{};
+    static constexpr RegField<Register, 21, 5, Register::WAITS> kWaits{};
+    static constexpr RegField<Register, 26, 1, Register::NO_WIDE_BURSTS>
+        kNoWideBursts{};
+  };
+
+  struct SOURCE_AD {
+    using Register = DmaRegisterMap::SOURCE_AD;
+    static constexpr RegField<Register, 0, 32, uint32_t> kAddress{};
+  };
+
+  struct DEST_AD {
+    using Register = DmaRegisterMap::DEST_AD;
+    static constexpr RegField<Register, 0, 32, uint32_t> kAddress{};
+  };
+
+  struct TXFR_LEN {
+    using Register = DmaRegisterMap::TXFR_LEN;
+    static constexpr RegField<Register, 0, 16, uint32_t> kXlength{};
+    static constexpr RegField<Register, 16, 14, uint32_t> kYlength{};
+  };
+
+  struct STRIDE {
+    using Register = DmaRegisterMap::STRIDE;
+    static constexpr RegField<Register, 0, 16, uint32_t> kSStride{};
+    static constexpr RegField<Register, 16, 16, uint32_t> kDStride{};
+  };
+
+  struct NEXTCONBK {
+    using Register = DmaRegisterMap::NEXTCONBK;
+    static constexpr RegField<Register, 0, 32, uint32_t> kAddress{};
+  };
+
+  struct DEBUG {
+    using Register = DmaRegisterMap::DEBUG;
+    static constexpr RegField<Register, 0, 1, uint32_t> kReadLastNotSetError{};
+    static constexpr RegField<Register, 1, 1, Register::FIFO_ERROR>
+        kFifoError{};
+    static constexpr RegField<Register, 2, 1, Register::READ_ERROR>
+        kReadError{};
+    static constexpr RegField<Register, 4, 4, uint32_t> kOutstandingWrites{};
+    static constexpr RegField<Register, 8, 8, uint32_t> kDmaId{};
+    static constexpr RegField<Register, 16, 9, uint32_t> kDmaState{};
+    static constexpr RegField<Register, 25, 3, uint32_t> kVersion{};
+    static constexpr RegField<Register, 28, 1, uint32_t> kLite{};
+  };
+};
+
+}  // namespace rpl
+
+#endif  // RPL4_REGISTERS_FIELDS_DMA_HPP_
@@ -0,0 +1,77 @@
+// Generated by util/generate_register_fields.py from registers_dma4.hpp.
+// Do not edit by hand.
+
+#ifndef RPL4_REGISTERS_FIELDS_DMA4_HPP_
+#define RPL4_REGISTERS_FIELDS_DMA4_HPP_
+
+#include "rpl4/registers/register_field.hpp"
+#include "rpl4/registers/registers_dma4.hpp"
+
+namespace rpl {
+
+struct Dma4Fields {
+  struct CS {
+    using Register = Dma4RegisterMap::CS;
+    static constexpr RegField<Register, 0, 1, Register::ACTIVE> kActive{};
+    static constexpr RegField<Register, 1, 1, Register::END> kEnd{};
+    static constexpr RegField<Register, 2, 1, Register::INT> kInterrupt{};
+    static constexpr RegField<Register, 3, 1, Register::DREQ> kDreq{};
+    static constexpr RegField<Register, 4, 1, Register::PAUSED> kReadPaused{};
+    static constexpr RegField<Register, 5, 1, Register::PAUSED> kWritePaused{};
+    static constexpr RegField<Register, 6, 1, Register::DREQ_STOPS_DMA>
+        kDreqStopsDma{};
+    static constexpr RegField<Register, 7, 1,
+                              Register::WAITING_FOR_OUTSTANDING_WRITES>
+        kWaitingForOutstandingWrites{};
+    static constexpr RegField<Register, 10, 1, Register::ERROR> kError{};
+    static constexpr RegField<Register, 16, 4, uint32_t> kQos{};
+    static constexpr RegField<Register, 20, 4, uint32_t> kPanicQos{};
+    static constexpr RegField<Register, 24, 1, Register::BUSY> kDmaBusy{};
+    static constexpr RegField<Register, 25, 1, uint32_t>
+        kOutstandingTransactions{};
+    static constexpr RegField<Register, 28, 1,
+                              Register::WAIT_FOR_OUTSTANDING_WRITES>
+        kWaitForOutstandingWrites{};
+    static constexpr RegField<Register, 29, 1, Register::DISDEBUG> kDisdebug{};
+    static constexpr RegField<Register, 30, 1, Register::ABORT> kAbort{};
+    static constexpr RegField<Register, 31, 1, Register::HALT> kHalt{};
+  };
+
+  struct CB {
+    using Register = Dma4RegisterMap::CB;
+    static constexpr RegField<Register, 0, 32, uint32_t> kAddress{};
+  };
+
+  struct TI {
+    using Register = Dma4RegisterMap::TI;
+    static constexpr RegField<Register, 0, 1, Register::INTEN> kInten{};
+    static constexpr RegField<Register, 1, 1, Register::TDMODE> kTdmode{};
+    static constexpr RegField<Register, 2, 1, Register::WAIT_RESP> kWaitResp{};
+    static constexpr RegField<Register, 3, 1, Register::WAIT_RD_RESP>
+        kWaitRdResp{};
+    static constexpr RegField<Register, 9, 5, Register::PERMAP> kPermap{};
+    static constexpr RegField<Register, 14, 1, Register::S_DREQ> kSDreq{};
+    static constexpr RegField<Register, 15, 1, Register::D_DREQ> kDDreq{};
+    static constexpr RegField<Register, 16, 8, uint32_t> kSWaits{};
+    static constexpr RegField<Register, 24, 8, uint32_t> kDWaits{};
+  };
+
+  struct INFO {
+    using Register = Dma4RegisterMap::INFO;
+    static constexpr RegField<Register, 0, 8, uint32_t> kAddressHigh{};
+    static constexpr RegField<Register, 8, 4, uint32_t> kBurstLength{};
+    static constexpr RegField<Register, 12, 1, Register::INC> kInc{};
+    static constexpr RegField<Register, 13, 2, Register::SIZE> kSize{};
+    static constexpr RegField<Register, 15, 1, Register::IGNORE> kIgnore{};
+    static constexpr RegField<Register, 16, 16, uint32_t> kStride{};
+  };
+
+  struct LEN {
+    using Register = Dma4RegisterMap::LEN;
+    static constexpr RegField<Register, 0, 30, uint32_t> kLength{};
+  };
+};
+
+}  // namespace rpl
+
+#endif  // RPL4_REGISTERS_FIELDS_DMA4_HPP_
@@ -0,0 +1,74 @@
+// Generated by util/generate_register_fields.py from registers_pwm.hpp.
+// Do not edit by hand.
+
+#ifndef RPL4_REGISTERS_FIELDS_PWM_HPP_
+#define RPL4_REGISTERS_FIELDS_PWM_HPP_
+
+#include "rpl4/registers/register_field.hpp"
+#include "rpl4/registers/registers_pwm.hpp"
+
+namespace rpl {
+
+struct PwmFields {
+  struct CTL {
+    using Register = PwmRegisterMap::CTL;
+    static constexpr RegField<Register, 0, 1, Register::PWEN> kPwen1{};
+    static constexpr RegField<Register, 1, 1, Register::MODE> kMode1{};
+    static constexpr RegField<Register, 2, 1, Register::RPTL> kRptl1{};
+    static constexpr RegField<Register, 3, 1, Register::SBIT> kSbit1{};
+    static constexpr RegField<Register, 4, 1, Register::POLA> kPola1{};
+    static constexpr RegField<Register, 5, 1, Register::USEF> kUsef1{};
+    static constexpr RegField<Register, 6, 1, Register::CLRF> kClrf1{};
+    static constexpr RegField<Register, 7, 1, Register::MSEN> kMsen1{};
+    static constexpr RegField<Register, 8, 1, Register::PWEN> kPwen2{};
+    static constexpr RegField<Register, 9, 1, Register::MODE> kMode2{};
+    static constexpr RegField<Register, 10, 1, Register::RPTL> kRptl2{};
+    static constexpr RegField<Register, 11, 1, Register::SBIT> kSbit2{};
+    static constexpr RegField<Register, 12, 1, Register::POLA> kPola2{};
+    static constexpr RegField<Register, 13, 1, Register::USEF> kUsef2{};
+    static constexpr RegField<Register, 15, 1, Register::MSEN> kMsen2{};
+  };
+
+  struct STA {
+    using Register = PwmRegisterMap::STA;
+    static constexpr RegField<Register, 0, 1, Register::FULL> kFull1{};
+    static constexpr RegField<Register, 1, 1, Register::EMPT> kEmpt1{};
+    static constexpr RegField<Register, 2, 1, Register::WERR> kWerr1{};
+    static constexpr RegField<Register, 3, 1, Register::RERR> kRerr1{};
+    static constexpr RegField<Register, 4, 1, Register::GAPO> kGapo1{};
+    static constexpr RegField<Register, 5, 1, Register::GAPO> kGapo2{};
+    static constexpr RegField<Register, 6, 1, Register::GAPO> kGapo3{};
+    static constexpr RegField<Register, 7, 1, Register::GAPO> kGapo4{};
+    static constexpr RegField<Register, 8, 1, Register::BERR> kBerr{};
+    static constexpr RegField<Register, 9, 1, Register::STATE> kSta1{};
+    static constexpr RegField<Register, 10, 1, Register::STATE> kSta2{};
+    static constexpr RegField<Register, 11, 1, Register::STATE> kSta3{};
+    static constexpr RegField<Register, 12, 1, Register::STATE> kSta4{};
+  };
+
+  struct DMAC {
+    using Register = PwmRegisterMap::DMAC;
+    static constexpr RegField<Register, 0, 8, Register::DREQ> kDreq{};
+    static constexpr RegField<Register, 8, 8, Register::PANIC> kPanic{};
+    static constexpr RegField<Register, 31, 1, Register::ENAB> kEnab{};
+  };
+
+  struct RNG {
+    using Register = PwmRegisterMap::RNG;
+    static constexpr RegField<Register, 0, 32, uint32_t> kRange{};
+  };
+
+  struct DAT {
+    using Register = PwmRegisterMap::DAT;
+    static constexpr RegField<Register, 0, 32, uint32_t> kData{};
+  };
+
+  struct FIF {
+    using Register = PwmRegisterMap::FIF;
+    static constexpr RegField<Register, 0, 32, uint32_t> kData{};
+  };
+};
+
+}  // namespace rpl
+
+#endif  // RPL4_REGISTERS_FIELDS_PWM_HPP_
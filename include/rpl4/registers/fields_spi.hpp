@@ -0,0 +1,72 @@
+// Generated by util/generate_register_fields.py from registers_spi.hpp.
+// Do not edit by hand.
+
+#ifndef RPL4_REGISTERS_FIELDS_SPI_HPP_
+#define RPL4_REGISTERS_FIELDS_SPI_HPP_
+
+#include "rpl4/registers/register_field.hpp"
+#include "rpl4/registers/registers_spi.hpp"
+
+namespace rpl {
+
+struct SpiFields {
+  struct CS {
+    using Register = SpiRegisterMap::CS;
+    static constexpr RegField<Register, 0, 2, Register::CS_> kCs{};
+    static constexpr RegField<Register, 2, 1, Register::CPHA> kCpha{};
+    static constexpr RegField<Register, 3, 1, Register::CPOL> kCpol{};
+    static constexpr RegField<Register, 4, 2, Register::CLEAR> kClear{};
+    static constexpr RegField<Register, 6, 1, Register::CSPOL> kCspol{};
+    static constexpr RegField<Register, 7, 1, Register::TA> kTa{};
+    static constexpr RegField<Register, 8, 1, Register::DMAEN> kDmaen{};
+    static constexpr RegField<Register, 9, 1, Register::INTD> kIntd{};
+    static constexpr RegField<Register, 10, 1, Register::INTR> kIntr{};
+    static constexpr RegField<Register, 11, 1, Register::ADCS> kAdcs{};
+    static constexpr RegField<Register, 12, 1, Register::REN> kRen{};
+    static constexpr RegField<Register, 13, 1, Register::LEN> kLen{};
+    static constexpr RegField<Register, 14, 1, uint32_t> kLmono{};
+    static constexpr RegField<Register, 15, 1, uint32_t> kTeEn{};
+    static constexpr RegField<Register, 16, 1, Register::DONE> kDone{};
+    static constexpr RegField<Register, 17, 1, Register::RXD> kRxd{};
+    static constexpr RegField<Register, 18, 1, Register::TXD> kTxd{};
+    static constexpr RegField<Register, 19, 1, Register::RXR> kRxr{};
+    static constexpr RegField<Register, 20, 1, Register::RXF> kRxf{};
+    static constexpr RegField<Register, 21, 1, Register::CSPOL> kCspol0{};
+    static constexpr RegField<Register, 22, 1, Register::CSPOL> kCspol1{};
+    static constexpr RegField<Register, 23, 1, Register::CSPOL> kCspol2{};
+    static constexpr RegField<Register, 24, 1, uint32_t> kDmaLen{};
+    static constexpr RegField<Register, 25, 1, uint32_t> kLenLong{};
+  };
+
+  struct FIFO {
+    using Register = SpiRegisterMap::FIFO;
+    static constexpr RegField<Register, 0, 32, uint32_t> kData{};
+  };
+
+  struct CLK {
+    using Register = SpiRegisterMap::CLK;
+    static constexpr RegField<Register, 0, 16, uint32_t> kCdiv{};
+  };
+
+  struct DLEN {
+    using Register = SpiRegisterMap::DLEN;
+    static constexpr RegField<Register, 0, 16, uint32_t> kLen{};
+  };
+
+  struct LTOH {
+    using Register = SpiRegisterMap::LTOH;
+    static constexpr RegField<Register, 0, 4, uint32_t> kToh{};
+  };
+
+  struct DC {
+    using Register = SpiRegisterMap::DC;
+    static constexpr RegField<Register, 0, 8, uint32_t> kTdreq{};
+    static constexpr RegField<Register, 8, 8, uint32_t> kTpanic{};
+    static constexpr RegField<Register, 16, 8, uint32_t> kRdreq{};
+    static constexpr RegField<Register, 24, 8, uint32_t> kRpanic{};
+  };
+};
+
+}  // namespace rpl
+
+#endif  // RPL4_REGISTERS_FIELDS_SPI_HPP_
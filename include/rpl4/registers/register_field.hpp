@@ -0,0 +1,138 @@
+#ifndef RPL4_REGISTERS_REGISTER_FIELD_HPP_
+#define RPL4_REGISTERS_REGISTER_FIELD_HPP_
+
+#include <cstdint>
+
+namespace rpl {
+
+/**
+ * @brief Values of one or more fields of a 32-bit register.
+ * @details Built by calling a RegField and combined with operator|, so the
+ *          fields are composed at compile time and written to the device with
+ *          a single access. Values of different registers cannot be combined.
+ *
+ * @tparam Register Bitfield struct of the register, e.g. SpiRegisterMap::CS
+ */
+template <typename Register>
+class RegValue {
+ public:
+  constexpr RegValue(uint32_t value, uint32_t mask)
+      : value_(value), mask_(mask) {}
+
+  // Bits of the fields
+  constexpr uint32_t GetValue() const { return value_; }
+  // Bits covered by the fields
+  constexpr uint32_t GetMask() const { return mask_; }
+
+  /**
+   * @brief Replace the fields in a whole register value.
+   *
+   * @param raw Current value of the register
+   * @return uint32_t
+   */
+  constexpr uint32_t ApplyTo(uint32_t raw) const {
+    return (raw & ~mask_) | value_;
+  }
+
+  constexpr RegValue operator|(RegValue other) const {
+    return RegValue((value_ & ~other.mask_) | other.value_,
+                    mask_ | other.mask_);
+  }
+
+ private:
+  uint32_t value_;
+  uint32_t mask_;
+};
+
+/**
+ * @brief Position of a field in a 32-bit register.
+ * @details The positions of the register maps are generated from the bitfield
+ *          structs by util/generate_register_fields.py, so that they do not
+ *          depend on how the compiler lays out bitfields.
+ *
+ * @tparam Register Bitfield struct of the register
+ * @tparam Offset Bit position of the least significant bit
+ * @tparam Width Number of bits
+ * @tparam T Type of the field value, usually the enum of the field
+ */
+template <typename Register, uint32_t Offset, uint32_t Width,
+          typename T = uint32_t>
+struct RegField {
+  static_assert(Width > 0 && Offset + Width <= 32,
+                "Field must fit in 32 bits");
+
+  static constexpr uint32_t kOffset = Offset;
+  static constexpr uint32_t kWidth = Width;
+  static constexpr uint32_t kMask =
+      (Width == 32 ? 0xffffffffu : ((1u << Width) - 1)) << Offset;
+
+  constexpr RegValue<Register> operator()(T value) const {
+    return RegValue<Register>((static_cast<uint32_t>(value) << Offset) & kMask,
+                              kMask);
+  }
+
+  /**
+   * @brief Get the value of the field from a whole register value.
+   *
+   * @param raw
+   * @return T
+   */
+  constexpr T Extract(uint32_t raw) const {
+    return static_cast<T>((raw & kMask) >> Offset);
+  }
+};
+
+/**
+ * @brief Read the whole register with one 32-bit load.
+ *
+ * @param reg
+ * @return uint32_t
+ */
+template <typename Register>
+inline uint32_t ReadRegister(const volatile Register& reg) {
+  return *reinterpret_cast<const volatile uint32_t*>(&reg);
+}
+
+/**
+ * @brief Read one field with one 32-bit load.
+ *
+ * @param reg
+ * @param field
+ * @return T
+ */
+template <typename Register, uint32_t Offset, uint32_t Width, typename T>
+inline T ReadField(const volatile Register& reg,
+                   RegField<Register, Offset, Width, T> field) {
+  return field.Extract(ReadRegister(reg));
+}
+
+/**
+ * @brief Write the register with one 32-bit store and no load.
+ * @note Fields that are not in value are written as 0.
+ *
+ * @param reg
+ * @param value
+ */
+template <typename Register>
+inline void WriteRegister(volatile Register& reg, RegValue<Register> value) {
+  *reinterpret_cast<volatile uint32_t*>(&reg) = value.GetValue();
+}
+
+/**
+ * @brief Change the fields in value and keep the others, with one 32-bit
+ *        load and one 32-bit store.
+ * @note Bits that are cleared by writing 1 and read back as 1 are written
+ *       back as 1, the same as with a bitfield assignment.
+ *
+ * @param reg
+ * @param value
+ */
+template <typename Register>
+inline void ModifyRegister(volatile Register& reg, RegValue<Register> value) {
+  volatile uint32_t* raw = reinterpret_cast<volatile uint32_t*>(&reg);
+  *raw = value.ApplyTo(*raw);
+}
+
+}  // namespace rpl
+
+#endif  // RPL4_REGISTERS_REGISTER_FIELD_HPP_
@@ -6,6 +6,7 @@
 #include "rpl4/registers/registers_bsc.hpp"
 #include "rpl4/registers/registers_clock.hpp"
 #include "rpl4/registers/registers_dma.hpp"
+#include "rpl4/registers/registers_dma4.hpp"
 #include "rpl4/registers/registers_gpio.hpp"
 #include "rpl4/registers/registers_pwm.hpp"
 #include "rpl4/registers/registers_spi.hpp"
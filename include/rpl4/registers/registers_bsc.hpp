@@ -24,6 +24,29 @@ typedef struct
     volatile uint32_t CLKT;   // 0x1c
 } BSC_Typedef;
 
+// C register bits
+const uint32_t BSC_C_I2CEN  = 1 << 15;  // I2C Enable
+const uint32_t BSC_C_INTR   = 1 << 10;  // Interrupt on RX
+const uint32_t BSC_C_INTT   = 1 << 9;   // Interrupt on TX
+const uint32_t BSC_C_INTD   = 1 << 8;   // Interrupt on DONE
+const uint32_t BSC_C_ST     = 1 << 7;   // Start Transfer
+const uint32_t BSC_C_CLEAR  = 3 << 4;   // FIFO Clear
+const uint32_t BSC_C_READ   = 1 << 0;   // Read Transfer
+
+// S register bits
+const uint32_t BSC_S_CLKT   = 1 << 9;   // Clock Stretch Timeout (W1C)
+const uint32_t BSC_S_ERR    = 1 << 8;   // ACK Error (W1C)
+const uint32_t BSC_S_RXF    = 1 << 7;   // FIFO Full
+const uint32_t BSC_S_TXE    = 1 << 6;   // FIFO Empty
+const uint32_t BSC_S_RXD    = 1 << 5;   // FIFO contains Data
+const uint32_t BSC_S_TXD    = 1 << 4;   // FIFO can accept Data
+const uint32_t BSC_S_RXR    = 1 << 3;   // FIFO needs Reading (full)
+const uint32_t BSC_S_TXW    = 1 << 2;   // FIFO needs Writing (full)
+const uint32_t BSC_S_DONE   = 1 << 1;   // Transfer Done (W1C)
+const uint32_t BSC_S_TA     = 1 << 0;   // Transfer Active
+
+const uint32_t BSC_FIFO_DEPTH = 16;
+
 extern BSC_Typedef*  REG_BSC0;
 extern BSC_Typedef*  REG_BSC1;
 extern BSC_Typedef*  REG_BSC3;
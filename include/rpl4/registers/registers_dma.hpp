@@ -22,6 +22,8 @@ constexpr uint32_t kDma13AddressBase = 0xFE007D00;
 constexpr uint32_t kDma14AddressBase = 0xFEE05000;
 constexpr uint32_t kDmaRegisterSize = 0x00000100;
 constexpr uint32_t kDmaEnableAddressBase = 0xFE007FF0;
+// DMA sees the peripherals at bus address 0x7Exxxxxx instead of 0xFExxxxxx.
+constexpr uint32_t kPeripheralBusOffset = 0xFE000000 - 0x7E000000;
 
 struct DmaRegisterMap {
   /**
@@ -0,0 +1,267 @@
+#ifndef RPL4_REGISTERS_DMA4_HPP_
+#define RPL4_REGISTERS_DMA4_HPP_
+
+#include <cstdint>
+
+#include "rpl4/registers/registers_dma.hpp"
+
+namespace rpl {
+
+// DMA channels 11 ~ 14 of BCM2711 are DMA4 engines. 11 ~ 13 are the same
+// registers as REG_DMA11 ~ REG_DMA13, seen with the DMA4 layout.
+constexpr uint32_t kDma4Channel11AddressBase = 0xFE007B00;
+constexpr uint32_t kDma4Channel12AddressBase = 0xFE007C00;
+constexpr uint32_t kDma4Channel13AddressBase = 0xFE007D00;
+constexpr uint32_t kDma4Channel14AddressBase = 0xFE007E00;
+
+// DMA4 addresses are 40 bits. The peripherals are at 0x4_7Exx_xxxx instead
+// of the legacy bus address 0x7Exx_xxxx. Memory is at its ARM physical
+// address, i.e. the legacy bus address without the 0xC0000000 alias bits.
+constexpr uint64_t kDma4PeripheralBusBase = 0x400000000;
+constexpr uint32_t kDma4MemoryBusAliasMask = 0x3FFFFFFF;
+
+struct Dma4RegisterMap {
+  /**
+   * @brief DMA4 Control and Status
+   */
+  struct CS {
+    CS(const volatile CS&);
+    volatile CS& operator=(const volatile CS&) volatile;
+    CS& operator=(const volatile CS&);
+    volatile CS& operator=(const CS&) volatile;
+
+    enum class ACTIVE : uint32_t {
+      kInactive = 0b0,
+      kActive = 0b1,
+    };
+
+    enum class END : uint32_t {
+      kNotSet = 0b0,
+      kSet = 0b1,
+    };
+
+    enum class INT : uint32_t {
+      kNotSet = 0b0,
+      kSet = 0b1,
+    };
+
+    enum class DREQ : uint32_t {
+      kNotSet = 0b0,
+      kSet = 0b1,
+    };
+
+    enum class PAUSED : uint32_t {
+      kNotPaused = 0b0,
+      kPaused = 0b1,
+    };
+
+    enum class DREQ_STOPS_DMA : uint32_t {
+      kNotPaused = 0b0,
+      kPaused = 0b1,
+    };
+
+    enum class WAITING_FOR_OUTSTANDING_WRITES : uint32_t {
+      kNotWaiting = 0b0,
+      kWaiting = 0b1,
+    };
+
+    enum class ERROR : uint32_t {
+      kNoError = 0b0,
+      kError = 0b1,
+    };
+
+    enum class BUSY : uint32_t {
+      kIdle = 0b0,
+      kBusy = 0b1,
+    };
+
+    enum class WAIT_FOR_OUTSTANDING_WRITES : uint32_t {
+      kDisable = 0b0,
+      kEnable = 0b1,
+    };
+
+    enum class DISDEBUG : uint32_t {
+      kEnable = 0b0,
+      kDisable = 0b1,
+    };
+
+    enum class ABORT : uint32_t {
+      kNoEffect = 0b0,
+      kAbort = 0b1,
+    };
+
+    enum class HALT : uint32_t {
+      kNoEffect = 0b0,
+      kHalt = 0b1,
+    };
+
+    ACTIVE active : 1;                        // bit 0
+    END end : 1;                              // bit 1
+    INT interrupt : 1;                        // bit 2
+    DREQ dreq : 1;                            // bit 3
+    PAUSED read_paused : 1;                   // bit 4
+    PAUSED write_paused : 1;                  // bit 5
+    DREQ_STOPS_DMA dreq_stops_dma : 1;        // bit 6
+    WAITING_FOR_OUTSTANDING_WRITES waiting_for_outstanding_writes : 1;  // bit 7
+    uint32_t reserved1 : 2;                   // bits 8-9
+    ERROR error : 1;                          // bit 10
+    uint32_t reserved2 : 5;                   // bits 11-15
+    uint32_t qos : 4;                         // bits 16-19
+    uint32_t panic_qos : 4;                   // bits 20-23
+    BUSY dma_busy : 1;                        // bit 24
+    uint32_t outstanding_transactions : 1;    // bit 25
+    uint32_t reserved3 : 2;                   // bits 26-27
+    WAIT_FOR_OUTSTANDING_WRITES wait_for_outstanding_writes : 1;  // bit 28
+    DISDEBUG disdebug : 1;                    // bit 29
+    ABORT abort : 1;                          // bit 30
+    HALT halt : 1;                            // bit 31
+  };
+
+  /**
+   * @brief DMA4 Control Block Address
+   */
+  struct CB {
+    CB(const volatile CB&);
+    volatile CB& operator=(const volatile CB&) volatile;
+    CB& operator=(const volatile CB&);
+    volatile CB& operator=(const CB&) volatile;
+
+    uint32_t address : 32;  // Control Block Address >> 5
+  };
+
+  /**
+   * @brief DMA4 Transfer Information
+   */
+  struct TI {
+    TI(const volatile TI&);
+    volatile TI& operator=(const volatile TI&) volatile;
+    TI& operator=(const volatile TI&);
+    volatile TI& operator=(const TI&) volatile;
+
+    // The DREQ numbers are shared with the legacy channels.
+    using PERMAP = DmaRegisterMap::TI::PERMAP;
+
+    enum class INTEN : uint32_t {
+      kDisable = 0b0,
+      kEnable = 0b1,
+    };
+
+    enum class TDMODE : uint32_t {
+      kLinear = 0b0,
+      k2D = 0b1,
+    };
+
+    enum class WAIT_RESP : uint32_t {
+      kDisable = 0b0,
+      kEnable = 0b1,
+    };
+
+    enum class WAIT_RD_RESP : uint32_t {
+      kDisable = 0b0,
+      kEnable = 0b1,
+    };
+
+    enum class S_DREQ : uint32_t {
+      kDisable = 0b0,
+      kEnable = 0b1,
+    };
+
+    enum class D_DREQ : uint32_t {
+      kDisable = 0b0,
+      kEnable = 0b1,
+    };
+
+    INTEN inten : 1;                // bit 0
+    TDMODE tdmode : 1;              // bit 1
+    WAIT_RESP wait_resp : 1;        // bit 2
+    WAIT_RD_RESP wait_rd_resp : 1;  // bit 3
+    uint32_t reserved1 : 5;         // bits 4-8
+    PERMAP permap : 5;              // bits 9-13
+    S_DREQ s_dreq : 1;              // bit 14
+    D_DREQ d_dreq : 1;              // bit 15
+    uint32_t s_waits : 8;           // bits 16-23
+    uint32_t d_waits : 8;           // bits 24-31
+  };
+
+  /**
+   * @brief DMA4 Source or Destination Information
+   */
+  struct INFO {
+    INFO(const volatile INFO&);
+    volatile INFO& operator=(const volatile INFO&) volatile;
+    INFO& operator=(const volatile INFO&);
+    volatile INFO& operator=(const INFO&) volatile;
+
+    enum class INC : uint32_t {
+      kDisable = 0b0,
+      kEnable = 0b1,
+    };
+
+    enum class SIZE : uint32_t {
+      k32Bit = 0b00,
+      k64Bit = 0b01,
+      k128Bit = 0b10,
+      k256Bit = 0b11,
+    };
+
+    enum class IGNORE : uint32_t {
+      kDisable = 0b0,
+      kEnable = 0b1,
+    };
+
+    uint32_t address_high : 8;  // bits 0-7: Address bits 32-39
+    uint32_t burst_length : 4;  // bits 8-11: Beats per burst - 1
+    INC inc : 1;                // bit 12
+    SIZE size : 2;              // bits 13-14
+    IGNORE ignore : 1;          // bit 15
+    uint32_t stride : 16;       // bits 16-31: 2D stride (signed)
+  };
+
+  /**
+   * @brief DMA4 Transfer Length
+   */
+  struct LEN {
+    LEN(const volatile LEN&);
+    volatile LEN& operator=(const volatile LEN&) volatile;
+    LEN& operator=(const volatile LEN&);
+    volatile LEN& operator=(const LEN&) volatile;
+
+    uint32_t length : 30;  // Transfer Length in bytes (linear mode)
+    uint32_t reserved : 2;
+  };
+
+  volatile CS cs;               // 0x00
+  volatile CB cb;               // 0x04
+  volatile uint32_t reserved1;  // 0x08
+  volatile uint32_t debug;      // 0x0C
+  volatile TI ti;               // 0x10
+  volatile uint32_t src;        // 0x14: Source Address bits 0-31
+  volatile INFO srci;           // 0x18
+  volatile uint32_t dest;       // 0x1C: Destination Address bits 0-31
+  volatile INFO desti;          // 0x20
+  volatile LEN len;             // 0x24
+  volatile CB next_cb;          // 0x28
+  volatile uint32_t debug2;     // 0x2C
+  volatile uint32_t reserved2[52];  // 0x30-0xFF
+};
+
+extern Dma4RegisterMap* REG_DMA4_CHANNEL11;
+extern Dma4RegisterMap* REG_DMA4_CHANNEL12;
+extern Dma4RegisterMap* REG_DMA4_CHANNEL13;
+extern Dma4RegisterMap* REG_DMA4_CHANNEL14;
+
+// DMA4 Control Block structure (must be 32-byte aligned in physical memory)
+struct Dma4ControlBlock {
+  volatile Dma4RegisterMap::TI transfer_info;  // Transfer Information
+  volatile uint32_t source_addr;    // Source Address bits 0-31
+  volatile Dma4RegisterMap::INFO source_info;  // Source Information
+  volatile uint32_t dest_addr;      // Destination Address bits 0-31
+  volatile Dma4RegisterMap::INFO dest_info;    // Destination Information
+  volatile uint32_t transfer_length;  // Transfer Length
+  volatile uint32_t next_control_block;  // Next Control Block Address >> 5
+  volatile uint32_t reserved;            // Reserved
+};
+
+}  // namespace rpl
+
+#endif  // RPL4_REGISTERS_DMA4_HPP_
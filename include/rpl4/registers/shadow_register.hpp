@@ -0,0 +1,106 @@
+#ifndef RPL4_REGISTERS_SHADOW_REGISTER_HPP_
+#define RPL4_REGISTERS_SHADOW_REGISTER_HPP_
+
+#include <cstdint>
+
+#include "rpl4/system/trace.hpp"
+
+namespace rpl {
+
+/**
+ * @brief Copy of a 32-bit device register kept in normal memory.
+ * @details Fields are changed in the copy through operator->, which costs no
+ *          device access, and written to the device with a single 32-bit
+ *          store by Commit() or CommitChanged(). Getters read the copy, so
+ *          they do not touch the device either.
+ *
+ *          The copy is only valid as long as the register is not written
+ *          through the register map directly. Call Reload() after doing so.
+ *
+ * @tparam Register Bitfield struct of the register, e.g. SpiRegisterMap::CS
+ */
+template <typename Register>
+class ShadowRegister {
+  static_assert(sizeof(Register) == sizeof(uint32_t),
+                "Register must be 32 bits wide");
+
+ public:
+  /**
+   * @param device Register in the register map
+   * @param peripheral Peripheral the accesses are counted for in trace builds
+   */
+  ShadowRegister(volatile Register* device, Trace::Peripheral peripheral)
+      : device_(reinterpret_cast<volatile uint32_t*>(device)),
+        peripheral_(peripheral) {
+    Reload();
+  }
+
+  ShadowRegister(const ShadowRegister&) = delete;
+  ShadowRegister& operator=(const ShadowRegister&) = delete;
+
+  inline Register* operator->() { return &shadow_.fields; }
+  inline const Register* operator->() const { return &shadow_.fields; }
+
+  /**
+   * @brief Get the whole value of the copy.
+   *
+   * @return uint32_t
+   */
+  inline uint32_t GetValue() const { return shadow_.raw; }
+
+  /**
+   * @brief Read the device register into the copy. One device read.
+   */
+  inline void Reload() {
+    shadow_.raw = *device_;
+    committed_ = shadow_.raw;
+    Trace::CountRead(peripheral_);
+  }
+
+  /**
+   * @brief Store the whole copy to the device if it was changed since the
+   *        last commit. No device read.
+   * @note Only for registers whose writable bits are all owned by the copy.
+   */
+  inline void Commit() {
+    if (shadow_.raw == committed_) { return; }
+    *device_ = shadow_.raw;
+    committed_ = shadow_.raw;
+    Trace::CountWrite(peripheral_);
+  }
+
+  /**
+   * @brief Write only the bits that were changed since the last commit. The
+   *        other bits are kept as they are in the device, so this is one
+   *        device read and one store.
+   * @details Use this for registers that also hold status bits or bits that
+   *          are changed without going through the copy, such as SPI CS.TA.
+   */
+  inline void CommitChanged() {
+    uint32_t changed = shadow_.raw ^ committed_;
+    if (changed == 0) { return; }
+    *device_ = (*device_ & ~changed) | (shadow_.raw & changed);
+    committed_ = shadow_.raw;
+    Trace::CountRead(peripheral_);
+    Trace::CountWrite(peripheral_);
+  }
+
+ private:
+  // The register structs have no usable constructors, so the copy is held
+  // as a raw word and accessed through the bitfields.
+  union Storage {
+    Storage() : raw(0) {}
+    uint32_t raw;
+    Register fields;
+  };
+
+  volatile uint32_t* device_;
+  Trace::Peripheral peripheral_;
+  Storage shadow_;
+  // Value of the copy at the last commit or reload.
+  uint32_t committed_ = 0;
+};
+
+}  // namespace rpl
+
+#endif  // RPL4_REGISTERS_SHADOW_REGISTER_HPP_
@@ -0,0 +1,56 @@
+#ifndef RPL4_SYSTEM_BUS_MUTEX_HPP_
+#define RPL4_SYSTEM_BUS_MUTEX_HPP_
+
+#include <atomic>
+#include <cstdint>
+
+namespace rpl {
+
+/**
+ * @brief Mutex that spins briefly and then sleeps on a futex.
+ * @details Taking an uncontended lock is a single compare-and-swap and
+ *          releasing it is a single exchange; the kernel is only entered when
+ *          another thread is actually waiting. Satisfies the Lockable
+ *          requirements, so it can be used with std::lock_guard.
+ */
+class BusMutex {
+ public:
+  constexpr BusMutex() = default;
+  BusMutex(const BusMutex&) = delete;
+  BusMutex& operator=(const BusMutex&) = delete;
+
+  inline void lock() {
+    uint32_t expected = kUnlocked;
+    if (!state_.compare_exchange_strong(expected, kLocked,
+                                        std::memory_order_acquire)) {
+      LockSlow();
+    }
+  }
+
+  inline bool try_lock() {
+    uint32_t expected = kUnlocked;
+    return state_.compare_exchange_strong(expected, kLocked,
+                                          std::memory_order_acquire);
+  }
+
+  inline void unlock() {
+    if (state_.exchange(kUnlocked, std::memory_order_release) == kContended) {
+      WakeOne();
+    }
+  }
+
+ private:
+  static constexpr uint32_t kUnlocked = 0;
+  static constexpr uint32_t kLocked = 1;     // Locked, no waiters
+  static constexpr uint32_t kContended = 2;  // Locked, may have waiters
+  static constexpr int kSpinCount = 100;
+
+  void LockSlow();
+  void WakeOne();
+
+  std::atomic<uint32_t> state_{kUnlocked};
+};
+
+}  // namespace rpl
+
+#endif  // RPL4_SYSTEM_BUS_MUTEX_HPP_
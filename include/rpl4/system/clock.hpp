@@ -1,7 +1,11 @@
 #ifndef RPL4_SYSTEM_CLOCK_HPP_
 #define RPL4_SYSTEM_CLOCK_HPP_
 
+#include <array>
 #include <cstdint>
+#include <mutex>
+
+#include "rpl4/system/instance_registry.hpp"
 
 namespace rpl {
 
@@ -9,14 +13,170 @@ enum class ClockSource : uint8_t {
   kGnd = 0,   // 0Hz
   kOsc = 1,   // 54MHz
   kPllA = 4,  // 0Hz
-  kPllC = 5,  // ?MHz
-  kPllD = 6,  // ?MHz
+  kPllC = 5,  // 1000MHz, follows the core clock
+  kPllD = 6,  // 750MHz
   kHdmi = 7   // ?MHz
 };
 
+// Nominal frequencies of the clock sources on the BCM2711.
+constexpr double kOscFrequency = 54000000.0;
+constexpr double kPllDFrequency = 750000000.0;
+// PLLC is derived from the core clock, which the firmware may scale.
+constexpr double kPllCFrequency = 1000000000.0;
+
+/**
+ * @brief Configure a clock with a raw divisor.
+ * @details Prefer ClockManager, which chooses the source, the divisor and the
+ *          MASH level for a frequency and does not reprogram a clock that is
+ *          already running as requested.
+ *
+ * @param reg_ctl CM_xxxCTL register
+ * @param reg_div CM_xxxDIV register
+ * @param src
+ * @param div 1.0 ~ 4095.99
+ * @param mash 0 ~ 3
+ */
 void ClockConfig(volatile uint32_t& reg_ctl, volatile uint32_t& reg_div,
                  ClockSource src, double div, uint8_t mash);
 
+/**
+ * @brief Requirements of a clock frequency for ClockManager::Plan().
+ */
+struct ClockRequest {
+  double frequency = 0.0;  // Hz
+  // Highest MASH level that may be used. 0 : integer divisors only
+  uint8_t max_mash = 1;
+  // Whether PLLC may be used. Its frequency changes with the core clock.
+  bool allow_pllc = false;
+  // Relative frequency error accepted in favour of less jitter
+  double tolerance = 1e-6;
+};
+
+/**
+ * @brief Settings of a clock and the frequency they produce.
+ */
+struct ClockPlan {
+  ClockSource source = ClockSource::kGnd;
+  uint16_t divi = 0;  // Integer part of the divisor
+  uint16_t divf = 0;  // Fractional part of the divisor in 1/4096
+  uint8_t mash = 0;
+  double frequency = 0.0;  // Average output frequency in Hz
+  double error = 0.0;      // (frequency - requested) / requested
+  // Peak-to-peak period jitter caused by the MASH noise shaping in ns
+  double jitter_ns = 0.0;
+
+  inline bool IsValid() const { return divi != 0; }
+};
+
+/**
+ * @brief Frequency planning and configuration of the general purpose, PCM
+ *        and PWM clocks.
+ * @details The settings applied to each clock are cached, so setting the
+ *          frequency a clock already runs at costs no register access and
+ *          does not stop the clock. Otherwise the clock is stopped, its BUSY
+ *          flag is waited for with a timeout, and it is restarted with the new
+ *          settings.
+ */
+class ClockManager {
+ public:
+  enum class Clock : size_t {
+    kGp0 = 0,
+    kGp1 = 1,
+    kGp2 = 2,
+    kPcm = 3,
+    kPwm = 4,
+  };
+
+  /**
+   * @brief Get the ClockManager instance.
+   *
+   * @return ClockManager* nullptr if RPL is not initialized.
+   */
+  static ClockManager* GetInstance();
+
+  ClockManager(const ClockManager&) = delete;
+  ClockManager& operator=(const ClockManager&) = delete;
+  ClockManager(ClockManager&&) = delete;
+  ClockManager& operator=(ClockManager&&) = delete;
+  ~ClockManager() = default;
+
+  /**
+   * @brief Choose the source, the divisor and the MASH level for a frequency.
+   * @details Among the settings within request.tolerance of the frequency,
+   *          the one with the least jitter is chosen, preferring OSC, then
+   *          PLLD, then PLLC. If none is within the tolerance, the one closest
+   *          to the frequency is chosen. No register is accessed.
+   *
+   * @param request
+   * @return ClockPlan Invalid if no setting can produce the frequency.
+   */
+  static ClockPlan Plan(const ClockRequest& request);
+
+  /**
+   * @brief Plan the frequency and apply it to the clock.
+   *
+   * @param clock
+   * @param request
+   * @return ClockPlan Applied settings. Invalid if the frequency cannot be
+   *         produced or the clock did not stop.
+   */
+  ClockPlan SetFrequency(Clock clock, const ClockRequest& request);
+
+  /**
+   * @brief Apply settings to the clock and enable it.
+   *
+   * @param clock
+   * @param plan
+   * @return true if the clock runs with the settings. false if the clock did
+   *         not stop and was killed, in which case it is left stopped.
+   */
+  bool Apply(Clock clock, const ClockPlan& plan);
+
+  /**
+   * @brief Stop the clock.
+   *
+   * @param clock
+   */
+  void Stop(Clock clock);
+
+  /**
+   * @brief Get the settings the clock currently runs with.
+   *
+   * @param clock
+   * @return ClockPlan Invalid if the clock is stopped.
+   */
+  ClockPlan GetPlan(Clock clock);
+
+  /**
+   * @brief Output a general purpose clock on a GPIO pin.
+   *
+   * @param clock kGp0, kGp1 or kGp2
+   * @param pin GPCLK0 : 4, 20, 32, 34. GPCLK1 : 5, 21, 42, 44.
+   *            GPCLK2 : 6, 43
+   * @return true if the pin has the clock function
+   */
+  static bool ConfigureGpioPin(Clock clock, uint8_t pin);
+
+ private:
+  ClockManager() = default;
+
+  static InstanceRegistry<ClockManager, 1> instance_;
+
+  static constexpr size_t kNumOfClocks = 5;
+
+  struct State {
+    bool known = false;  // Whether the registers have been read
+    bool enabled = false;
+    ClockPlan plan;
+  };
+
+  // Read the settings of the clock from the registers into the cache.
+  void LoadState(Clock clock, State& state);
+
+  std::mutex mutex_;
+  std::array<State, kNumOfClocks> states_;
+};
+
 }  // namespace rpl
 
-#endif  // RPL4_SYSTEM_CLOCK_HPP_
\ No newline at end of file
+#endif  // RPL4_SYSTEM_CLOCK_HPP_
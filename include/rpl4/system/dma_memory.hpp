@@ -49,6 +49,28 @@ class DmaMemory {
    */
   uint32_t GetPhysicalAddress(void* virtual_addr);
 
+  /**
+   * @brief Check whether a range lies in one allocated block, without
+   *        logging an error if it does not
+   * @param virtual_addr Start of the range
+   * @param size Size of the range in bytes
+   * @return true if the whole range has physical addresses
+   */
+  bool Contains(const void* virtual_addr, size_t size) const;
+
+  /**
+   * @brief Fill words of DMA memory with a value
+   * @details DMA memory is uncached, so memset and the loops a compiler turns
+   *          into memset may use unaligned or wider accesses, which cause a
+   *          bus error. The words are stored one by one through a volatile
+   *          pointer instead.
+   * @param words First word
+   * @param count Number of words
+   * @param value Value of each word
+   */
+  static void FillWords(volatile uint32_t* words, size_t count,
+                        uint32_t value);
+
   /**
    * @brief Allocate and construct an object in DMA memory
    * @tparam T Type of object to allocate
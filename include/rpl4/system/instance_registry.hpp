@@ -0,0 +1,88 @@
+#ifndef RPL4_SYSTEM_INSTANCE_REGISTRY_HPP_
+#define RPL4_SYSTEM_INSTANCE_REGISTRY_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+namespace rpl {
+
+/**
+ * @brief Fixed-size table of peripheral instances that are created on first
+ *        use.
+ * @details Each slot is constructed exactly once even if several threads ask
+ *          for it at the same time. Once a slot has been created, looking it
+ *          up is a single acquire load without locks or reference counting.
+ *          Instances live until the process exits, so the returned pointers
+ *          stay valid.
+ *
+ * @tparam T Peripheral class
+ * @tparam N Number of slots
+ */
+template <typename T, size_t N>
+class InstanceRegistry {
+ public:
+  constexpr InstanceRegistry() = default;
+  InstanceRegistry(const InstanceRegistry&) = delete;
+  InstanceRegistry& operator=(const InstanceRegistry&) = delete;
+
+  /**
+   * @brief Get the instance in the slot, creating it with factory if the slot
+   *        is empty.
+   *
+   * @param index Must be less than N
+   * @param factory Returns a pointer allocated with new, or nullptr on error.
+   * @return T* nullptr if factory failed.
+   */
+  template <typename Factory>
+  T* GetOrCreate(size_t index, Factory&& factory) {
+    Slot& slot = slots_[index];
+    T* instance = slot.instance.load(std::memory_order_acquire);
+    if (instance != nullptr) { return instance; }
+
+    uint8_t expected = kEmpty;
+    if (slot.state.compare_exchange_strong(expected, kConstructing,
+                                           std::memory_order_acq_rel)) {
+      instance = factory();
+      slot.instance.store(instance, std::memory_order_release);
+      // A failed factory leaves the slot empty so that it can be retried.
+      slot.state.store(instance != nullptr ? kReady : kEmpty,
+                       std::memory_order_release);
+      return instance;
+    }
+
+    // Another thread is constructing the instance.
+    while (slot.state.load(std::memory_order_acquire) == kConstructing) {
+      std::this_thread::yield();
+    }
+    return slot.instance.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief Get the instance in the slot without creating it.
+   *
+   * @param index Must be less than N
+   * @return T* nullptr if the slot has not been created.
+   */
+  inline T* Get(size_t index) const {
+    return slots_[index].instance.load(std::memory_order_acquire);
+  }
+
+ private:
+  static constexpr uint8_t kEmpty = 0;
+  static constexpr uint8_t kConstructing = 1;
+  static constexpr uint8_t kReady = 2;
+
+  struct Slot {
+    std::atomic<T*> instance{nullptr};
+    std::atomic<uint8_t> state{kEmpty};
+  };
+
+  std::array<Slot, N> slots_{};
+};
+
+}  // namespace rpl
+
+#endif  // RPL4_SYSTEM_INSTANCE_REGISTRY_HPP_
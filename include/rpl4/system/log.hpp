@@ -1,6 +1,7 @@
 #ifndef RPL4_MESSAGE_HPP_
 #define RPL4_MESSAGE_HPP_
 
+#include <cstdint>
 #include <string>
 
 namespace rpl {
@@ -13,8 +14,101 @@ enum class LogLevel {
     Debug   = 4
 };
 
-void Log(LogLevel lebel, const char* format, ...);
+// Earlier build scripts defined the level under this misspelled name.
+#if defined(RPL4_LOG_LEBVEL) && !defined(RPL4_LOG_LEVEL)
+#define RPL4_LOG_LEVEL RPL4_LOG_LEBVEL
+#endif
 
+/**
+ * @brief Whether messages of the level are output in this build.
+ * @details Fatal is always enabled, as it also terminates the program.
+ *
+ * @param level
+ * @return true if RPL4_LOG_LEVEL includes the level
+ */
+constexpr bool IsLogLevelEnabled(LogLevel level) {
+#ifdef RPL4_LOG_LEVEL
+  return level == LogLevel::Fatal || level <= RPL4_LOG_LEVEL;
+#else
+  return level == LogLevel::Fatal;
+#endif
 }
 
-#endif
\ No newline at end of file
+/**
+ * @brief Output a printf-style message.
+ * @details The format string is checked against the arguments at compile
+ *          time. Prefer RPL4_LOG(), which also removes disabled messages.
+ */
+void Log(LogLevel lebel, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Where Log() formats and writes the messages.
+ */
+enum class LogMode {
+  // Format and write on the calling thread. This is the default.
+  kSynchronous,
+  // Copy the format pointer and the arguments into a lock-free ring and
+  // format and write them on a background thread.
+  kAsynchronous,
+};
+
+/**
+ * @brief Counters of the asynchronous mode.
+ */
+struct LogStats {
+  uint64_t queued = 0;     // Records pushed into the ring
+  uint64_t written = 0;    // Records written by the background thread
+  uint64_t dropped = 0;    // Records dropped because the ring was full
+  uint64_t truncated = 0;  // Records with too many or too long arguments
+};
+
+/**
+ * @brief Switch between synchronous and asynchronous logging.
+ * @details In the asynchronous mode Log() does not format, allocate, lock or
+ *          write; it parses the format string to copy the arguments and pushes
+ *          a fixed-size record, so a message costs well under a microsecond.
+ *          When the ring is full the message is dropped and counted instead
+ *          of blocking the caller. %s arguments are copied, as the caller's
+ *          string may be gone when the record is formatted. Fatal messages
+ *          flush the ring and are written synchronously.
+ *
+ *          Switching back to kSynchronous writes the queued records and
+ *          stops the background thread. This is also done at exit.
+ *
+ * @param mode
+ */
+void SetLogMode(LogMode mode);
+
+LogMode GetLogMode();
+
+/**
+ * @brief Wait until the records queued so far have been written.
+ */
+void FlushLog();
+
+/**
+ * @brief Get the counters of the asynchronous mode.
+ *
+ * @return LogStats
+ */
+LogStats GetLogStats();
+
+}
+
+/**
+ * @brief Output a message through rpl::Log() only if its level is enabled in
+ *        this build.
+ * @details The level must be a constant such as rpl::LogLevel::Warning. A
+ *          disabled message is removed at compile time, including the
+ *          evaluation of its arguments, so it costs nothing in hot paths. The
+ *          format string is still checked.
+ */
+#define RPL4_LOG(level, ...)                                 \
+  do {                                                       \
+    if constexpr (::rpl::IsLogLevelEnabled((level))) {       \
+      ::rpl::Log((level), __VA_ARGS__);                      \
+    }                                                        \
+  } while (0)
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef RPL4_SYSTEM_METRICS_HPP_
+#define RPL4_SYSTEM_METRICS_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace rpl {
+
+/**
+ * @brief Counter written by the thread that uses a driver instance and read
+ *        from any thread.
+ * @details Add() is a relaxed load and store instead of an atomic
+ *          read-modify-write, so it costs about as much as incrementing a
+ *          plain variable and never locks. Increments made by two threads
+ *          using the same instance at the same time can be lost; the drivers
+ *          need an external lock for that anyway, such as the bus lock of
+ *          SpiDevice.
+ */
+class MetricsCounter {
+ public:
+  inline void Add(uint64_t n = 1) {
+    value_.store(value_.load(std::memory_order_relaxed) + n,
+                 std::memory_order_relaxed);
+  }
+  inline uint64_t Get() const {
+    return value_.load(std::memory_order_relaxed);
+  }
+  inline void Reset() { value_.store(0, std::memory_order_relaxed); }
+
+ private:
+  std::atomic<uint64_t> value_{0};
+};
+
+/**
+ * @brief Latency histogram with logarithmic buckets, as in HdrHistogram.
+ * @details Values below kSubBuckets have their own bucket. Above that, each
+ *          power of two is split into kSubBuckets buckets, so a bucket is
+ *          within 1 / kSubBuckets (12.5%) of any value in it. Values of
+ *          2^kMaxBits ns (about 18 minutes) and more go to the last bucket.
+ *          Recording is a few counter updates with the same rules as
+ *          MetricsCounter.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr uint32_t kSubBucketBits = 3;
+  static constexpr uint32_t kSubBuckets = 1 << kSubBucketBits;
+  static constexpr uint32_t kMaxBits = 40;
+  static constexpr size_t kNumOfBuckets =
+      (kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+
+  struct Snapshot {
+    std::array<uint64_t, kNumOfBuckets> counts{};
+    uint64_t count = 0;
+    uint64_t sum = 0;  // ns
+    uint64_t min = 0;  // ns
+    uint64_t max = 0;  // ns
+
+    /**
+     * @brief Get the value below which the given fraction of the recorded
+     *        values fall.
+     *
+     * @param quantile 0.0 ~ 1.0
+     * @return uint64_t Upper bound of the bucket in ns, 0 if nothing has been
+     *         recorded.
+     */
+    uint64_t GetQuantile(double quantile) const;
+  };
+
+  void Record(uint64_t value);
+  Snapshot GetSnapshot() const;
+  void Reset();
+
+  static size_t GetBucketIndex(uint64_t value);
+  static uint64_t GetBucketUpperBound(size_t index);
+
+ private:
+  std::array<MetricsCounter, kNumOfBuckets> counts_;
+  MetricsCounter count_;
+  MetricsCounter sum_;
+  std::atomic<uint64_t> min_{UINT64_MAX};
+  std::atomic<uint64_t> max_{0};
+};
+
+/**
+ * @brief Counters and latency of one driver instance.
+ * @details Drivers update these once per call (per transfer, per DMA start,
+ *          per FIFO status check), never inside their word loops. The object
+ *          registers itself in Metrics when constructed and has to live until
+ *          the process exits, like the driver instances.
+ */
+class PeripheralMetrics {
+ public:
+  /**
+   * @param peripheral Name of the driver, e.g. "spi". Must be a literal.
+   * @param instance Number of the instance, e.g. 0 for SPI0
+   * @param has_latency Whether a latency histogram is kept
+   */
+  PeripheralMetrics(const char* peripheral, uint32_t instance,
+                    bool has_latency);
+
+  PeripheralMetrics(const PeripheralMetrics&) = delete;
+  PeripheralMetrics& operator=(const PeripheralMetrics&) = delete;
+
+  /**
+   * @brief Measures the latency of a scope.
+   */
+  class Timer {
+   public:
+    explicit Timer(PeripheralMetrics& metrics)
+        : metrics_(metrics), start_(std::chrono::steady_clock::now()) {}
+    ~Timer() {
+      metrics_.RecordLatency(std::chrono::steady_clock::now() - start_);
+    }
+
+   private:
+    PeripheralMetrics& metrics_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  inline void AddOperation(uint64_t bytes = 0) {
+    operations_.Add();
+    if (bytes > 0) { bytes_.Add(bytes); }
+  }
+  inline void AddError() { errors_.Add(); }
+  inline void AddTimeout() { timeouts_.Add(); }
+  inline void AddUnderflow(uint64_t n = 1) { underflows_.Add(n); }
+  inline void RecordLatency(std::chrono::nanoseconds latency) {
+    if (latency_ != nullptr) {
+      latency_->Record(static_cast<uint64_t>(latency.count()));
+    }
+  }
+
+  inline const char* GetPeripheral() const { return peripheral_; }
+  inline uint32_t GetInstance() const { return instance_; }
+  inline uint64_t GetOperations() const { return operations_.Get(); }
+  inline uint64_t GetBytes() const { return bytes_.Get(); }
+  inline uint64_t GetErrors() const { return errors_.Get(); }
+  inline uint64_t GetTimeouts() const { return timeouts_.Get(); }
+  inline uint64_t GetUnderflows() const { return underflows_.Get(); }
+  inline const LatencyHistogram* GetLatency() const { return latency_.get(); }
+
+  void Reset();
+
+ private:
+  friend class Metrics;
+
+  const char* peripheral_;
+  uint32_t instance_;
+  MetricsCounter operations_;  // Transfers, DMA starts, FIFO writes, ...
+  MetricsCounter bytes_;
+  MetricsCounter errors_;
+  MetricsCounter timeouts_;
+  MetricsCounter underflows_;
+  std::unique_ptr<LatencyHistogram> latency_;
+  // Next entry of the list in Metrics.
+  PeripheralMetrics* next_ = nullptr;
+};
+
+/**
+ * @brief Access to the metrics of all the driver instances created so far.
+ */
+class Metrics {
+ public:
+  struct PeripheralSnapshot {
+    const char* peripheral;
+    uint32_t instance;
+    uint64_t operations;
+    uint64_t bytes;
+    uint64_t errors;
+    uint64_t timeouts;
+    uint64_t underflows;
+    bool has_latency;
+    LatencyHistogram::Snapshot latency;
+  };
+
+  /**
+   * @brief Copy the metrics of every instance. Does not block the drivers.
+   *
+   * @return std::vector<PeripheralSnapshot> In order of creation
+   */
+  static std::vector<PeripheralSnapshot> Snapshot();
+
+  /**
+   * @brief Set all the metrics to 0.
+   */
+  static void Reset();
+
+  /**
+   * @brief Write the metrics in the Prometheus text exposition format. The
+   *        latency is written as a summary with quantiles.
+   *
+   * @param stream
+   */
+  static void WriteText(FILE* stream = stdout);
+
+ private:
+  friend class PeripheralMetrics;
+
+  static void Register(PeripheralMetrics* metrics);
+
+  static std::atomic<PeripheralMetrics*> head_;
+};
+
+}  // namespace rpl
+
+#endif  // RPL4_SYSTEM_METRICS_HPP_
@@ -29,6 +29,18 @@ bool IsInitialized(void);
 
 uint8_t Init(void);
 
+/**
+ * @brief Initialize rpl with the register maps backed by zeroed normal memory
+ *
+ * @details Every register reads back what was last written to it and no
+ *          peripheral is driven. This lets the drivers run on any Linux host,
+ *          e.g. for benchmarks of the driver code itself. Status bits that a
+ *          driver waits for have to be set by the caller.
+ *
+ * @return 0 on success
+ */
+uint8_t InitWithMemoryBackedRegisters(void);
+
 }  // namespace rpl
 
 #endif // RPL4_SYSTEM_HPP
\ No newline at end of file
@@ -0,0 +1,120 @@
+#ifndef RPL4_SYSTEM_TRACE_HPP_
+#define RPL4_SYSTEM_TRACE_HPP_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+namespace rpl {
+
+/**
+ * @brief Counts register accesses and busy waits of the peripheral drivers.
+ * @details Counting is compiled in only when RPL4_TRACE is defined (cmake
+ *          -DRPL4_TRACE=ON). Otherwise the counting functions are empty
+ *          inline functions and SpinTrace is an empty object, so the drivers
+ *          compile to the same code as without tracing. GetSnapshot() still
+ *          works and returns zeros.
+ */
+class Trace {
+ public:
+  enum class Peripheral : size_t {
+    kSpi = 0,
+    kAuxSpi = 1,
+    kDma = 2,
+    kPwm = 3,
+  };
+  static constexpr size_t kNumOfPeripherals = 4;
+
+  struct Counters {
+    uint64_t reads = 0;   // Register reads
+    uint64_t writes = 0;  // Register writes
+    uint64_t waits = 0;   // Busy-wait loops entered
+    uint64_t spins = 0;   // Iterations of the busy-wait loops
+    std::chrono::nanoseconds wait_time{0};  // Time spent in busy-wait loops
+  };
+
+  using Snapshot = std::array<Counters, kNumOfPeripherals>;
+
+  /**
+   * @brief Busy-wait measurement of one loop. Construct it right before the
+   *        loop and call Spin() in the loop body.
+   */
+  class SpinTrace {
+   public:
+#ifdef RPL4_TRACE
+    explicit SpinTrace(Peripheral peripheral)
+        : peripheral_(peripheral),
+          start_(std::chrono::steady_clock::now()) {}
+    ~SpinTrace() {
+      AddWait(peripheral_, spins_, std::chrono::steady_clock::now() - start_);
+    }
+    inline void Spin() { ++spins_; }
+
+   private:
+    Peripheral peripheral_;
+    std::chrono::steady_clock::time_point start_;
+    uint64_t spins_ = 0;
+#else
+    explicit SpinTrace(Peripheral) {}
+    inline void Spin() {}
+#endif
+  };
+
+#ifdef RPL4_TRACE
+  static void CountRead(Peripheral peripheral, uint32_t count = 1);
+  static void CountWrite(Peripheral peripheral, uint32_t count = 1);
+  static void AddWait(Peripheral peripheral, uint64_t spins,
+                      std::chrono::nanoseconds wait_time);
+#else
+  static inline void CountRead(Peripheral, uint32_t = 1) {}
+  static inline void CountWrite(Peripheral, uint32_t = 1) {}
+  static inline void AddWait(Peripheral, uint64_t, std::chrono::nanoseconds) {}
+#endif
+
+  /**
+   * @brief Get the counters of all peripherals.
+   *
+   * @return Snapshot Indexed by Peripheral
+   */
+  static Snapshot GetSnapshot();
+
+  /**
+   * @brief Set all the counters to 0.
+   */
+  static void Reset();
+
+  /**
+   * @brief Print the counters of the peripherals that have been used.
+   *
+   * @param stream
+   */
+  static void Dump(FILE* stream = stderr);
+
+  /**
+   * @brief Print the counters with Dump() when the program exits. Enabled by
+   *        default in trace builds.
+   *
+   * @param enable
+   */
+  static void SetDumpAtExit(bool enable);
+
+  static const char* GetPeripheralName(Peripheral peripheral);
+};
+
+/**
+ * @brief Busy-wait until done() returns true, measured as one wait of the
+ *        peripheral in trace builds.
+ *
+ * @param peripheral
+ * @param done
+ */
+template <typename Predicate>
+inline void SpinUntil(Trace::Peripheral peripheral, Predicate&& done) {
+  Trace::SpinTrace spin(peripheral);
+  while (!done()) { spin.Spin(); }
+}
+
+}  // namespace rpl
+
+#endif  // RPL4_SYSTEM_TRACE_HPP_
@@ -8,114 +8,278 @@
 
 namespace rpl {
 
-std::array<std::shared_ptr<AuxSpi>, AuxSpi::kNumOfInstances>
-    AuxSpi::instances_ = {nullptr};
+InstanceRegistry<AuxSpi, AuxSpi::kNumOfInstances> AuxSpi::instances_;
+
+AuxSpi* AuxSpi::GetInstance(Port port) {
+  size_t index = static_cast<size_t>(port);
+  if (index >= kNumOfInstances) {
+    RPL4_LOG(LogLevel::Fatal, "[SPI::GetInstance()] Invalid port %zu.", index);
+    return nullptr;
+  }
 
-std::shared_ptr<AuxSpi> AuxSpi::GetInstance(Port port) {
   if (!IsInitialized()) {
-    Log(LogLevel::Error, "[SPI::GetInstance()] RPL is not initialized.");
-  } else if (instances_[static_cast<size_t>(port)] == nullptr) {
+    RPL4_LOG(LogLevel::Error, "[SPI::GetInstance()] RPL is not initialized.");
+    return nullptr;
+  }
+  return instances_.GetOrCreate(index, [port]() -> AuxSpi* {
     switch (port) {
       case Port::kAuxSpi1:
-        instances_[static_cast<size_t>(port)] =
-            std::shared_ptr<AuxSpi>(new AuxSpi(REG_SPI1));
-        break;
+        return new AuxSpi(REG_SPI1, 1);
       case Port::kAuxSpi2:
-        instances_[static_cast<size_t>(port)] =
-            std::shared_ptr<AuxSpi>(new AuxSpi(REG_SPI2));
-        break;
-      default:
-        Log(LogLevel::Fatal,
-            "[SPI::GetInstance()] Invalid port was given as an argument.");
-        break;
+        return new AuxSpi(REG_SPI2, 2);
     }
-  }
-  return instances_[static_cast<size_t>(port)];
+    return nullptr;
+  });
 }
 
-AuxSpi::AuxSpi(AuxSpiRegisterMap* register_map) : register_map_(register_map) {}
+AuxSpi::AuxSpi(AuxSpiRegisterMap* register_map, uint32_t instance)
+    : register_map_(register_map),
+      cntl_0_(&register_map->cntl_0, kTracePeripheral),
+      cntl_1_(&register_map->cntl_1, kTracePeripheral),
+      metrics_("aux_spi", instance, true) {}
 
 void AuxSpi::SetClockDivider(uint16_t divider) {
   if (divider > 4095) {
-    Log(LogLevel::Error,
-        "[AuxSpi::SetClockDivider()] Invalid divider: {}. Must be 0 ~ 4095",
-        static_cast<int>(divider));
+    RPL4_LOG(LogLevel::Error,
+             "[AuxSpi::SetClockDivider()] Invalid divider: %d. "
+             "Must be 0 ~ 4095",
+             static_cast<int>(divider));
     return;
   }
-  register_map_->cntl_0.speed = static_cast<uint32_t>(divider);
+  cntl_0_->speed = static_cast<uint32_t>(divider);
+  cntl_0_.Commit();
 }
 
 void AuxSpi::SetCsHighCycles(uint8_t cycles) {
   if (cycles > 7) {
-    Log(LogLevel::Error,
-        "[AuxSpi::SetCsHighCycles()] Invalid cycles: {}. Must be 0 ~ 7",
-        static_cast<int>(cycles));
+    RPL4_LOG(LogLevel::Error,
+             "[AuxSpi::SetCsHighCycles()] Invalid cycles: %d. Must be 0 ~ 7",
+             static_cast<int>(cycles));
     return;
   }
-  register_map_->cntl_1.cs_high_time = static_cast<uint32_t>(cycles);
+  cntl_1_->cs_high_time = static_cast<uint32_t>(cycles);
+  cntl_1_.Commit();
 }
 
 void AuxSpi::SetBitLength(uint8_t bit_length) {
   if (bit_length < 1 || bit_length > 32) {
-    Log(LogLevel::Error,
-        "[AuxSpi::SetBitLength()] Invalid bit length: {}. Must be 1 ~ 32",
-        static_cast<int>(bit_length));
+    RPL4_LOG(LogLevel::Error,
+             "[AuxSpi::SetBitLength()] Invalid bit length: %d. Must be 1 ~ 32",
+             static_cast<int>(bit_length));
     return;
   }
-  register_map_->cntl_0.shift_length = static_cast<uint32_t>(bit_length);
+  if (!IsValidTxShift(bit_length, cntl_0_->invert_spi_clock,
+                      cntl_0_->out_rising, "SetBitLength")) {
+    return;
+  }
+  cntl_0_->shift_length = static_cast<uint32_t>(bit_length);
+  cntl_0_.Commit();
+  ConfigureDataShiftTx();
+  ConfigureDataShiftRx();
+}
+
+void AuxSpi::ApplyDeviceConfig(const DeviceConfig& config) {
+  if (config.clock_divider > 4095 || config.bit_length < 1 ||
+      config.bit_length > 32) {
+    RPL4_LOG(LogLevel::Error,
+             "[AuxSpi::ApplyDeviceConfig()] Invalid divider: %d or "
+             "bit length: %d",
+             static_cast<int>(config.clock_divider),
+             static_cast<int>(config.bit_length));
+    return;
+  }
+  if (!IsValidTxShift(config.bit_length, config.clock_polarity,
+                      config.mosi_clock_phase, "ApplyDeviceConfig")) {
+    return;
+  }
+  cntl_0_->chip_select = config.chip_select;
+  cntl_0_->in_rising = config.miso_clock_phase;
+  cntl_0_->out_rising = config.mosi_clock_phase;
+  cntl_0_->invert_spi_clock = config.clock_polarity;
+  cntl_0_->shift_out_ms_bit_first = config.mosi_bit_order;
+  cntl_0_->speed = static_cast<uint32_t>(config.clock_divider);
+  cntl_0_->shift_length = static_cast<uint32_t>(config.bit_length);
+  cntl_1_->shift_in_ms_bit_first = config.miso_bit_order;
+  cntl_0_.Commit();
+  cntl_1_.Commit();
+  ConfigureDataShiftTx();
+  ConfigureDataShiftRx();
 }
 
 void AuxSpi::TransmitAndReceiveBlocking(const uint8_t* transmit_buf,
                                         uint8_t* receive_buf,
                                         uint32_t data_length) {
-  // Clear the receive FIFO if it has data.
-  while (IsRxFifoReadable()) { ReadDataFromRxFifo(); }
+  TransferWords(transmit_buf, receive_buf, data_length);
+}
+
+void AuxSpi::TransmitAndReceiveBlocking(const uint16_t* transmit_buf,
+                                        uint16_t* receive_buf,
+                                        uint32_t data_length) {
+  TransferWords(transmit_buf, receive_buf, data_length);
+}
+
+void AuxSpi::TransmitAndReceiveBlocking(const uint32_t* transmit_buf,
+                                        uint32_t* receive_buf,
+                                        uint32_t data_length) {
+  TransferWords(transmit_buf, receive_buf, data_length);
+}
+
+void AuxSpi::TransmitBlocking(const uint8_t* transmit_buf,
+                              uint32_t data_length) {
+  PeripheralMetrics::Timer timer(metrics_);
+  metrics_.AddOperation(data_length);
+  DrainRxFifo();
   uint32_t tx_counter = 0;
   uint32_t rx_counter = 0;
   while (rx_counter < data_length) {
-    if (IsTxFifoWritable() && rx_counter == tx_counter) {
+    while (tx_counter < data_length && tx_counter - rx_counter < kFifoDepth) {
+      uint32_t data = static_cast<uint32_t>(transmit_buf[tx_counter])
+                      << data_shift_tx_;
+      if (++tx_counter == data_length) {
+        WriteFinalDataToTxFifo(data);
+      } else {
+        WriteDataToTxFifo(data);
+      }
+    }
+    // The RX FIFO can only be cleared together with the TX FIFO, so the
+    // received words are popped without being stored. The level is read once
+    // instead of polling the empty flag for every word.
+    uint32_t rx_level = register_map_->stat.rx_fifo_level;
+    Trace::CountRead(kTracePeripheral);
+    for (; rx_level > 0; --rx_level, ++rx_counter) { ReadDataFromRxFifo(); }
+  }
+}
+
+void AuxSpi::ReceiveBlocking(uint8_t* receive_buf, uint32_t data_length,
+                             uint8_t fill) {
+  PeripheralMetrics::Timer timer(metrics_);
+  metrics_.AddOperation(data_length);
+  DrainRxFifo();
+  const uint32_t data = static_cast<uint32_t>(fill) << data_shift_tx_;
+  uint32_t tx_counter = 0;
+  uint32_t rx_counter = 0;
+  while (rx_counter < data_length) {
+    while (tx_counter < data_length && tx_counter - rx_counter < kFifoDepth) {
+      if (++tx_counter == data_length) {
+        WriteFinalDataToTxFifo(data);
+      } else {
+        WriteDataToTxFifo(data);
+      }
+    }
+    // Nothing more can be written until a word is received.
+    SpinUntil(kTracePeripheral, [this]() { return IsRxFifoReadable(); });
+    receive_buf[rx_counter++] =
+        static_cast<uint8_t>(ReadDataFromRxFifo() >> data_shift_rx_);
+  }
+}
+
+void AuxSpi::Transfer(const SpiSegment* segments, size_t num_segments) {
+  PeripheralMetrics::Timer timer(metrics_);
+  metrics_.AddOperation(GetTotalLength(segments, num_segments));
+  SegmentCursor tx(segments, num_segments);
+  SegmentCursor rx(segments, num_segments);
+  DrainRxFifo();
+  uint32_t in_flight = 0;
+  while (!rx.AtEnd()) {
+    while (!tx.AtEnd() && in_flight < kFifoDepth) {
+      // Only the last byte of the transaction releases the chip select.
+      uint32_t data = static_cast<uint32_t>(tx.Transmit()) << data_shift_tx_;
+      if (tx.AtLast()) {
+        WriteFinalDataToTxFifo(data);
+      } else {
+        WriteDataToTxFifo(data);
+      }
+      tx.Next();
+      ++in_flight;
+    }
+    // Nothing more can be written until a byte is received.
+    SpinUntil(kTracePeripheral, [this]() { return IsRxFifoReadable(); });
+    rx.Receive(static_cast<uint8_t>(ReadDataFromRxFifo() >> data_shift_rx_));
+    rx.Next();
+    --in_flight;
+  }
+}
+
+template <typename T>
+void AuxSpi::TransferWords(const T* transmit_buf, T* receive_buf,
+                           uint32_t data_length) {
+  PeripheralMetrics::Timer timer(metrics_);
+  metrics_.AddOperation(static_cast<uint64_t>(data_length) * sizeof(T));
+  DrainRxFifo();
+  uint32_t tx_counter = 0;
+  uint32_t rx_counter = 0;
+  while (rx_counter < data_length) {
+    // Every word that has been written but not read yet is either in the TX
+    // FIFO, in the shift register or in the RX FIFO. Keeping that count below
+    // the FIFO depth keeps the TX FIFO filled without overflowing either
+    // FIFO, so the TX status does not need to be polled.
+    while (tx_counter < data_length && tx_counter - rx_counter < kFifoDepth) {
       if (tx_counter == data_length - 1) {
         WriteFinalDataToTxFifo(static_cast<uint32_t>(transmit_buf[tx_counter++])
                                << data_shift_tx_);
-      } else if (tx_counter < data_length - 1) {
+      } else {
         WriteDataToTxFifo(static_cast<uint32_t>(transmit_buf[tx_counter++])
                           << data_shift_tx_);
       }
     }
-    if (IsRxFifoReadable()) {
-      receive_buf[rx_counter++] =
-          static_cast<uint8_t>(ReadDataFromRxFifo() >> data_shift_rx_);
-    }
+    // Nothing more can be written until a word is received.
+    SpinUntil(kTracePeripheral, [this]() { return IsRxFifoReadable(); });
+    receive_buf[rx_counter++] =
+        static_cast<T>(ReadDataFromRxFifo() >> data_shift_rx_);
+  }
+}
+
+void AuxSpi::DrainRxFifo() {
+  // The RX FIFO can only be cleared together with the TX FIFO. No transfer is
+  // running here, so the level is read once and that many words are popped
+  // instead of polling the empty flag after every word.
+  uint32_t rx_level = register_map_->stat.rx_fifo_level;
+  Trace::CountRead(kTracePeripheral);
+  for (; rx_level > 0; --rx_level) { ReadDataFromRxFifo(); }
+}
+
+bool AuxSpi::IsEarlyEdge(ClockPolarity clock_polarity,
+                         MosiClockPhase clock_phase) {
+  return (clock_polarity == ClockPolarity::kHigh &&
+          clock_phase == MosiClockPhase::kFallingEdge) ||
+         (clock_polarity == ClockPolarity::kLow &&
+          clock_phase == MosiClockPhase::kRisingEdge);
+}
+
+bool AuxSpi::IsValidTxShift(uint32_t bit_length, ClockPolarity clock_polarity,
+                            MosiClockPhase clock_phase, const char* method) {
+  if (bit_length < 32 || !IsEarlyEdge(clock_polarity, clock_phase)) {
+    return true;
   }
+  RPL4_LOG(LogLevel::Error,
+           "[AuxSpi::%s()] 32-bit words cannot be shifted out on the early "
+           "edge.",
+           method);
+  return false;
 }
 
 void AuxSpi::ConfigureDataShiftTx() {
-  if (register_map_->cntl_0.shift_out_ms_bit_first == MosiBitOrder::kLsbFirst) {
-    if ((register_map_->cntl_0.invert_spi_clock == ClockPolarity::kHigh &&
-         register_map_->cntl_0.out_rising == MosiClockPhase::kFallingEdge) ||
-        (register_map_->cntl_0.invert_spi_clock == ClockPolarity::kLow &&
-         register_map_->cntl_0.out_rising == MosiClockPhase::kRisingEdge)) {
-      data_shift_tx_ = 1;
-    } else {
-      data_shift_tx_ = 0;
-    }
+  // The settings come from the cached register, so no device read is needed.
+  bool early_edge =
+      IsEarlyEdge(cntl_0_->invert_spi_clock, cntl_0_->out_rising);
+  if (early_edge && cntl_0_->shift_length == 32) {
+    // Only reached if the device was configured so before. The shift would
+    // be -1 or would drop bit 31, so 0 is used.
+    IsValidTxShift(32, cntl_0_->invert_spi_clock, cntl_0_->out_rising,
+                   "ConfigureDataShiftTx");
+    data_shift_tx_ = 0;
+  } else if (cntl_0_->shift_out_ms_bit_first == MosiBitOrder::kLsbFirst) {
+    data_shift_tx_ = early_edge ? 1 : 0;
   } else {
-    if ((register_map_->cntl_0.invert_spi_clock == ClockPolarity::kHigh &&
-         register_map_->cntl_0.out_rising == MosiClockPhase::kFallingEdge) ||
-        (register_map_->cntl_0.invert_spi_clock == ClockPolarity::kLow &&
-         register_map_->cntl_0.out_rising == MosiClockPhase::kRisingEdge)) {
-      data_shift_tx_ = 31 - register_map_->cntl_0.shift_length;
-    } else {
-      data_shift_tx_ = 32 - register_map_->cntl_0.shift_length;
-    }
+    data_shift_tx_ = (early_edge ? 31 : 32) - cntl_0_->shift_length;
   }
 }
 
 void AuxSpi::ConfigureDataShiftRx() {
-  if (register_map_->cntl_1.shift_in_ms_bit_first == MisoBitOrder::kMsbFirst) {
+  if (cntl_1_->shift_in_ms_bit_first == MisoBitOrder::kMsbFirst) {
     data_shift_rx_ = 0;
   } else {
-    data_shift_rx_ = 32 - register_map_->cntl_0.shift_length;
+    data_shift_rx_ = 32 - cntl_0_->shift_length;
   }
 }
 
@@ -4,23 +4,26 @@
 #include <cstring>
 #include <thread>
 
+#include "rpl4/registers/fields_dma.hpp"
 #include "rpl4/system/system.hpp"
 
 namespace rpl {
 
-std::array<std::shared_ptr<Dma>, Dma::kNumOfInstances> Dma::instances_ = {
-    nullptr};
+InstanceRegistry<Dma, Dma::kNumOfInstances> Dma::instances_;
 
-std::shared_ptr<Dma> Dma::GetInstance(Channel channel) {
+Dma* Dma::GetInstance(Channel channel) {
   size_t index = static_cast<size_t>(channel);
   if (index >= kNumOfInstances) {
-    Log(LogLevel::Fatal, "[Dma::GetInstance()] Invalid channel %zu.", index);
+    RPL4_LOG(LogLevel::Fatal, "[Dma::GetInstance()] Invalid channel %zu.",
+             index);
     return nullptr;
   }
 
   if (!IsInitialized()) {
-    Log(LogLevel::Error, "[Dma::GetInstance()] RPL is not initialized.");
-  } else if (instances_[index] == nullptr) {
+    RPL4_LOG(LogLevel::Error, "[Dma::GetInstance()] RPL is not initialized.");
+    return nullptr;
+  }
+  return instances_.GetOrCreate(index, [channel]() {
     DmaRegisterMap* reg_map = nullptr;
     switch (channel) {
       case Channel::kChannel0:
@@ -69,28 +72,35 @@ std::shared_ptr<Dma> Dma::GetInstance(Channel channel) {
         reg_map = REG_DMA14;
         break;
     }
-    instances_[index] = std::shared_ptr<Dma>(new Dma(reg_map, channel));
-  }
-  return instances_[index];
+    return new Dma(reg_map, channel);
+  });
 }
 
 Dma::Dma(DmaRegisterMap* register_map, Channel channel)
-    : register_map_(register_map), channel_(channel) {
+    : register_map_(register_map),
+      channel_(channel),
+      metrics_("dma", static_cast<uint32_t>(channel), true) {
   Reset();
 }
 
 void Dma::Enable() {
   uint32_t channel_bit = 1 << static_cast<uint32_t>(channel_);
   REG_DMA_ENABLE->enable |= channel_bit;
+  Trace::CountRead(kTracePeripheral);
+  Trace::CountWrite(kTracePeripheral);
 }
 
 void Dma::Disable() {
   uint32_t channel_bit = 1 << static_cast<uint32_t>(channel_);
   REG_DMA_ENABLE->enable &= ~channel_bit;
+  Trace::CountRead(kTracePeripheral);
+  Trace::CountWrite(kTracePeripheral);
 }
 
 void Dma::Reset() {
   register_map_->cs.reset = DmaRegisterMap::CS::RESET::kReset;
+  Trace::CountRead(kTracePeripheral);
+  Trace::CountWrite(kTracePeripheral);
   // Wait for reset to complete
   using namespace std::chrono_literals;
   std::this_thread::sleep_for(1ms);
@@ -98,40 +108,60 @@ void Dma::Reset() {
 
 void Dma::Abort() {
   register_map_->cs.abort = DmaRegisterMap::CS::ABORT::kAbort;
+  Trace::CountRead(kTracePeripheral);
+  Trace::CountWrite(kTracePeripheral);
 }
 
 bool Dma::IsActive() {
+  Trace::CountRead(kTracePeripheral);
   return register_map_->cs.active == DmaRegisterMap::CS::ACTIVE::kActive;
 }
 
 bool Dma::IsComplete() {
+  Trace::CountRead(kTracePeripheral);
   return register_map_->cs.end == DmaRegisterMap::CS::END::kSet;
 }
 
 bool Dma::HasError() {
+  Trace::CountRead(kTracePeripheral);
   return register_map_->cs.error == DmaRegisterMap::CS::ERROR::kError;
 }
 
 void Dma::ClearInterrupt() {
   register_map_->cs.interrupt = DmaRegisterMap::CS::INT::kSet;
+  Trace::CountRead(kTracePeripheral);
+  Trace::CountWrite(kTracePeripheral);
 }
 
 void Dma::SetControlBlockAddress(uint32_t control_block_physical_addr) {
   register_map_->conblk_ad.address = control_block_physical_addr;
+  Trace::CountWrite(kTracePeripheral);
+}
+
+uint32_t Dma::GetControlBlockAddress() {
+  Trace::CountRead(kTracePeripheral);
+  return register_map_->conblk_ad.address;
 }
 
 void Dma::Start() {
+  metrics_.AddOperation();
+  start_time_ = std::chrono::steady_clock::now();
   register_map_->cs.active = DmaRegisterMap::CS::ACTIVE::kActive;
+  Trace::CountRead(kTracePeripheral);
+  Trace::CountWrite(kTracePeripheral);
 }
 
 bool Dma::WaitForCompletion(uint32_t timeout_ms) {
   using namespace std::chrono_literals;
   auto start_time = std::chrono::steady_clock::now();
 
+  Trace::SpinTrace spin(kTracePeripheral);
   while (!IsComplete()) {
+    spin.Spin();
     if (HasError()) {
-      Log(LogLevel::Error, "[Dma] Transfer error on channel %d",
-          static_cast<int>(channel_));
+      metrics_.AddError();
+      RPL4_LOG(LogLevel::Error, "[Dma] Transfer error on channel %d",
+               static_cast<int>(channel_));
       return false;
     }
 
@@ -141,8 +171,9 @@ bool Dma::WaitForCompletion(uint32_t timeout_ms) {
                          current_time - start_time)
                          .count();
       if (elapsed >= timeout_ms) {
-        Log(LogLevel::Warning, "[Dma] Transfer timeout on channel %d",
-            static_cast<int>(channel_));
+        metrics_.AddTimeout();
+        RPL4_LOG(LogLevel::Warning, "[Dma] Transfer timeout on channel %d",
+                 static_cast<int>(channel_));
         return false;
       }
     }
@@ -150,6 +181,7 @@ bool Dma::WaitForCompletion(uint32_t timeout_ms) {
     std::this_thread::sleep_for(10us);
   }
 
+  metrics_.RecordLatency(std::chrono::steady_clock::now() - start_time_);
   return true;
 }
 
@@ -159,6 +191,8 @@ void Dma::SetPriority(uint8_t priority) {
   }
   register_map_->cs.priority =
       static_cast<DmaRegisterMap::CS::PRIORITY>(priority);
+  Trace::CountRead(kTracePeripheral);
+  Trace::CountWrite(kTracePeripheral);
 }
 
 void Dma::SetPanicPriority(uint8_t panic_priority) {
@@ -167,12 +201,46 @@ void Dma::SetPanicPriority(uint8_t panic_priority) {
   }
   register_map_->cs.panic_priority =
       static_cast<DmaRegisterMap::CS::PANIC_PRIORITY>(panic_priority);
+  Trace::CountRead(kTracePeripheral);
+  Trace::CountWrite(kTracePeripheral);
+}
+
+// BURST_LENGTH is 4 bits and WAITS is 5 bits.
+static bool IsValidTransferOptions(const Dma::TransferOptions& options,
+                                   const char* method) {
+  if (options.burst_length <= 15 && options.waits <= 31) { return true; }
+  RPL4_LOG(LogLevel::Error,
+           "[Dma::%s()] Invalid burst length: %d or waits: %d. Must be "
+           "0 ~ 15 and 0 ~ 31",
+           method, static_cast<int>(options.burst_length),
+           static_cast<int>(options.waits));
+  return false;
+}
+
+// Fields of the transfer information set by valid options
+static RegValue<DmaRegisterMap::TI> MakeTransferInfo(
+    const Dma::TransferOptions& options) {
+  using TI = DmaRegisterMap::TI;
+  return DmaFields::TI::kWaitResp(options.wait_resp ? TI::WAIT_RESP::kEnable
+                                                    : TI::WAIT_RESP::kDisable) |
+         DmaFields::TI::kDestWidth(options.wide_dest ? TI::DEST_WIDTH::k128Bit
+                                                     : TI::DEST_WIDTH::k32Bit) |
+         DmaFields::TI::kSrcWidth(options.wide_source ? TI::SRC_WIDTH::k128Bit
+                                                      : TI::SRC_WIDTH::k32Bit) |
+         DmaFields::TI::kBurstLength(
+             static_cast<TI::BURST_LENGTH>(options.burst_length)) |
+         DmaFields::TI::kWaits(static_cast<TI::WAITS>(options.waits)) |
+         DmaFields::TI::kNoWideBursts(options.no_wide_bursts
+                                          ? TI::NO_WIDE_BURSTS::kDisable
+                                          : TI::NO_WIDE_BURSTS::kEnable);
 }
 
 void Dma::ConfigureMemoryToMemory(DmaControlBlock* control_block,
                                   uint32_t src_physical,
-                                  uint32_t dest_physical, uint32_t length) {
-  if (control_block == nullptr) {
+                                  uint32_t dest_physical, uint32_t length,
+                                  const TransferOptions& options) {
+  if (control_block == nullptr ||
+      !IsValidTransferOptions(options, "ConfigureMemoryToMemory")) {
     return;
   }
 
@@ -181,13 +249,12 @@ void Dma::ConfigureMemoryToMemory(DmaControlBlock* control_block,
   memset(control_block, 0, sizeof(DmaControlBlock));
   #pragma GCC diagnostic pop
 
-  // Configure transfer info
-  control_block->transfer_info.src_inc = DmaRegisterMap::TI::SRC_INC::kEnable;
-  control_block->transfer_info.dest_inc = DmaRegisterMap::TI::DEST_INC::kEnable;
-  control_block->transfer_info.wait_resp =
-      DmaRegisterMap::TI::WAIT_RESP::kEnable;
-  control_block->transfer_info.no_wide_bursts =
-      DmaRegisterMap::TI::NO_WIDE_BURSTS::kEnable;
+  // Configure transfer info with one store
+  using TI = DmaRegisterMap::TI;
+  WriteRegister(control_block->transfer_info,
+                MakeTransferInfo(options) |
+                    DmaFields::TI::kSrcInc(TI::SRC_INC::kEnable) |
+                    DmaFields::TI::kDestInc(TI::DEST_INC::kEnable));
 
   control_block->source_addr = src_physical;
   control_block->dest_addr = dest_physical;
@@ -199,8 +266,10 @@ void Dma::ConfigureMemoryToMemory(DmaControlBlock* control_block,
 void Dma::ConfigureMemoryToPeripheral(DmaControlBlock* control_block,
                                       uint32_t src_physical,
                                       uint32_t dest_physical, uint32_t length,
-                                      DmaRegisterMap::TI::PERMAP dreq) {
-  if (control_block == nullptr) {
+                                      DmaRegisterMap::TI::PERMAP dreq,
+                                      const TransferOptions& options) {
+  if (control_block == nullptr ||
+      !IsValidTransferOptions(options, "ConfigureMemoryToPeripheral")) {
     return;
   }
 
@@ -209,14 +278,13 @@ void Dma::ConfigureMemoryToPeripheral(DmaControlBlock* control_block,
   memset(control_block, 0, sizeof(DmaControlBlock));
   #pragma GCC diagnostic pop
 
-  // Configure transfer info
-  control_block->transfer_info.src_inc = DmaRegisterMap::TI::SRC_INC::kEnable;
-  control_block->transfer_info.dest_dreq = DmaRegisterMap::TI::DEST_DREQ::kEnable;
-  control_block->transfer_info.wait_resp =
-      DmaRegisterMap::TI::WAIT_RESP::kEnable;
-  control_block->transfer_info.no_wide_bursts =
-      DmaRegisterMap::TI::NO_WIDE_BURSTS::kEnable;
-  control_block->transfer_info.permap = dreq;
+  // Configure transfer info with one store
+  using TI = DmaRegisterMap::TI;
+  WriteRegister(control_block->transfer_info,
+                MakeTransferInfo(options) |
+                    DmaFields::TI::kSrcInc(TI::SRC_INC::kEnable) |
+                    DmaFields::TI::kDestDreq(TI::DEST_DREQ::kEnable) |
+                    DmaFields::TI::kPermap(dreq));
 
   control_block->source_addr = src_physical;
   control_block->dest_addr = dest_physical;
@@ -228,8 +296,10 @@ void Dma::ConfigureMemoryToPeripheral(DmaControlBlock* control_block,
 void Dma::ConfigurePeripheralToMemory(DmaControlBlock* control_block,
                                       uint32_t src_physical,
                                       uint32_t dest_physical, uint32_t length,
-                                      DmaRegisterMap::TI::PERMAP dreq) {
-  if (control_block == nullptr) {
+                                      DmaRegisterMap::TI::PERMAP dreq,
+                                      const TransferOptions& options) {
+  if (control_block == nullptr ||
+      !IsValidTransferOptions(options, "ConfigurePeripheralToMemory")) {
     return;
   }
 
@@ -238,14 +308,13 @@ void Dma::ConfigurePeripheralToMemory(DmaControlBlock* control_block,
   memset(control_block, 0, sizeof(DmaControlBlock));
   #pragma GCC diagnostic pop
 
-  // Configure transfer info
-  control_block->transfer_info.src_dreq = DmaRegisterMap::TI::SRC_DREQ::kEnable;
-  control_block->transfer_info.dest_inc = DmaRegisterMap::TI::DEST_INC::kEnable;
-  control_block->transfer_info.wait_resp =
-      DmaRegisterMap::TI::WAIT_RESP::kEnable;
-  control_block->transfer_info.no_wide_bursts =
-      DmaRegisterMap::TI::NO_WIDE_BURSTS::kEnable;
-  control_block->transfer_info.permap = dreq;
+  // Configure transfer info with one store
+  using TI = DmaRegisterMap::TI;
+  WriteRegister(control_block->transfer_info,
+                MakeTransferInfo(options) |
+                    DmaFields::TI::kSrcDreq(TI::SRC_DREQ::kEnable) |
+                    DmaFields::TI::kDestInc(TI::DEST_INC::kEnable) |
+                    DmaFields::TI::kPermap(dreq));
 
   control_block->source_addr = src_physical;
   control_block->dest_addr = dest_physical;
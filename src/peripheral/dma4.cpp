@@ -0,0 +1,312 @@
+#include "rpl4/peripheral/dma4.hpp"
+
+#include <chrono>
+#include <thread>
+
+#include "rpl4/registers/fields_dma4.hpp"
+#include "rpl4/system/system.hpp"
+
+namespace rpl {
+
+// 128-bit beats need 16-byte aligned addresses and length.
+constexpr uint64_t kWideAlignment = 16;
+constexpr uint32_t kBurstBeats = 8;
+
+InstanceRegistry<Dma4, Dma4::kNumOfInstances> Dma4::instances_;
+
+Dma4* Dma4::GetInstance(Channel channel) {
+  size_t number = static_cast<size_t>(channel);
+  if (number < kFirstChannel || number >= kFirstChannel + kNumOfInstances) {
+    RPL4_LOG(LogLevel::Fatal, "[Dma4::GetInstance()] Invalid channel %zu.",
+             number);
+    return nullptr;
+  }
+
+  if (!IsInitialized()) {
+    RPL4_LOG(LogLevel::Error, "[Dma4::GetInstance()] RPL is not initialized.");
+    return nullptr;
+  }
+  return instances_.GetOrCreate(number - kFirstChannel, [channel]() {
+    Dma4RegisterMap* reg_map = nullptr;
+    switch (channel) {
+      case Channel::kChannel11:
+        reg_map = REG_DMA4_CHANNEL11;
+        break;
+      case Channel::kChannel12:
+        reg_map = REG_DMA4_CHANNEL12;
+        break;
+      case Channel::kChannel13:
+        reg_map = REG_DMA4_CHANNEL13;
+        break;
+      case Channel::kChannel14:
+        reg_map = REG_DMA4_CHANNEL14;
+        break;
+    }
+    return new Dma4(reg_map, channel);
+  });
+}
+
+Dma4::Dma4(Dma4RegisterMap* register_map, Channel channel)
+    : register_map_(register_map),
+      channel_(channel),
+      metrics_("dma4", static_cast<uint32_t>(channel), true) {
+  Reset();
+}
+
+void Dma4::Enable() {
+  uint32_t channel_bit = 1 << static_cast<uint32_t>(channel_);
+  REG_DMA_ENABLE->enable |= channel_bit;
+  Trace::CountRead(kTracePeripheral);
+  Trace::CountWrite(kTracePeripheral);
+}
+
+void Dma4::Disable() {
+  uint32_t channel_bit = 1 << static_cast<uint32_t>(channel_);
+  REG_DMA_ENABLE->enable &= ~channel_bit;
+  Trace::CountRead(kTracePeripheral);
+  Trace::CountWrite(kTracePeripheral);
+}
+
+void Dma4::Reset() {
+  using CS = Dma4RegisterMap::CS;
+  WriteRegister(register_map_->cs, Dma4Fields::CS::kAbort(CS::ABORT::kAbort));
+  Trace::CountWrite(kTracePeripheral);
+  // Wait for the outstanding transactions of the aborted transfer
+  using namespace std::chrono_literals;
+  std::this_thread::sleep_for(1ms);
+  WriteRegister(register_map_->cs,
+                Dma4Fields::CS::kEnd(CS::END::kSet) |
+                    Dma4Fields::CS::kInterrupt(CS::INT::kSet));
+  WriteRegister(register_map_->cb, Dma4Fields::CB::kAddress(0));
+  Trace::CountWrite(kTracePeripheral, 2);
+}
+
+void Dma4::Abort() {
+  register_map_->cs.abort = Dma4RegisterMap::CS::ABORT::kAbort;
+  Trace::CountRead(kTracePeripheral);
+  Trace::CountWrite(kTracePeripheral);
+}
+
+bool Dma4::IsActive() {
+  Trace::CountRead(kTracePeripheral);
+  return register_map_->cs.active == Dma4RegisterMap::CS::ACTIVE::kActive;
+}
+
+bool Dma4::IsComplete() {
+  Trace::CountRead(kTracePeripheral);
+  return register_map_->cs.end == Dma4RegisterMap::CS::END::kSet;
+}
+
+bool Dma4::HasError() {
+  Trace::CountRead(kTracePeripheral);
+  return register_map_->cs.error == Dma4RegisterMap::CS::ERROR::kError;
+}
+
+void Dma4::ClearInterrupt() {
+  register_map_->cs.interrupt = Dma4RegisterMap::CS::INT::kSet;
+  Trace::CountRead(kTracePeripheral);
+  Trace::CountWrite(kTracePeripheral);
+}
+
+void Dma4::SetControlBlockAddress(uint64_t control_block_physical_addr) {
+  WriteRegister(register_map_->cb,
+                Dma4Fields::CB::kAddress(
+                    static_cast<uint32_t>(control_block_physical_addr >> 5)));
+  Trace::CountWrite(kTracePeripheral);
+}
+
+uint64_t Dma4::GetControlBlockAddress() {
+  Trace::CountRead(kTracePeripheral);
+  return static_cast<uint64_t>(ReadRegister(register_map_->cb)) << 5;
+}
+
+void Dma4::Start() {
+  metrics_.AddOperation();
+  start_time_ = std::chrono::steady_clock::now();
+  // One store, without reading CS. END and INT are cleared by writing 1.
+  using CS = Dma4RegisterMap::CS;
+  WriteRegister(
+      register_map_->cs,
+      Dma4Fields::CS::kActive(CS::ACTIVE::kActive) |
+          Dma4Fields::CS::kEnd(CS::END::kSet) |
+          Dma4Fields::CS::kInterrupt(CS::INT::kSet) |
+          Dma4Fields::CS::kQos(qos_) | Dma4Fields::CS::kPanicQos(panic_qos_) |
+          Dma4Fields::CS::kWaitForOutstandingWrites(
+              CS::WAIT_FOR_OUTSTANDING_WRITES::kEnable));
+  Trace::CountWrite(kTracePeripheral);
+}
+
+bool Dma4::WaitForCompletion(uint32_t timeout_ms) {
+  using namespace std::chrono_literals;
+  auto start_time = std::chrono::steady_clock::now();
+
+  Trace::SpinTrace spin(kTracePeripheral);
+  while (!IsComplete()) {
+    spin.Spin();
+    if (HasError()) {
+      metrics_.AddError();
+      RPL4_LOG(LogLevel::Error, "[Dma4] Transfer error on channel %d",
+               static_cast<int>(channel_));
+      return false;
+    }
+
+    if (timeout_ms > 0) {
+      auto current_time = std::chrono::steady_clock::now();
+      auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         current_time - start_time)
+                         .count();
+      if (elapsed >= timeout_ms) {
+        metrics_.AddTimeout();
+        RPL4_LOG(LogLevel::Warning, "[Dma4] Transfer timeout on channel %d",
+                 static_cast<int>(channel_));
+        return false;
+      }
+    }
+
+    std::this_thread::sleep_for(10us);
+  }
+
+  metrics_.RecordLatency(std::chrono::steady_clock::now() - start_time_);
+  return true;
+}
+
+void Dma4::SetQos(uint8_t qos) {
+  if (qos > 15) {
+    RPL4_LOG(LogLevel::Error,
+             "[Dma4::SetQos()] Invalid QoS: %d. Must be 0 ~ 15",
+             static_cast<int>(qos));
+    return;
+  }
+  qos_ = qos;
+  ModifyRegister(register_map_->cs, Dma4Fields::CS::kQos(qos_));
+  Trace::CountRead(kTracePeripheral);
+  Trace::CountWrite(kTracePeripheral);
+}
+
+void Dma4::SetPanicQos(uint8_t panic_qos) {
+  if (panic_qos > 15) {
+    RPL4_LOG(LogLevel::Error,
+             "[Dma4::SetPanicQos()] Invalid panic QoS: %d. Must be 0 ~ 15",
+             static_cast<int>(panic_qos));
+    return;
+  }
+  panic_qos_ = panic_qos;
+  ModifyRegister(register_map_->cs, Dma4Fields::CS::kPanicQos(panic_qos_));
+  Trace::CountRead(kTracePeripheral);
+  Trace::CountWrite(kTracePeripheral);
+}
+
+// Source or destination information of a control block
+static RegValue<Dma4RegisterMap::INFO> MakeInfo(
+    uint64_t address, Dma4RegisterMap::INFO::INC inc,
+    Dma4RegisterMap::INFO::SIZE size, uint32_t burst_beats) {
+  return Dma4Fields::INFO::kAddressHigh(static_cast<uint32_t>(address >> 32) &
+                                        0xff) |
+         Dma4Fields::INFO::kBurstLength(burst_beats - 1) |
+         Dma4Fields::INFO::kInc(inc) | Dma4Fields::INFO::kSize(size);
+}
+
+// LEN is 30 bits, so a longer length would be cut by the hardware.
+static bool IsValidLength(uint32_t length, const char* method) {
+  if (length <= Dma4::kMaxLength) { return true; }
+  RPL4_LOG(LogLevel::Error,
+           "[Dma4::%s()] Invalid length: %u. Must be up to %u", method,
+           length, Dma4::kMaxLength);
+  return false;
+}
+
+// Every word of the control block is written, so it is not cleared first.
+static void WriteControlBlock(Dma4ControlBlock* control_block,
+                              RegValue<Dma4RegisterMap::TI> transfer_info,
+                              uint64_t src,
+                              RegValue<Dma4RegisterMap::INFO> srci,
+                              uint64_t dest,
+                              RegValue<Dma4RegisterMap::INFO> desti,
+                              uint32_t length) {
+  WriteRegister(control_block->transfer_info, transfer_info);
+  control_block->source_addr = static_cast<uint32_t>(src);
+  WriteRegister(control_block->source_info, srci);
+  control_block->dest_addr = static_cast<uint32_t>(dest);
+  WriteRegister(control_block->dest_info, desti);
+  control_block->transfer_length = length;
+  control_block->next_control_block = 0;
+  control_block->reserved = 0;
+}
+
+void Dma4::ConfigureMemoryToMemory(Dma4ControlBlock* control_block,
+                                   uint64_t src_physical,
+                                   uint64_t dest_physical, uint32_t length) {
+  if (control_block == nullptr ||
+      !IsValidLength(length, "ConfigureMemoryToMemory")) {
+    return;
+  }
+
+  using INFO = Dma4RegisterMap::INFO;
+  bool wide = ((src_physical | dest_physical | length) &
+               (kWideAlignment - 1)) == 0;
+  INFO::SIZE size = wide ? INFO::SIZE::k128Bit : INFO::SIZE::k32Bit;
+  // The writes are not waited for one by one. Start() makes END wait for
+  // all of them instead.
+  WriteControlBlock(
+      control_block,
+      Dma4Fields::TI::kWaitResp(Dma4RegisterMap::TI::WAIT_RESP::kDisable),
+      src_physical,
+      MakeInfo(src_physical, INFO::INC::kEnable, size, kBurstBeats),
+      dest_physical,
+      MakeInfo(dest_physical, INFO::INC::kEnable, size, kBurstBeats),
+      length);
+}
+
+void Dma4::ConfigureMemoryToPeripheral(Dma4ControlBlock* control_block,
+                                       uint64_t src_physical,
+                                       uint64_t dest_address, uint32_t length,
+                                       Dma4RegisterMap::TI::PERMAP dreq) {
+  if (control_block == nullptr ||
+      !IsValidLength(length, "ConfigureMemoryToPeripheral")) {
+    return;
+  }
+
+  // One word per DREQ, as a peripheral FIFO takes it.
+  using TI = Dma4RegisterMap::TI;
+  using INFO = Dma4RegisterMap::INFO;
+  WriteControlBlock(
+      control_block,
+      Dma4Fields::TI::kDDreq(TI::D_DREQ::kEnable) |
+          Dma4Fields::TI::kWaitResp(TI::WAIT_RESP::kEnable) |
+          Dma4Fields::TI::kPermap(dreq),
+      src_physical,
+      MakeInfo(src_physical, INFO::INC::kEnable, INFO::SIZE::k32Bit, 1),
+      dest_address,
+      MakeInfo(dest_address, INFO::INC::kDisable, INFO::SIZE::k32Bit, 1),
+      length);
+}
+
+void Dma4::ConfigurePeripheralToMemory(Dma4ControlBlock* control_block,
+                                       uint64_t src_address,
+                                       uint64_t dest_physical, uint32_t length,
+                                       Dma4RegisterMap::TI::PERMAP dreq) {
+  if (control_block == nullptr ||
+      !IsValidLength(length, "ConfigurePeripheralToMemory")) {
+    return;
+  }
+
+  using TI = Dma4RegisterMap::TI;
+  using INFO = Dma4RegisterMap::INFO;
+  WriteControlBlock(
+      control_block,
+      Dma4Fields::TI::kSDreq(TI::S_DREQ::kEnable) |
+          Dma4Fields::TI::kWaitResp(TI::WAIT_RESP::kEnable) |
+          Dma4Fields::TI::kPermap(dreq),
+      src_address,
+      MakeInfo(src_address, INFO::INC::kDisable, INFO::SIZE::k32Bit, 1),
+      dest_physical,
+      MakeInfo(dest_physical, INFO::INC::kEnable, INFO::SIZE::k32Bit, 1),
+      length);
+}
+
+void Dma4::SetNextControlBlock(Dma4ControlBlock* control_block,
+                               uint64_t next_physical) {
+  control_block->next_control_block = static_cast<uint32_t>(next_physical >> 5);
+}
+
+}  // namespace rpl
@@ -0,0 +1,237 @@
+#include "rpl4/peripheral/dma_copy.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+#include "rpl4/system/dma_memory.hpp"
+#include "rpl4/system/system.hpp"
+
+namespace rpl {
+
+// Used when the calibration fails.
+constexpr size_t kDefaultThreshold = 16 * 1024;
+constexpr size_t kMinCalibrationSize = 256;
+constexpr size_t kMaxCalibrationSize = 256 * 1024;
+constexpr int kCalibrationRuns = 3;
+// Parts of a split copy start at multiples of a burst.
+constexpr size_t kSplitAlignment = 32;
+
+std::unique_ptr<DmaCopy> DmaCopy::Create(const Config& config) {
+  if (config.channels.empty() || config.min_split_size < kSplitAlignment) {
+    RPL4_LOG(LogLevel::Error,
+             "[DmaCopy::Create()] No channel or a split size below %zu.",
+             kSplitAlignment);
+    return nullptr;
+  }
+  std::vector<Dma*> dmas;
+  for (Dma::Channel channel : config.channels) {
+    // Lite channels cannot take more than 64 KiB per control block.
+    if (channel > Dma::Channel::kChannel6) {
+      RPL4_LOG(LogLevel::Error,
+               "[DmaCopy::Create()] Channel %zu is not a full channel.",
+               static_cast<size_t>(channel));
+      return nullptr;
+    }
+    Dma* dma = Dma::GetInstance(channel);
+    if (dma == nullptr) { return nullptr; }
+    dmas.push_back(dma);
+  }
+
+  std::unique_ptr<DmaCopy> copy(new DmaCopy(config, std::move(dmas)));
+  if (!copy->AllocateControlBlocks()) {
+    RPL4_LOG(LogLevel::Error,
+             "[DmaCopy::Create()] Cannot allocate the control blocks.");
+    return nullptr;
+  }
+  for (Dma* dma : copy->dmas_) { dma->Enable(); }
+  if (config.threshold == 0) { copy->Calibrate(); }
+  return copy;
+}
+
+DmaCopy::DmaCopy(const Config& config, std::vector<Dma*> dmas)
+    : config_(config),
+      dmas_(std::move(dmas)),
+      threshold_(config.threshold != 0 ? config.threshold
+                                       : kDefaultThreshold) {}
+
+DmaCopy::~DmaCopy() {
+  Wait();
+  if (control_blocks_ != nullptr) {
+    DmaMemory::GetInstance().Free(control_blocks_);
+  }
+}
+
+bool DmaCopy::AllocateControlBlocks() {
+  DmaMemory& memory = DmaMemory::GetInstance();
+  control_blocks_ = static_cast<DmaControlBlock*>(
+      memory.Allocate(dmas_.size() * sizeof(DmaControlBlock)));
+  if (control_blocks_ == nullptr) { return false; }
+  control_blocks_physical_ = memory.GetPhysicalAddress(control_blocks_);
+  return true;
+}
+
+bool DmaCopy::Copy(void* dest, const void* src, size_t length) {
+  bool previous = Start(dest, src, length);
+  return Wait() && previous;
+}
+
+bool DmaCopy::Start(void* dest, const void* src, size_t length) {
+  bool previous = Wait();
+  if (length == 0) { return previous; }
+
+  DmaMemory& memory = DmaMemory::GetInstance();
+  bool dest_in_dma_memory = memory.Contains(dest, length);
+  bool src_in_dma_memory = memory.Contains(src, length);
+  if (!dest_in_dma_memory || !src_in_dma_memory || length < threshold_) {
+    if (dest_in_dma_memory || src_in_dma_memory) {
+      CopyByCpu(dest, src, length);
+    } else {
+      std::memcpy(dest, src, length);
+    }
+    cpu_copies_.Add();
+    return previous;
+  }
+
+  size_t num_channels = std::min(
+      dmas_.size(), std::max<size_t>(1, length / config_.min_split_size));
+  StartDma(memory.GetPhysicalAddress(dest),
+           memory.GetPhysicalAddress(const_cast<void*>(src)), length,
+           num_channels);
+  dma_copies_.Add();
+  return previous;
+}
+
+void DmaCopy::StartDma(uint32_t dest_physical, uint32_t src_physical,
+                       size_t length, size_t num_channels) {
+  // Equal parts, except the last one takes the rest.
+  size_t part = length / num_channels / kSplitAlignment * kSplitAlignment;
+  size_t offset = 0;
+  for (size_t i = 0; i < num_channels; ++i) {
+    size_t part_length = i + 1 < num_channels ? part : length - offset;
+    // 128-bit accesses need both addresses and the length 16-byte aligned.
+    Dma::TransferOptions options = Dma::TransferOptions::Bulk();
+    if (((src_physical | dest_physical | part_length) & 15) != 0) {
+      options.wide_source = false;
+      options.wide_dest = false;
+    }
+    Dma::ConfigureMemoryToMemory(
+        &control_blocks_[i], src_physical + static_cast<uint32_t>(offset),
+        dest_physical + static_cast<uint32_t>(offset),
+        static_cast<uint32_t>(part_length), options);
+    dmas_[i]->SetControlBlockAddress(
+        control_blocks_physical_ +
+        static_cast<uint32_t>(i * sizeof(DmaControlBlock)));
+    dmas_[i]->Start();
+    offset += part_length;
+  }
+  num_in_flight_ = num_channels;
+}
+
+bool DmaCopy::Wait() {
+  bool succeeded = true;
+  for (size_t i = 0; i < num_in_flight_; ++i) {
+    if (!dmas_[i]->WaitForCompletion(config_.timeout_ms)) {
+      dmas_[i]->Abort();
+      succeeded = false;
+    }
+  }
+  num_in_flight_ = 0;
+  return succeeded;
+}
+
+bool DmaCopy::IsBusy() {
+  for (size_t i = 0; i < num_in_flight_; ++i) {
+    if (!dmas_[i]->IsComplete() && !dmas_[i]->HasError()) { return true; }
+  }
+  return false;
+}
+
+size_t DmaCopy::Calibrate() {
+  Wait();
+  DmaMemory& memory = DmaMemory::GetInstance();
+  void* src = memory.Allocate(kMaxCalibrationSize);
+  void* dest = memory.Allocate(kMaxCalibrationSize);
+  if (src == nullptr || dest == nullptr) {
+    RPL4_LOG(LogLevel::Error,
+             "[DmaCopy::Calibrate()] Cannot allocate the buffers.");
+    if (src != nullptr) { memory.Free(src); }
+    if (dest != nullptr) { memory.Free(dest); }
+    return threshold_;
+  }
+  uint32_t src_physical = memory.GetPhysicalAddress(src);
+  uint32_t dest_physical = memory.GetPhysicalAddress(dest);
+
+  // Shortest of a few runs, to leave out preemption. A negative time means
+  // a DMA transfer failed.
+  auto measure = [](auto&& copy) {
+    double shortest = std::numeric_limits<double>::max();
+    for (int run = 0; run < kCalibrationRuns; ++run) {
+      auto start = std::chrono::steady_clock::now();
+      if (!copy()) { return -1.0; }
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      shortest = std::min(shortest, elapsed.count());
+    }
+    return shortest;
+  };
+
+  // If the DMA is not faster within the range, it is still used from the
+  // largest size, where it at least frees the CPU.
+  size_t threshold = kMaxCalibrationSize;
+  for (size_t size = kMinCalibrationSize; size <= kMaxCalibrationSize;
+       size *= 2) {
+    double cpu_time = measure([&]() {
+      CopyByCpu(dest, src, size);
+      return true;
+    });
+    double dma_time = measure([&]() {
+      StartDma(dest_physical, src_physical, size, 1);
+      return Wait();
+    });
+    if (dma_time < 0.0) {
+      RPL4_LOG(LogLevel::Error,
+               "[DmaCopy::Calibrate()] The DMA transfer failed.");
+      threshold = threshold_;
+      break;
+    }
+    if (dma_time < cpu_time) {
+      threshold = size;
+      break;
+    }
+  }
+
+  memory.Free(src);
+  memory.Free(dest);
+  threshold_ = threshold;
+  RPL4_LOG(LogLevel::Info, "[DmaCopy::Calibrate()] Threshold %zu bytes",
+           threshold_);
+  return threshold_;
+}
+
+template <typename Word>
+static size_t CopyWords(void* dest, const void* src, size_t length) {
+  volatile Word* dest_words = static_cast<volatile Word*>(dest);
+  const volatile Word* src_words = static_cast<const volatile Word*>(src);
+  size_t num_words = length / sizeof(Word);
+  for (size_t i = 0; i < num_words; ++i) { dest_words[i] = src_words[i]; }
+  return num_words * sizeof(Word);
+}
+
+void DmaCopy::CopyByCpu(void* dest, const void* src, size_t length) {
+  // The widest access that both buffers are aligned to, then the rest in
+  // bytes.
+  uintptr_t misalignment =
+      reinterpret_cast<uintptr_t>(dest) | reinterpret_cast<uintptr_t>(src);
+  size_t done = 0;
+  if ((misalignment & 7) == 0) {
+    done = CopyWords<uint64_t>(dest, src, length);
+  } else if ((misalignment & 3) == 0) {
+    done = CopyWords<uint32_t>(dest, src, length);
+  }
+  CopyWords<uint8_t>(static_cast<uint8_t*>(dest) + done,
+                     static_cast<const uint8_t*>(src) + done, length - done);
+}
+
+}  // namespace rpl
@@ -0,0 +1,154 @@
+#include "rpl4/peripheral/dma_plan.hpp"
+
+#include "rpl4/system/dma_memory.hpp"
+#include "rpl4/system/system.hpp"
+
+namespace rpl {
+
+std::unique_ptr<DmaPlan> DmaPlan::Create(Dma::Channel channel,
+                                         size_t num_control_blocks) {
+  if (num_control_blocks == 0) {
+    RPL4_LOG(LogLevel::Error, "[DmaPlan::Create()] No control block.");
+    return nullptr;
+  }
+  Dma* dma = Dma::GetInstance(channel);
+  if (dma == nullptr) { return nullptr; }
+
+  std::unique_ptr<DmaPlan> plan(new DmaPlan(dma, num_control_blocks));
+  if (!plan->Allocate()) {
+    RPL4_LOG(LogLevel::Error,
+             "[DmaPlan::Create()] Cannot allocate the control blocks.");
+    return nullptr;
+  }
+  dma->Enable();
+  return plan;
+}
+
+DmaPlan::DmaPlan(Dma* dma, size_t num_control_blocks)
+    : dma_(dma), num_control_blocks_(num_control_blocks) {}
+
+DmaPlan::~DmaPlan() {
+  if (in_flight_) { Wait(); }
+  if (control_blocks_ != nullptr) {
+    DmaMemory::GetInstance().Free(control_blocks_);
+  }
+}
+
+bool DmaPlan::Allocate() {
+  DmaMemory& memory = DmaMemory::GetInstance();
+  control_blocks_ = static_cast<DmaControlBlock*>(
+      memory.Allocate(num_control_blocks_ * sizeof(DmaControlBlock)));
+  if (control_blocks_ == nullptr) { return false; }
+  control_blocks_physical_ = memory.GetPhysicalAddress(control_blocks_);
+  for (size_t i = 0; i < num_control_blocks_; ++i) {
+    Dma::ConfigureMemoryToMemory(&control_blocks_[i], 0, 0, 0);
+    Link(i);
+  }
+  return true;
+}
+
+bool DmaPlan::IsValidIndex(size_t index, const char* method) const {
+  if (index < num_control_blocks_) { return true; }
+  RPL4_LOG(LogLevel::Error,
+           "[DmaPlan::%s()] Invalid control block %zu of %zu.", method,
+           index, num_control_blocks_);
+  return false;
+}
+
+void DmaPlan::Link(size_t index) {
+  control_blocks_[index].next_control_block =
+      index + 1 < num_control_blocks_
+          ? control_blocks_physical_ +
+                static_cast<uint32_t>((index + 1) * sizeof(DmaControlBlock))
+          : 0;
+}
+
+// Resolve a buffer once, while the plan is built or patched.
+static uint32_t ResolveAddress(const void* buffer, uint32_t length) {
+  DmaMemory& memory = DmaMemory::GetInstance();
+  if (!memory.Contains(buffer, length == 0 ? 1 : length)) {
+    RPL4_LOG(LogLevel::Error, "[DmaPlan] The buffer is not in DmaMemory.");
+    return 0;
+  }
+  return memory.GetPhysicalAddress(const_cast<void*>(buffer));
+}
+
+bool DmaPlan::SetMemoryToMemory(size_t index, void* dest, const void* src,
+                                uint32_t length,
+                                const Dma::TransferOptions& options) {
+  if (!IsValidIndex(index, "SetMemoryToMemory")) { return false; }
+  uint32_t dest_physical = ResolveAddress(dest, length);
+  uint32_t src_physical = ResolveAddress(src, length);
+  if (dest_physical == 0 || src_physical == 0) { return false; }
+  Dma::ConfigureMemoryToMemory(&control_blocks_[index], src_physical,
+                               dest_physical, length, options);
+  Link(index);
+  return true;
+}
+
+bool DmaPlan::SetMemoryToPeripheral(size_t index, uint32_t dest_physical,
+                                    const void* src, uint32_t length,
+                                    DmaRegisterMap::TI::PERMAP dreq,
+                                    const Dma::TransferOptions& options) {
+  if (!IsValidIndex(index, "SetMemoryToPeripheral")) { return false; }
+  uint32_t src_physical = ResolveAddress(src, length);
+  if (src_physical == 0) { return false; }
+  Dma::ConfigureMemoryToPeripheral(&control_blocks_[index], src_physical,
+                                   dest_physical, length, dreq, options);
+  Link(index);
+  return true;
+}
+
+bool DmaPlan::SetPeripheralToMemory(size_t index, void* dest,
+                                    uint32_t src_physical, uint32_t length,
+                                    DmaRegisterMap::TI::PERMAP dreq,
+                                    const Dma::TransferOptions& options) {
+  if (!IsValidIndex(index, "SetPeripheralToMemory")) { return false; }
+  uint32_t dest_physical = ResolveAddress(dest, length);
+  if (dest_physical == 0) { return false; }
+  Dma::ConfigurePeripheralToMemory(&control_blocks_[index], src_physical,
+                                   dest_physical, length, dreq, options);
+  Link(index);
+  return true;
+}
+
+bool DmaPlan::SetSource(size_t index, const void* src) {
+  if (!IsValidIndex(index, "SetSource")) { return false; }
+  uint32_t src_physical =
+      ResolveAddress(src, control_blocks_[index].transfer_length);
+  if (src_physical == 0) { return false; }
+  SetSourceAddress(index, src_physical);
+  return true;
+}
+
+bool DmaPlan::SetDestination(size_t index, void* dest) {
+  if (!IsValidIndex(index, "SetDestination")) { return false; }
+  uint32_t dest_physical =
+      ResolveAddress(dest, control_blocks_[index].transfer_length);
+  if (dest_physical == 0) { return false; }
+  SetDestinationAddress(index, dest_physical);
+  return true;
+}
+
+bool DmaPlan::Launch() {
+  bool previous = in_flight_ ? Wait() : true;
+  // CONBLK_AD is 0 after the last control block, so it is written again.
+  // Start() writes back the END flag read as 1, which clears it.
+  dma_->SetControlBlockAddress(control_blocks_physical_);
+  dma_->Start();
+  in_flight_ = true;
+  launches_.Add();
+  return previous;
+}
+
+bool DmaPlan::Wait(uint32_t timeout_ms) {
+  if (!in_flight_) { return true; }
+  in_flight_ = false;
+  if (!dma_->WaitForCompletion(timeout_ms)) {
+    dma_->Abort();
+    return false;
+  }
+  return true;
+}
+
+}  // namespace rpl
@@ -5,28 +5,31 @@
 
 namespace rpl {
 
-std::array<std::shared_ptr<Gpio>, Gpio::kNumOfInstances> Gpio::instances_ = {
-    nullptr};
+InstanceRegistry<Gpio, Gpio::kNumOfInstances> Gpio::instances_;
 
-std::shared_ptr<Gpio> Gpio::GetInstance(uint8_t pin) {
+Gpio* Gpio::GetInstance(uint8_t pin) {
   if (pin >= kNumOfInstances) {
-    Log(LogLevel::Fatal, "[Gpio::GetInstance()] Invalid pin number %d.", pin);
+    RPL4_LOG(LogLevel::Fatal, "[Gpio::GetInstance()] Invalid pin number %d.",
+             pin);
     return nullptr;
   }
 
   if (!IsInitialized()) {
-    Log(LogLevel::Error, "[Gpio::GetInstance()] RPL is not initialized.");
-  } else if (instances_[static_cast<size_t>(pin)] == nullptr) {
-    instances_[static_cast<size_t>(pin)] = std::shared_ptr<Gpio>(new Gpio(pin));
+    RPL4_LOG(LogLevel::Error, "[Gpio::GetInstance()] RPL is not initialized.");
+    return nullptr;
   }
-  return instances_[static_cast<size_t>(pin)];
+  return instances_.GetOrCreate(static_cast<size_t>(pin),
+                                [pin]() { return new Gpio(pin); });
 }
 
-Gpio::Gpio(uint8_t pin) : pin_(pin) {
-  if (pin_ > 57) Log(LogLevel::Fatal, "[Gpio]GPIO %d is not exists.\n", pin);
+Gpio::Gpio(uint8_t pin) : pin_(pin), metrics_("gpio", pin, false) {
+  if (pin_ > 57) {
+    RPL4_LOG(LogLevel::Fatal, "[Gpio]GPIO %d is not exists.\n", pin);
+  }
 }
 
 bool Gpio::Read() {
+  metrics_.AddOperation();
   if (pin_ <= 31) {
     return (REG_GPIO->gplev0 & (0b1 << pin_)) ==
            static_cast<uint32_t>(0b1 << pin_);
@@ -34,12 +37,15 @@ bool Gpio::Read() {
     return (REG_GPIO->gplev1 & (0b1 << (pin_ - 32))) ==
            static_cast<uint32_t>(0b1 << (pin_ - 32));
   } else {
-    Log(LogLevel::Error, "[Gpio::Read()] Invalid pin_ number %d is set.", pin_);
+    RPL4_LOG(LogLevel::Error, "[Gpio::Read()] Invalid pin_ number %d is set.",
+             pin_);
+    metrics_.AddError();
     return false;
   }
 }
 
 bool Gpio::Write(bool output) {
+  metrics_.AddOperation();
   if (output) {
     if (pin_ <= 31)
       REG_GPIO->gpset0 = 0b1 << pin_;
@@ -65,7 +71,8 @@ void Gpio::SetPullRegister(PullRegister pull_register) {
 
 void Gpio::SetAltFunction(uint8_t pin, AltFunction alt_function) {
   if (!IsInitialized()) {
-    Log(LogLevel::Error, "[Gpio::SetAltFunction()] RPL is not initialized.");
+    RPL4_LOG(LogLevel::Error,
+             "[Gpio::SetAltFunction()] RPL is not initialized.");
     return;
   }
   if (pin <= 9) {
@@ -99,13 +106,14 @@ void Gpio::SetAltFunction(uint8_t pin, AltFunction alt_function) {
     val |= static_cast<uint32_t>(alt_function) << (pin - 50) * 3;
     REG_GPIO->gpfsel5 = val;
   } else {
-    Log(LogLevel::Error, "[Gpio]GPIO %d is not exists.\n", pin);
+    RPL4_LOG(LogLevel::Error, "[Gpio]GPIO %d is not exists.\n", pin);
   }
 }
 
 void Gpio::SetPullRegister(uint8_t pin, PullRegister pull_register) {
   if (!IsInitialized()) {
-    Log(LogLevel::Error, "[Gpio::SetPullRegister ()] RPL is not initialized.");
+    RPL4_LOG(LogLevel::Error,
+             "[Gpio::SetPullRegister ()] RPL is not initialized.");
     return;
   }
   if (pin <= 15) {
@@ -129,7 +137,7 @@ void Gpio::SetPullRegister(uint8_t pin, PullRegister pull_register) {
     val |= static_cast<uint8_t>(pull_register) << (pin - 48) * 2;
     REG_GPIO->pup_pdn_cntrl_reg3 = val;
   } else {
-    Log(LogLevel::Error, "[Gpio]GPIO %d is not exists.\n", pin);
+    RPL4_LOG(LogLevel::Error, "[Gpio]GPIO %d is not exists.\n", pin);
   }
 }
 
@@ -0,0 +1,155 @@
+#include "rpl4/peripheral/i2c.hpp"
+
+#include <array>
+#include <memory>
+
+#include "rpl4/system/log.hpp"
+#include "rpl4/system/system.hpp"
+
+namespace rpl {
+
+InstanceRegistry<I2c, I2c::kNumOfInstances> I2c::instances_;
+
+I2c* I2c::GetInstance(Port port) {
+  size_t index = static_cast<size_t>(port);
+  if (index >= kNumOfInstances) {
+    RPL4_LOG(LogLevel::Fatal, "[I2c::GetInstance()] Invalid port %zu.", index);
+    return nullptr;
+  }
+
+  if (!IsInitialized()) {
+    RPL4_LOG(LogLevel::Error, "[I2c::GetInstance()] RPL is not initialized.");
+    return nullptr;
+  }
+  return instances_.GetOrCreate(index, [port]() {
+    BSC_Typedef* reg_map = nullptr;
+    switch (port) {
+      case Port::kI2c0:
+        reg_map = REG_BSC0;
+        break;
+      case Port::kI2c1:
+        reg_map = REG_BSC1;
+        break;
+      case Port::kI2c3:
+        reg_map = REG_BSC3;
+        break;
+      case Port::kI2c4:
+        reg_map = REG_BSC4;
+        break;
+      case Port::kI2c5:
+        reg_map = REG_BSC5;
+        break;
+      case Port::kI2c6:
+        reg_map = REG_BSC6;
+        break;
+    }
+    return new I2c(reg_map, port);
+  });
+}
+
+I2c::I2c(BSC_Typedef* register_map, Port port)
+    : register_map_(register_map), port_(port) {}
+
+void I2c::StartWrite(uint8_t address, const uint8_t* transmit_buf,
+                     uint32_t data_length) {
+  if (data_length == 0 || data_length > 0xffff) {
+    RPL4_LOG(LogLevel::Error,
+             "[I2c::StartWrite()] Invalid data length: %u. Must be 1 ~ 65535",
+             data_length);
+    status_ = Status::kInvalid;
+    return;
+  }
+  transmit_buf_ = transmit_buf;
+  receive_buf_ = nullptr;
+  data_length_ = data_length;
+  data_index_ = 0;
+  status_ = Status::kBusy;
+
+  register_map_->C = BSC_C_I2CEN | BSC_C_CLEAR;
+  register_map_->S = BSC_S_CLKT | BSC_S_ERR | BSC_S_DONE;
+  register_map_->A = address;
+  register_map_->DLEN = data_length;
+  // Pre-fill the FIFO so that the controller starts shifting immediately.
+  FillTxFifo();
+  register_map_->C = BSC_C_I2CEN | BSC_C_ST;
+}
+
+void I2c::StartRead(uint8_t address, uint8_t* receive_buf,
+                    uint32_t data_length) {
+  if (data_length == 0 || data_length > 0xffff) {
+    RPL4_LOG(LogLevel::Error,
+             "[I2c::StartRead()] Invalid data length: %u. Must be 1 ~ 65535",
+             data_length);
+    status_ = Status::kInvalid;
+    return;
+  }
+  transmit_buf_ = nullptr;
+  receive_buf_ = receive_buf;
+  data_length_ = data_length;
+  data_index_ = 0;
+  status_ = Status::kBusy;
+
+  register_map_->C = BSC_C_I2CEN | BSC_C_CLEAR;
+  register_map_->S = BSC_S_CLKT | BSC_S_ERR | BSC_S_DONE;
+  register_map_->A = address;
+  register_map_->DLEN = data_length;
+  register_map_->C = BSC_C_I2CEN | BSC_C_ST | BSC_C_READ;
+}
+
+I2c::Status I2c::Poll() {
+  if (status_ != Status::kBusy) { return status_; }
+
+  uint32_t status = register_map_->S;
+  if (status & BSC_S_ERR) {
+    status_ = Status::kNack;
+  } else if (status & BSC_S_CLKT) {
+    status_ = Status::kClockStretchTimeout;
+  } else {
+    if (transmit_buf_ != nullptr) {
+      FillTxFifo();
+    } else {
+      DrainRxFifo();
+    }
+    // DONE is only checked after the FIFO has been serviced so that the last
+    // bytes of a read are not left behind.
+    if (status & BSC_S_DONE) {
+      if (receive_buf_ != nullptr) { DrainRxFifo(); }
+      status_ = Status::kDone;
+    }
+  }
+
+  if (status_ != Status::kBusy) {
+    register_map_->S = BSC_S_CLKT | BSC_S_ERR | BSC_S_DONE;
+  }
+  return status_;
+}
+
+I2c::Status I2c::WriteBlocking(uint8_t address, const uint8_t* transmit_buf,
+                               uint32_t data_length) {
+  StartWrite(address, transmit_buf, data_length);
+  Status status;
+  while ((status = Poll()) == Status::kBusy) {}
+  return status;
+}
+
+I2c::Status I2c::ReadBlocking(uint8_t address, uint8_t* receive_buf,
+                              uint32_t data_length) {
+  StartRead(address, receive_buf, data_length);
+  Status status;
+  while ((status = Poll()) == Status::kBusy) {}
+  return status;
+}
+
+void I2c::FillTxFifo() {
+  while (data_index_ < data_length_ && (register_map_->S & BSC_S_TXD)) {
+    register_map_->FIFO = transmit_buf_[data_index_++];
+  }
+}
+
+void I2c::DrainRxFifo() {
+  while (data_index_ < data_length_ && (register_map_->S & BSC_S_RXD)) {
+    receive_buf_[data_index_++] = static_cast<uint8_t>(register_map_->FIFO);
+  }
+}
+
+}  // namespace rpl
@@ -0,0 +1,132 @@
+#include "rpl4/peripheral/i2c_scheduler.hpp"
+
+#include "rpl4/system/log.hpp"
+
+namespace rpl {
+
+I2cScheduler::JobId I2cScheduler::AddJob(const Job& job) {
+  size_t port = static_cast<size_t>(job.port);
+  if (port < kNumOfPorts && buses_[port].i2c == nullptr) {
+    buses_[port].i2c = I2c::GetInstance(job.port);
+  }
+  if (port >= kNumOfPorts || buses_[port].i2c == nullptr) {
+    RPL4_LOG(LogLevel::Error,
+             "[I2cScheduler::AddJob()] I2C port %zu is not available.", port);
+  }
+  bool writes = job.type != JobType::kRead;
+  bool reads = job.type != JobType::kWrite;
+  if ((writes && (job.transmit_length == 0 || job.transmit_length > 0xffff)) ||
+      (reads && (job.receive_length == 0 || job.receive_length > 0xffff))) {
+    RPL4_LOG(LogLevel::Error,
+             "[I2cScheduler::AddJob()] Invalid length. Must be 1 ~ 65535.");
+  }
+
+  JobState state;
+  state.job = job;
+  state.next_due = std::chrono::steady_clock::now();
+  jobs_.push_back(state);
+  return jobs_.size() - 1;
+}
+
+bool I2cScheduler::Poll() {
+  QueueDueJobs(std::chrono::steady_clock::now());
+  return Service();
+}
+
+void I2cScheduler::RunCycle() {
+  QueueDueJobs(std::chrono::steady_clock::now());
+  while (Service()) {}
+}
+
+void I2cScheduler::ResetStatistics() {
+  for (auto& state : jobs_) { state.stats = Statistics(); }
+}
+
+void I2cScheduler::QueueDueJobs(std::chrono::steady_clock::time_point now) {
+  for (JobId id = 0; id < jobs_.size(); ++id) {
+    JobState& state = jobs_[id];
+    size_t port = static_cast<size_t>(state.job.port);
+    if (port >= kNumOfPorts || buses_[port].i2c == nullptr ||
+        now < state.next_due) {
+      continue;
+    }
+
+    if (state.pending) {
+      state.stats.overruns++;
+    } else {
+      state.pending = true;
+      state.queued_at = now;
+      buses_[port].queue.push_back(id);
+    }
+
+    state.next_due += state.job.period;
+    // Do not try to catch up on the periods that were missed.
+    if (state.next_due <= now) { state.next_due = now + state.job.period; }
+  }
+}
+
+bool I2cScheduler::Service() {
+  bool pending = false;
+  for (auto& bus : buses_) {
+    if (bus.active) {
+      JobState& state = jobs_[bus.queue.front()];
+      I2c::Status status = bus.i2c->Poll();
+      if (status == I2c::Status::kDone &&
+          state.job.type == JobType::kWriteRead && !state.write_phase_done) {
+        state.write_phase_done = true;
+        bus.i2c->StartRead(state.job.address, state.job.receive_buf,
+                           state.job.receive_length);
+      } else if (status != I2c::Status::kBusy) {
+        FinishJob(bus, state, status);
+      }
+    }
+    // Start the next job right away so that the controller does not idle
+    // while the other buses are serviced.
+    if (!bus.active && !bus.queue.empty()) {
+      StartJob(bus, jobs_[bus.queue.front()]);
+    }
+    pending |= !bus.queue.empty();
+  }
+  return pending;
+}
+
+void I2cScheduler::StartJob(Bus& bus, JobState& state) {
+  bus.active = true;
+  state.write_phase_done = false;
+  if (state.job.type == JobType::kRead) {
+    bus.i2c->StartRead(state.job.address, state.job.receive_buf,
+                       state.job.receive_length);
+  } else {
+    bus.i2c->StartWrite(state.job.address, state.job.transmit_buf,
+                        state.job.transmit_length);
+  }
+}
+
+void I2cScheduler::FinishJob(Bus& bus, JobState& state, I2c::Status status) {
+  Statistics& stats = state.stats;
+  switch (status) {
+    case I2c::Status::kDone: {
+      auto latency = std::chrono::steady_clock::now() - state.queued_at;
+      stats.transfers++;
+      stats.last_latency = latency;
+      stats.total_latency += latency;
+      if (latency < stats.min_latency) { stats.min_latency = latency; }
+      if (latency > stats.max_latency) { stats.max_latency = latency; }
+      break;
+    }
+    case I2c::Status::kNack:
+      stats.nacks++;
+      break;
+    case I2c::Status::kClockStretchTimeout:
+      stats.clock_stretch_timeouts++;
+      break;
+    default:
+      break;
+  }
+
+  state.pending = false;
+  bus.queue.pop_front();
+  bus.active = false;
+}
+
+}  // namespace rpl
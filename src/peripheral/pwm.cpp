@@ -1,24 +1,55 @@
 #include "rpl4/peripheral/pwm.hpp"
 
+#include <algorithm>
+#include <cstddef>
+
 #include "rpl4/peripheral/gpio.hpp"
+#include "rpl4/registers/fields_pwm.hpp"
 #include "rpl4/system/clock.hpp"
 #include "rpl4/system/system.hpp"
 
 namespace rpl {
 
-std::array<std::shared_ptr<Pwm>, Pwm::kNumOfInstances> Pwm::instances_ = {
-    nullptr};
+InstanceRegistry<Pwm, Pwm::kNumOfInstances> Pwm::instances_;
+std::atomic<double> Pwm::clock_frequency_{Pwm::kDefaultClockFrequency};
+
+struct PwmPin {
+  uint8_t pin;
+  Pwm::Port port;
+  Pwm::Channel channel;
+  Gpio::AltFunction alt_function;
+};
 
-std::shared_ptr<Pwm> Pwm::GetInstance(Port port) {
+// PWM functions of the GPIO pins of BCM2711
+constexpr PwmPin kPwmPins[] = {
+    {12, Pwm::Port::kPwm0, Pwm::Channel::kChannel1, Gpio::AltFunction::kAlt0},
+    {13, Pwm::Port::kPwm0, Pwm::Channel::kChannel2, Gpio::AltFunction::kAlt0},
+    {18, Pwm::Port::kPwm0, Pwm::Channel::kChannel1, Gpio::AltFunction::kAlt5},
+    {19, Pwm::Port::kPwm0, Pwm::Channel::kChannel2, Gpio::AltFunction::kAlt5},
+    {40, Pwm::Port::kPwm1, Pwm::Channel::kChannel1, Gpio::AltFunction::kAlt0},
+    {41, Pwm::Port::kPwm1, Pwm::Channel::kChannel2, Gpio::AltFunction::kAlt0},
+    {45, Pwm::Port::kPwm0, Pwm::Channel::kChannel2, Gpio::AltFunction::kAlt0},
+};
+
+static const PwmPin* FindPwmPin(uint8_t pin) {
+  for (const PwmPin& pwm_pin : kPwmPins) {
+    if (pwm_pin.pin == pin) { return &pwm_pin; }
+  }
+  return nullptr;
+}
+
+Pwm* Pwm::GetInstance(Port port) {
   size_t index = static_cast<size_t>(port);
   if (index >= kNumOfInstances) {
-    Log(LogLevel::Fatal, "[Pwm::GetInstance()] Invalid port %zu.", index);
+    RPL4_LOG(LogLevel::Fatal, "[Pwm::GetInstance()] Invalid port %zu.", index);
     return nullptr;
   }
 
   if (!IsInitialized()) {
-    Log(LogLevel::Error, "[Pwm::GetInstance()] RPL is not initialized.");
-  } else if (instances_[index] == nullptr) {
+    RPL4_LOG(LogLevel::Error, "[Pwm::GetInstance()] RPL is not initialized.");
+    return nullptr;
+  }
+  return instances_.GetOrCreate(index, [port]() {
     PwmRegisterMap* reg_map = nullptr;
     switch (port) {
       case Port::kPwm0:
@@ -28,66 +59,115 @@ std::shared_ptr<Pwm> Pwm::GetInstance(Port port) {
         reg_map = REG_PWM1;
         break;
     }
-    instances_[index] = std::shared_ptr<Pwm>(new Pwm(reg_map, port));
-  }
-  return instances_[index];
+    return new Pwm(reg_map, port);
+  });
 }
 
 Pwm::Pwm(PwmRegisterMap* register_map, Port port)
     : register_map_(register_map),
       port_(port),
-      clock_frequency_(kDefaultClockFrequency) {
+      ctl_(&register_map->ctl, kTracePeripheral),
+      dmac_(&register_map->dmac, kTracePeripheral),
+      ranges_{register_map->rng1.range, register_map->rng2.range},
+      metrics_("pwm", static_cast<uint32_t>(port), false) {
+  Trace::CountRead(kTracePeripheral, 2);
+  // The clock is shared, so a running port keeps its frequency.
+  if (IsClockUsedByOtherPort()) { return; }
   // Initialize PWM clock to default frequency
   InitializeClock(kDefaultClockFrequency);
 }
 
 bool Pwm::ConfigureGpioPin(uint8_t pin) {
-  switch (pin) {
-    case 12:
-    case 13:
-    case 40:
-    case 41:
-    case 45:
-      Gpio::SetAltFunction(pin, Gpio::AltFunction::kAlt0);
-      return true;
-    case 18:
-    case 19:
-      Gpio::SetAltFunction(pin, Gpio::AltFunction::kAlt5);
-      return true;
-    default:
-      Log(LogLevel::Error,
-          "[Pwm::ConfigureGpioPin] GPIO %d has no PWM function", pin);
-      return false;
+  const PwmPin* pwm_pin = FindPwmPin(pin);
+  if (pwm_pin == nullptr) {
+    RPL4_LOG(LogLevel::Error,
+             "[Pwm::ConfigureGpioPin] GPIO %d has no PWM function", pin);
+    return false;
   }
+  Gpio::SetAltFunction(pin, pwm_pin->alt_function);
+  return true;
+}
+
+bool Pwm::ConfigureGpioPin(Port port, Channel channel, uint8_t pin) {
+  const PwmPin* pwm_pin = FindPwmPin(pin);
+  if (pwm_pin == nullptr || pwm_pin->port != port ||
+      pwm_pin->channel != channel) {
+    RPL4_LOG(LogLevel::Error,
+             "[Pwm::ConfigureGpioPin] GPIO %d is not PWM%zu channel %d", pin,
+             static_cast<size_t>(port), static_cast<int>(channel));
+    return false;
+  }
+  Gpio::SetAltFunction(pin, pwm_pin->alt_function);
+  return true;
+}
+
+bool Pwm::GetGpioPinChannel(uint8_t pin, Port* port, Channel* channel) {
+  const PwmPin* pwm_pin = FindPwmPin(pin);
+  if (pwm_pin == nullptr) { return false; }
+  *port = pwm_pin->port;
+  *channel = pwm_pin->channel;
+  return true;
 }
 
 void Pwm::InitializeClock(double frequency) {
-  // Set PWM source clock frequency
-  // Using oscillator (54MHz) as source, divided to achieve target frequency
-  double divisor = 54000000.0 / frequency;
-  ClockConfig(REG_CLK->CM_PWMCTL, REG_CLK->CM_PWMDIV, ClockSource::kOsc,
-              divisor, 1);
-  clock_frequency_ = frequency;
+  // The PWM clock is shared by both ports. ClockManager leaves it running
+  // when it already has the settings for the frequency.
+  ClockManager* clock_manager = ClockManager::GetInstance();
+  if (clock_manager == nullptr) { return; }
+  ClockRequest request;
+  request.frequency = frequency;
+  ClockPlan plan =
+      clock_manager->SetFrequency(ClockManager::Clock::kPwm, request);
+  if (!plan.IsValid()) {
+    RPL4_LOG(LogLevel::Error,
+             "[Pwm::InitializeClock()] Cannot generate %f Hz", frequency);
+    return;
+  }
+  // Ranges are calculated from the frequency actually generated.
+  double previous = clock_frequency_.exchange(plan.frequency);
+  if (plan.frequency != previous && IsClockUsedByOtherPort()) {
+    RPL4_LOG(LogLevel::Warning,
+             "[Pwm::InitializeClock()] The running PWM%zu is retimed from %f "
+             "Hz to %f Hz.",
+             static_cast<size_t>(port_) ^ 1, previous, plan.frequency);
+  }
+}
+
+bool Pwm::IsClockUsedByOtherPort() const {
+  Pwm* other = instances_.Get(static_cast<size_t>(port_) ^ 1);
+  return other != nullptr && (other->IsEnabled(Channel::kChannel1) ||
+                              other->IsEnabled(Channel::kChannel2));
 }
 
 void Pwm::Enable(Channel channel) {
   if (channel == Channel::kChannel1) {
-    register_map_->ctl.pwen1 = PwmRegisterMap::CTL::PWEN::kEnable;
+    ctl_->pwen1 = PwmRegisterMap::CTL::PWEN::kEnable;
   } else if (channel == Channel::kChannel2) {
-    register_map_->ctl.pwen2 = PwmRegisterMap::CTL::PWEN::kEnable;
+    ctl_->pwen2 = PwmRegisterMap::CTL::PWEN::kEnable;
   }
+  ctl_.Commit();
 }
 
 void Pwm::Disable(Channel channel) {
   if (channel == Channel::kChannel1) {
-    register_map_->ctl.pwen1 = PwmRegisterMap::CTL::PWEN::kDisable;
+    ctl_->pwen1 = PwmRegisterMap::CTL::PWEN::kDisable;
   } else if (channel == Channel::kChannel2) {
-    register_map_->ctl.pwen2 = PwmRegisterMap::CTL::PWEN::kDisable;
+    ctl_->pwen2 = PwmRegisterMap::CTL::PWEN::kDisable;
   }
+  ctl_.Commit();
+}
+
+bool Pwm::IsEnabled(Channel channel) const {
+  if (channel == Channel::kChannel1) {
+    return ctl_->pwen1 == PwmRegisterMap::CTL::PWEN::kEnable;
+  } else if (channel == Channel::kChannel2) {
+    return ctl_->pwen2 == PwmRegisterMap::CTL::PWEN::kEnable;
+  }
+  return false;
 }
 
 void Pwm::SetFrequency(Channel channel, double frequency) {
-  uint32_t range = static_cast<uint32_t>(clock_frequency_ / frequency);
+  uint32_t range = static_cast<uint32_t>(GetClockFrequency() / frequency);
   SetRange(channel, range);
 }
 
@@ -100,32 +180,65 @@ void Pwm::SetDutyCycle(Channel channel, double duty) {
   SetData(channel, data);
 }
 
+void Pwm::SetDutyCycleQ16(Channel channel, uint32_t duty) {
+  if (duty > 65536) duty = 65536;
+
+  uint64_t range = GetRange(channel);
+  SetData(channel, static_cast<uint32_t>((range * duty) >> 16));
+}
+
+void Pwm::SetFrequencyAndDuty(Channel channel, double frequency,
+                              double duty) {
+  if (duty < 0.0) duty = 0.0;
+  if (duty > 1.0) duty = 1.0;
+
+  uint32_t range = static_cast<uint32_t>(GetClockFrequency() / frequency);
+  uint32_t data = static_cast<uint32_t>(range * duty);
+  SetRangeAndData(channel, range, data);
+}
+
 void Pwm::SetRange(Channel channel, uint32_t range) {
+  using RNG = PwmRegisterMap::RNG;
   if (channel == Channel::kChannel1) {
-    register_map_->rng1.range = range;
+    ranges_[0] = range;
+    WriteRegister(register_map_->rng1, RegValue<RNG>(range, 0xffffffff));
   } else if (channel == Channel::kChannel2) {
-    register_map_->rng2.range = range;
+    ranges_[1] = range;
+    WriteRegister(register_map_->rng2, RegValue<RNG>(range, 0xffffffff));
+  } else {
+    return;
   }
+  Trace::CountWrite(kTracePeripheral);
 }
 
 void Pwm::SetData(Channel channel, uint32_t data) {
+  using DAT = PwmRegisterMap::DAT;
   if (channel == Channel::kChannel1) {
-    register_map_->dat1.data = data;
+    WriteRegister(register_map_->dat1, RegValue<DAT>(data, 0xffffffff));
   } else if (channel == Channel::kChannel2) {
-    register_map_->dat2.data = data;
+    WriteRegister(register_map_->dat2, RegValue<DAT>(data, 0xffffffff));
+  } else {
+    return;
   }
+  Trace::CountWrite(kTracePeripheral);
 }
 
-uint32_t Pwm::GetRange(Channel channel) {
+void Pwm::SetRangeAndData(Channel channel, uint32_t range, uint32_t data) {
+  SetRange(channel, range);
+  SetData(channel, data);
+}
+
+uint32_t Pwm::GetRange(Channel channel) const {
   if (channel == Channel::kChannel1) {
-    return register_map_->rng1.range;
+    return ranges_[0];
   } else if (channel == Channel::kChannel2) {
-    return register_map_->rng2.range;
+    return ranges_[1];
   }
   return 0;
 }
 
 uint32_t Pwm::GetData(Channel channel) {
+  Trace::CountRead(kTracePeripheral);
   if (channel == Channel::kChannel1) {
     return register_map_->dat1.data;
   } else if (channel == Channel::kChannel2) {
@@ -136,18 +249,20 @@ uint32_t Pwm::GetData(Channel channel) {
 
 void Pwm::SetMode(Channel channel, PwmRegisterMap::CTL::MODE mode) {
   if (channel == Channel::kChannel1) {
-    register_map_->ctl.mode1 = mode;
+    ctl_->mode1 = mode;
   } else if (channel == Channel::kChannel2) {
-    register_map_->ctl.mode2 = mode;
+    ctl_->mode2 = mode;
   }
+  ctl_.Commit();
 }
 
 void Pwm::SetPolarity(Channel channel, PwmRegisterMap::CTL::POLA polarity) {
   if (channel == Channel::kChannel1) {
-    register_map_->ctl.pola1 = polarity;
+    ctl_->pola1 = polarity;
   } else if (channel == Channel::kChannel2) {
-    register_map_->ctl.pola2 = polarity;
+    ctl_->pola2 = polarity;
   }
+  ctl_.Commit();
 }
 
 void Pwm::SetMSMode(Channel channel, bool enable) {
@@ -155,39 +270,83 @@ void Pwm::SetMSMode(Channel channel, bool enable) {
                                        ? PwmRegisterMap::CTL::MSEN::kMSRatio
                                        : PwmRegisterMap::CTL::MSEN::kPwmAlgorithm;
   if (channel == Channel::kChannel1) {
-    register_map_->ctl.msen1 = msen;
+    ctl_->msen1 = msen;
   } else if (channel == Channel::kChannel2) {
-    register_map_->ctl.msen2 = msen;
+    ctl_->msen2 = msen;
   }
+  ctl_.Commit();
 }
 
 void Pwm::EnableFifo(Channel channel) {
   if (channel == Channel::kChannel1) {
-    register_map_->ctl.usef1 = PwmRegisterMap::CTL::USEF::kFifo;
+    ctl_->usef1 = PwmRegisterMap::CTL::USEF::kFifo;
   } else if (channel == Channel::kChannel2) {
-    register_map_->ctl.usef2 = PwmRegisterMap::CTL::USEF::kFifo;
+    ctl_->usef2 = PwmRegisterMap::CTL::USEF::kFifo;
   }
+  ctl_.Commit();
 }
 
 void Pwm::DisableFifo(Channel channel) {
   if (channel == Channel::kChannel1) {
-    register_map_->ctl.usef1 = PwmRegisterMap::CTL::USEF::kData;
+    ctl_->usef1 = PwmRegisterMap::CTL::USEF::kData;
   } else if (channel == Channel::kChannel2) {
-    register_map_->ctl.usef2 = PwmRegisterMap::CTL::USEF::kData;
+    ctl_->usef2 = PwmRegisterMap::CTL::USEF::kData;
   }
+  ctl_.Commit();
 }
 
 void Pwm::ClearFifo() {
-  register_map_->ctl.clrf1 = PwmRegisterMap::CTL::CLRF::kClear;
+  fifo_streaming_ = false;
+  // CLRF1 clears the FIFO of this port and reads as 0, so it is written on top
+  // of the cached CTL instead of being kept in it.
+  using CTL = PwmRegisterMap::CTL;
+  WriteRegister(register_map_->ctl,
+                RegValue<CTL>(ctl_.GetValue(), 0xffffffff) |
+                    PwmFields::CTL::kClrf1(CTL::CLRF::kClear));
+  Trace::CountWrite(kTracePeripheral);
+}
+
+void Pwm::WriteFifo(uint32_t data) {
+  register_map_->fif1.data = data;
+  Trace::CountWrite(kTracePeripheral);
+  metrics_.AddOperation(sizeof(data));
 }
 
-void Pwm::WriteFifo(uint32_t data) { register_map_->fif1.data = data; }
+size_t Pwm::WriteFifo(const uint32_t* data, size_t count) {
+  using STA = PwmFields::STA;
+  using FIF = PwmRegisterMap::FIF;
+  size_t written = 0;
+  while (written < count) {
+    uint32_t status = ReadRegister(register_map_->sta);
+    Trace::CountRead(kTracePeripheral);
+    CountFifoFlags(status);
+    bool empty = (status & STA::kEmpt1.kMask) != 0;
+    if (written == 0 && empty && fifo_streaming_) { fifo_empty_.Add(); }
+    if ((status & STA::kFull1.kMask) != 0) { break; }
+
+    // Without a fill level, only an empty FIFO is known to take a burst.
+    size_t burst = empty ? std::min(kFifoDepth, count - written) : 1;
+    for (size_t i = 0; i < burst; ++i) {
+      WriteRegister(register_map_->fif1,
+                    RegValue<FIF>(data[written + i], 0xffffffff));
+    }
+    Trace::CountWrite(kTracePeripheral, static_cast<uint32_t>(burst));
+    written += burst;
+  }
+  if (written > 0) {
+    fifo_streaming_ = true;
+    metrics_.AddOperation(written * sizeof(uint32_t));
+  }
+  return written;
+}
 
 bool Pwm::IsFifoFull() {
+  Trace::CountRead(kTracePeripheral);
   return register_map_->sta.full1 == PwmRegisterMap::STA::FULL::kFull;
 }
 
 bool Pwm::IsFifoEmpty() {
+  Trace::CountRead(kTracePeripheral);
   return register_map_->sta.empt1 == PwmRegisterMap::STA::EMPT::kEmpty;
 }
 
@@ -195,27 +354,48 @@ void Pwm::EnableDma(uint8_t dreq_threshold, uint8_t panic_threshold) {
   if (dreq_threshold > 15) dreq_threshold = 15;
   if (panic_threshold > 15) panic_threshold = 15;
 
-  register_map_->dmac.dreq =
-      static_cast<PwmRegisterMap::DMAC::DREQ>(dreq_threshold);
-  register_map_->dmac.panic =
-      static_cast<PwmRegisterMap::DMAC::PANIC>(panic_threshold);
-  register_map_->dmac.enab = PwmRegisterMap::DMAC::ENAB::kEnable;
+  dmac_->dreq = static_cast<PwmRegisterMap::DMAC::DREQ>(dreq_threshold);
+  dmac_->panic = static_cast<PwmRegisterMap::DMAC::PANIC>(panic_threshold);
+  dmac_->enab = PwmRegisterMap::DMAC::ENAB::kEnable;
+  dmac_.Commit();
 }
 
 void Pwm::DisableDma() {
-  register_map_->dmac.enab = PwmRegisterMap::DMAC::ENAB::kDisable;
+  dmac_->enab = PwmRegisterMap::DMAC::ENAB::kDisable;
+  dmac_.Commit();
+}
+
+bool Pwm::CheckFifoStatus() {
+  uint32_t status = ReadRegister(register_map_->sta);
+  Trace::CountRead(kTracePeripheral);
+  return CountFifoFlags(status);
+}
+
+bool Pwm::CountFifoFlags(uint32_t status) {
+  using STA = PwmFields::STA;
+  constexpr uint32_t kUnderflowMask = STA::kGapo1.kMask | STA::kGapo2.kMask;
+  constexpr uint32_t kErrorMask =
+      STA::kWerr1.kMask | STA::kRerr1.kMask | STA::kBerr.kMask;
+
+  uint32_t flags = status & (kUnderflowMask | kErrorMask);
+  if (flags == 0) { return true; }
+
+  uint32_t underflows = static_cast<uint32_t>(
+      __builtin_popcount(status & kUnderflowMask));
+  if (underflows > 0) { metrics_.AddUnderflow(underflows); }
+  if ((status & kErrorMask) != 0) { metrics_.AddError(); }
+  // The flags are cleared by writing 1, and the other bits are read-only.
+  WriteRegister(register_map_->sta,
+                RegValue<PwmRegisterMap::STA>(flags, flags));
+  Trace::CountWrite(kTracePeripheral);
+  return false;
 }
 
 uint32_t Pwm::GetFifoPhysicalAddress() const {
-  // Calculate physical address of FIF1 register
-  uint32_t base_physical;
-  if (port_ == Port::kPwm0) {
-    base_physical = kPwm0AddressBase - 0x80000000;
-  } else {
-    base_physical = kPwm1AddressBase- 0x80000000;
-  }
-  // FIF1 is at offset 0x18
-  return base_physical + 0x18;
+  uint32_t base =
+      port_ == Port::kPwm0 ? kPwm0AddressBase : kPwm1AddressBase;
+  return base - kPeripheralBusOffset +
+         static_cast<uint32_t>(offsetof(PwmRegisterMap, fif1));
 }
 
 }  // namespace rpl
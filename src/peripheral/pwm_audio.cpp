@@ -0,0 +1,309 @@
+#include "rpl4/peripheral/pwm_audio.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include "rpl4/system/dma_memory.hpp"
+#include "rpl4/system/system.hpp"
+
+namespace rpl {
+
+constexpr uint32_t kMinRange = 16;
+// (32767 + 32768) * range must fit in int32_t.
+constexpr uint32_t kMaxRange = 4096;
+
+PwmAudioConverter::PwmAudioConverter(uint32_t range, Shaping shaping,
+                                     double input_rate, double output_rate)
+    : range_(std::min(std::max(range, kMinRange), kMaxRange)),
+      shaping_(shaping),
+      step_(static_cast<uint32_t>(
+          std::lround(input_rate / output_rate * 65536.0))),
+      dither_mask_(shaping == Shaping::kRound ? 0 : 0xffffffff),
+      feedback_(shaping == Shaping::kNoiseShaping ? 1 : 0) {}
+
+inline uint32_t PwmAudioConverter::Quantize(size_t channel, int32_t sample) {
+  int32_t* error = error_[channel];
+  // Wanted output in 1/65536 step, with the shaped error subtracted
+  int32_t wanted = (sample + 32768) * static_cast<int32_t>(range_) -
+                   feedback_ * (2 * error[0] - error[1]);
+  // Triangular noise of -1 ~ +1 step from the two halves of an LCG output
+  random_ = random_ * 1664525u + 1013904223u;
+  int32_t dither = (static_cast<int32_t>(random_ & 0xffff) -
+                    static_cast<int32_t>(random_ >> 16)) &
+                   static_cast<int32_t>(dither_mask_);
+  int32_t quantized = (wanted + dither + 32768) >> 16;
+  quantized = std::min(std::max(quantized, 0), static_cast<int32_t>(range_));
+  // Bounded so that clipping cannot make the feedback unstable.
+  int32_t new_error = std::min(std::max(quantized * 65536 - wanted, -131072),
+                               131072);
+  error[1] = error[0];
+  error[0] = new_error;
+  return static_cast<uint32_t>(quantized);
+}
+
+static inline int32_t ToSample(int16_t sample) { return sample; }
+
+static inline int32_t ToSample(float sample) {
+  sample = std::min(std::max(sample, -1.0f), 1.0f);
+  return static_cast<int32_t>(sample * 32767.0f);
+}
+
+template <typename Sample>
+size_t PwmAudioConverter::ConvertFrames(const Sample* input,
+                                        size_t num_input_frames,
+                                        uint32_t* output,
+                                        size_t num_output_frames,
+                                        size_t* consumed) {
+  size_t used = 0;
+  size_t produced = 0;
+  while (produced < num_output_frames) {
+    while (phase_ >= 65536) {
+      if (used == num_input_frames) {
+        *consumed = used;
+        return produced;
+      }
+      for (size_t channel = 0; channel < 2; ++channel) {
+        previous_[channel] = next_[channel];
+        next_[channel] = ToSample(input[used * 2 + channel]);
+      }
+      ++used;
+      phase_ -= 65536;
+    }
+    for (size_t channel = 0; channel < 2; ++channel) {
+      int64_t delta = next_[channel] - previous_[channel];
+      int32_t sample =
+          previous_[channel] + static_cast<int32_t>((delta * phase_) >> 16);
+      output[produced * 2 + channel] = Quantize(channel, sample);
+    }
+    phase_ += step_;
+    ++produced;
+  }
+  *consumed = used;
+  return produced;
+}
+
+size_t PwmAudioConverter::Convert(const int16_t* input,
+                                  size_t num_input_frames, uint32_t* output,
+                                  size_t num_output_frames, size_t* consumed) {
+  return ConvertFrames(input, num_input_frames, output, num_output_frames,
+                       consumed);
+}
+
+size_t PwmAudioConverter::Convert(const float* input, size_t num_input_frames,
+                                  uint32_t* output, size_t num_output_frames,
+                                  size_t* consumed) {
+  return ConvertFrames(input, num_input_frames, output, num_output_frames,
+                       consumed);
+}
+
+std::unique_ptr<PwmAudio> PwmAudio::Create(const Config& config) {
+  if (config.range < kMinRange || config.range > kMaxRange ||
+      config.sample_rate <= 0.0 || config.period_frames == 0 ||
+      config.num_periods < 2) {
+    RPL4_LOG(LogLevel::Error,
+             "[PwmAudio::Create()] Invalid range %u, sample rate %f or "
+             "periods %zu x %zu",
+             config.range, config.sample_rate, config.num_periods,
+             config.period_frames);
+    return nullptr;
+  }
+  Pwm* pwm = Pwm::GetInstance(config.port);
+  Dma* dma = Dma::GetInstance(config.dma_channel);
+  if (pwm == nullptr || dma == nullptr) { return nullptr; }
+  if (!Pwm::ConfigureGpioPin(config.port, Pwm::Channel::kChannel1,
+                             config.left_pin) ||
+      !Pwm::ConfigureGpioPin(config.port, Pwm::Channel::kChannel2,
+                             config.right_pin)) {
+    return nullptr;
+  }
+
+  // The clock is shared with the other port. While that is running, e.g. for
+  // Ws2812, the range is fitted to its clock instead of retiming it.
+  Config actual = config;
+  if (pwm->IsClockUsedByOtherPort()) {
+    actual.range = static_cast<uint32_t>(
+        std::lround(pwm->GetClockFrequency() / config.sample_rate));
+    if (actual.range < kMinRange || actual.range > kMaxRange) {
+      RPL4_LOG(LogLevel::Error,
+               "[PwmAudio::Create()] The PWM clock in use at %f Hz gives "
+               "range %u.",
+               pwm->GetClockFrequency(), actual.range);
+      return nullptr;
+    }
+  } else {
+    pwm->InitializeClock(config.sample_rate * config.range);
+  }
+
+  // Samples are resampled to the rate the clock actually generates.
+  double output_rate = pwm->GetClockFrequency() / actual.range;
+  if (std::fabs(output_rate - config.sample_rate) > config.sample_rate * 0.01) {
+    RPL4_LOG(LogLevel::Warning,
+             "[PwmAudio::Create()] Playing at %f Hz instead of %f Hz",
+             output_rate, config.sample_rate);
+  }
+
+  std::unique_ptr<PwmAudio> audio(
+      new PwmAudio(actual, pwm, dma, output_rate));
+  if (!audio->AllocateRing()) {
+    RPL4_LOG(LogLevel::Error,
+             "[PwmAudio::Create()] Cannot allocate the DMA ring.");
+    return nullptr;
+  }
+  audio->SetUpPwm();
+  return audio;
+}
+
+PwmAudio::PwmAudio(const Config& config, Pwm* pwm, Dma* dma,
+                   double output_rate)
+    : config_(config),
+      pwm_(pwm),
+      dma_(dma),
+      output_rate_(output_rate),
+      converter_(config.range, config.shaping, config.sample_rate,
+                 output_rate) {}
+
+PwmAudio::~PwmAudio() {
+  if (control_blocks_ != nullptr) {
+    dma_->Abort();
+    pwm_->Disable(Pwm::Channel::kChannel1);
+    pwm_->Disable(Pwm::Channel::kChannel2);
+    pwm_->DisableDma();
+  }
+  DmaMemory& memory = DmaMemory::GetInstance();
+  if (words_ != nullptr) { memory.Free(words_); }
+  if (control_blocks_ != nullptr) { memory.Free(control_blocks_); }
+}
+
+bool PwmAudio::AllocateRing() {
+  DmaMemory& memory = DmaMemory::GetInstance();
+  size_t period_bytes = config_.period_frames * 2 * sizeof(uint32_t);
+  words_ = static_cast<uint32_t*>(
+      memory.Allocate(period_bytes * config_.num_periods));
+  control_blocks_ = static_cast<DmaControlBlock*>(
+      memory.Allocate(config_.num_periods * sizeof(DmaControlBlock)));
+  if (words_ == nullptr || control_blocks_ == nullptr) { return false; }
+
+  uint32_t words_physical = memory.GetPhysicalAddress(words_);
+  control_blocks_physical_ = memory.GetPhysicalAddress(control_blocks_);
+  uint32_t fifo_physical = pwm_->GetFifoPhysicalAddress();
+  DmaRegisterMap::TI::PERMAP dreq = pwm_->GetDreq();
+
+  // One control block per period, the last one linked to the first.
+  for (size_t slot = 0; slot < config_.num_periods; ++slot) {
+    FillSilence(slot);
+    size_t next = (slot + 1) % config_.num_periods;
+    Dma::ConfigureMemoryToPeripheral(
+        &control_blocks_[slot],
+        words_physical + static_cast<uint32_t>(slot * period_bytes),
+        fifo_physical, static_cast<uint32_t>(period_bytes), dreq);
+    control_blocks_[slot].next_control_block =
+        control_blocks_physical_ +
+        static_cast<uint32_t>(next * sizeof(DmaControlBlock));
+  }
+  return true;
+}
+
+void PwmAudio::SetUpPwm() {
+  // With both channels reading the FIFO, its words alternate between them.
+  for (Pwm::Channel channel :
+       {Pwm::Channel::kChannel1, Pwm::Channel::kChannel2}) {
+    pwm_->Disable(channel);
+    pwm_->SetMode(channel, PwmRegisterMap::CTL::MODE::kPwmMode);
+    // The PWM algorithm spreads the pulses, so the carrier is far above the
+    // audible band.
+    pwm_->SetMSMode(channel, false);
+    pwm_->SetRange(channel, config_.range);
+    pwm_->EnableFifo(channel);
+  }
+  pwm_->ClearFifo();
+  pwm_->EnableDma();
+  pwm_->Enable(Pwm::Channel::kChannel1);
+  pwm_->Enable(Pwm::Channel::kChannel2);
+
+  dma_->Enable();
+  dma_->SetControlBlockAddress(control_blocks_physical_);
+  dma_->Start();
+}
+
+void PwmAudio::Write(const int16_t* frames, size_t num_frames) {
+  WriteFrames(frames, num_frames);
+}
+
+void PwmAudio::Write(const float* frames, size_t num_frames) {
+  WriteFrames(frames, num_frames);
+}
+
+template <typename Sample>
+void PwmAudio::WriteFrames(const Sample* frames, size_t num_frames) {
+  streaming_ = true;
+  size_t done = 0;
+  while (done < num_frames) {
+    Update();
+    // The period being played and the ones before it in the ring are busy.
+    if (written_ >= played_ + config_.num_periods) {
+      Sleep();
+      continue;
+    }
+    size_t slot = static_cast<size_t>(written_ % config_.num_periods);
+    size_t consumed = 0;
+    write_offset_ += converter_.Convert(
+        frames + done * 2, num_frames - done,
+        GetPeriod(slot) + write_offset_ * 2,
+        config_.period_frames - write_offset_, &consumed);
+    done += consumed;
+    if (write_offset_ == config_.period_frames) {
+      ++written_;
+      write_offset_ = 0;
+    }
+  }
+}
+
+void PwmAudio::Drain() {
+  // The rest of a partly written period is still silence.
+  if (write_offset_ > 0) {
+    ++written_;
+    write_offset_ = 0;
+  }
+  // Not streaming any more, so playing past the last period is no underrun.
+  streaming_ = false;
+  for (Update(); played_ < written_; Update()) { Sleep(); }
+}
+
+void PwmAudio::Update() {
+  uint32_t address = dma_->GetControlBlockAddress();
+  size_t slot = (address - control_blocks_physical_) / sizeof(DmaControlBlock);
+  if (address < control_blocks_physical_ || slot >= config_.num_periods) {
+    return;
+  }
+
+  size_t num_periods = config_.num_periods;
+  size_t played_slot = static_cast<size_t>(played_ % num_periods);
+  size_t advanced = (slot + num_periods - played_slot) % num_periods;
+  // The finished periods are silenced before they come round again. The
+  // writer is at most one ring ahead, so it has not written them yet.
+  for (size_t i = 0; i < advanced; ++i) {
+    FillSilence((played_slot + i) % num_periods);
+  }
+  played_ += advanced;
+
+  if (written_ <= played_) {
+    // The period being written has started playing: skip past it.
+    if (streaming_) { underruns_.Add(); }
+    written_ = played_ + 1;
+    write_offset_ = 0;
+  }
+}
+
+void PwmAudio::FillSilence(size_t slot) {
+  DmaMemory::FillWords(GetPeriod(slot), config_.period_frames * 2,
+                       converter_.GetRange() / 2);
+}
+
+void PwmAudio::Sleep() {
+  std::this_thread::sleep_for(std::chrono::duration<double>(
+      config_.period_frames / output_rate_ / 2));
+}
+
+}  // namespace rpl
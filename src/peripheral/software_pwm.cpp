@@ -0,0 +1,236 @@
+#include "rpl4/peripheral/software_pwm.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include "rpl4/peripheral/gpio.hpp"
+#include "rpl4/registers/registers_gpio.hpp"
+#include "rpl4/system/dma_memory.hpp"
+#include "rpl4/system/system.hpp"
+
+namespace rpl {
+
+// The pacing range is step * clock, so 1 us is 10 counts.
+constexpr double kPacingClockFrequency = 10000000.0;
+constexpr double kMinStepTime = 1.0;
+constexpr double kMaxStepTime = 10.0;
+// 20 ms at 1 us, which is about 2 MB of control blocks.
+constexpr uint32_t kMaxNumOfSteps = 20000;
+
+std::unique_ptr<SoftwarePwm> SoftwarePwm::Create(const Config& config) {
+  if (config.step_us < kMinStepTime || config.step_us > kMaxStepTime ||
+      config.period_us < config.step_us * 2) {
+    RPL4_LOG(LogLevel::Error,
+             "[SoftwarePwm::Create()] Invalid step %f us or period %f us",
+             config.step_us, config.period_us);
+    return nullptr;
+  }
+  Pwm* pwm = Pwm::GetInstance(config.pacing_port);
+  Dma* dma = Dma::GetInstance(config.dma_channel);
+  if (pwm == nullptr || dma == nullptr) { return nullptr; }
+
+  // The clock is shared with the other port, which keeps it while running.
+  if (!pwm->IsClockUsedByOtherPort()) {
+    pwm->InitializeClock(kPacingClockFrequency);
+  }
+  double clock_frequency = pwm->GetClockFrequency();
+  uint32_t range = static_cast<uint32_t>(
+      std::lround(clock_frequency * config.step_us * 1e-6));
+  if (range < 2) {
+    RPL4_LOG(LogLevel::Error,
+             "[SoftwarePwm::Create()] The PWM clock of %f Hz is too slow for "
+             "%f us steps.",
+             clock_frequency, config.step_us);
+    return nullptr;
+  }
+  double step_us = range / clock_frequency * 1e6;
+  long num_steps = std::lround(config.period_us / step_us);
+  if (num_steps > kMaxNumOfSteps) {
+    RPL4_LOG(LogLevel::Error,
+             "[SoftwarePwm::Create()] %ld steps exceed the limit of %u.",
+             num_steps, kMaxNumOfSteps);
+    return nullptr;
+  }
+
+  std::unique_ptr<SoftwarePwm> software_pwm(new SoftwarePwm(
+      config, pwm, dma, static_cast<uint32_t>(num_steps), step_us));
+  if (!software_pwm->AllocateChain()) {
+    RPL4_LOG(LogLevel::Error,
+             "[SoftwarePwm::Create()] Cannot allocate the DMA chain.");
+    return nullptr;
+  }
+  software_pwm->SetUpPwm(range);
+  return software_pwm;
+}
+
+SoftwarePwm::SoftwarePwm(const Config& config, Pwm* pwm, Dma* dma,
+                         uint32_t num_steps, double step_us)
+    : config_(config),
+      pwm_(pwm),
+      dma_(dma),
+      num_steps_(num_steps),
+      step_us_(step_us),
+      shadow_masks_(num_steps * kWordsPerStep, 0) {}
+
+SoftwarePwm::~SoftwarePwm() {
+  if (control_blocks_ != nullptr) {
+    dma_->Abort();
+    pwm_->Disable(Pwm::Channel::kChannel1);
+    pwm_->DisableDma();
+  }
+  for (uint8_t pin = 0; pin < kNumOfPins; ++pin) {
+    if (channels_[pin].added) { Gpio::GetInstance(pin)->Write(false); }
+  }
+  DmaMemory& memory = DmaMemory::GetInstance();
+  if (masks_ != nullptr) { memory.Free(const_cast<uint32_t*>(masks_)); }
+  if (control_blocks_ != nullptr) { memory.Free(control_blocks_); }
+}
+
+bool SoftwarePwm::AllocateChain() {
+  DmaMemory& memory = DmaMemory::GetInstance();
+  size_t num_words = shadow_masks_.size();
+  uint32_t* masks =
+      static_cast<uint32_t*>(memory.Allocate((num_words + 1) * 4));
+  masks_ = masks;
+  control_blocks_ = static_cast<DmaControlBlock*>(memory.Allocate(
+      num_steps_ * kControlBlocksPerStep * sizeof(DmaControlBlock)));
+  if (masks_ == nullptr || control_blocks_ == nullptr) { return false; }
+
+  // The last word is written to the FIFO for pacing only.
+  DmaMemory::FillWords(masks_, num_words + 1, 0);
+
+  uint32_t masks_physical = memory.GetPhysicalAddress(masks);
+  uint32_t pacing_physical =
+      masks_physical + static_cast<uint32_t>(num_words * 4);
+  uint32_t control_blocks_physical =
+      memory.GetPhysicalAddress(control_blocks_);
+  uint32_t gpio_physical = kGpioAddressBase - kPeripheralBusOffset;
+  uint32_t set_physical =
+      gpio_physical + static_cast<uint32_t>(offsetof(GpioRegisterMap, gpset0));
+  uint32_t clear_physical =
+      gpio_physical + static_cast<uint32_t>(offsetof(GpioRegisterMap, gpclr0));
+  uint32_t fifo_physical = pwm_->GetFifoPhysicalAddress();
+
+  size_t num_control_blocks = num_steps_ * kControlBlocksPerStep;
+  for (uint32_t step = 0; step < num_steps_; ++step) {
+    uint32_t step_physical = masks_physical + step * kWordsPerStep * 4;
+    DmaControlBlock* control_block =
+        &control_blocks_[step * kControlBlocksPerStep];
+    // GPSET0 and GPSET1 are adjacent, as are GPCLR0 and GPCLR1.
+    Dma::ConfigureMemoryToMemory(&control_block[0], step_physical,
+                                 set_physical, 8);
+    Dma::ConfigureMemoryToMemory(&control_block[1], step_physical + 8,
+                                 clear_physical, 8);
+    Dma::ConfigureMemoryToPeripheral(&control_block[2], pacing_physical,
+                                     fifo_physical, 4, pwm_->GetDreq());
+  }
+  // Link each control block to the next, the last one to the first.
+  for (size_t i = 0; i < num_control_blocks; ++i) {
+    size_t next = (i + 1) % num_control_blocks;
+    control_blocks_[i].next_control_block =
+        control_blocks_physical +
+        static_cast<uint32_t>(next * sizeof(DmaControlBlock));
+  }
+  return true;
+}
+
+void SoftwarePwm::SetUpPwm(uint32_t range) {
+  // Channel 1 takes one FIFO word per range, which is one step.
+  Pwm::Channel channel = Pwm::Channel::kChannel1;
+  pwm_->Disable(channel);
+  pwm_->SetMode(channel, PwmRegisterMap::CTL::MODE::kPwmMode);
+  pwm_->SetRange(channel, range);
+  pwm_->EnableFifo(channel);
+  pwm_->ClearFifo();
+  pwm_->EnableDma();
+  pwm_->Enable(channel);
+
+  uint32_t control_blocks_physical =
+      DmaMemory::GetInstance().GetPhysicalAddress(control_blocks_);
+  dma_->Enable();
+  dma_->SetControlBlockAddress(control_blocks_physical);
+  dma_->Start();
+}
+
+bool SoftwarePwm::AddChannel(uint8_t pin) {
+  if (pin >= kNumOfPins) {
+    RPL4_LOG(LogLevel::Error,
+             "[SoftwarePwm::AddChannel()] Invalid GPIO %d", pin);
+    return false;
+  }
+  if (channels_[pin].added) { return true; }
+
+  Gpio::GetInstance(pin)->Write(false);
+  Gpio::SetAltFunction(pin, Gpio::AltFunction::kOutput);
+  channels_[pin].added = true;
+  channels_[pin].steps = 0;
+  // Cleared at step 0 until a width is set.
+  UpdateMask(0, true, pin, true);
+  return true;
+}
+
+void SoftwarePwm::RemoveChannel(uint8_t pin) {
+  if (pin >= kNumOfPins || !channels_[pin].added) { return; }
+  SetPulseSteps(pin, 0);
+  for (uint32_t step = 0; step < num_steps_; ++step) {
+    UpdateMask(step, true, pin, false);
+  }
+  channels_[pin].added = false;
+  // The chain no longer sets the pin, so this is final.
+  Gpio::GetInstance(pin)->Write(false);
+}
+
+bool SoftwarePwm::SetPulseSteps(uint8_t pin, uint32_t steps) {
+  if (pin >= kNumOfPins || !channels_[pin].added) {
+    RPL4_LOG(LogLevel::Error,
+             "[SoftwarePwm::SetPulseSteps()] GPIO %d is not a channel.", pin);
+    return false;
+  }
+  steps = std::min(steps, num_steps_);
+  uint32_t old_steps = channels_[pin].steps;
+  if (steps == old_steps) { return true; }
+
+  // Clear bits after the pulse do nothing. The ones of a longer width are
+  // left in place when the width shrinks, because removing one that the DMA
+  // has not reached yet would stretch the running pulse into the next period.
+  // They are removed when a longer width needs the pin high there, after the
+  // new clear bit is in place.
+  if (steps < num_steps_) { UpdateMask(steps, true, pin, true); }
+  UpdateMask(0, false, pin, steps > 0);
+  for (uint32_t step = old_steps; step < steps; ++step) {
+    UpdateMask(step, true, pin, false);
+  }
+  channels_[pin].steps = steps;
+  return true;
+}
+
+bool SoftwarePwm::SetPulseWidth(uint8_t pin, double width_us) {
+  long steps = std::lround(width_us / step_us_);
+  return SetPulseSteps(pin, static_cast<uint32_t>(std::max(steps, 0L)));
+}
+
+bool SoftwarePwm::SetDutyCycle(uint8_t pin, double duty) {
+  if (duty < 0.0) duty = 0.0;
+  if (duty > 1.0) duty = 1.0;
+  return SetPulseSteps(
+      pin, static_cast<uint32_t>(std::lround(duty * num_steps_)));
+}
+
+uint32_t SoftwarePwm::GetPulseSteps(uint8_t pin) const {
+  if (pin >= kNumOfPins || !channels_[pin].added) { return 0; }
+  return channels_[pin].steps;
+}
+
+void SoftwarePwm::UpdateMask(uint32_t step, bool clear_mask, uint8_t pin,
+                             bool value) {
+  size_t index = step * kWordsPerStep + (clear_mask ? 2 : 0) + pin / 32;
+  uint32_t bit = 1u << (pin % 32);
+  uint32_t word =
+      value ? (shadow_masks_[index] | bit) : (shadow_masks_[index] & ~bit);
+  if (word == shadow_masks_[index]) { return; }
+  shadow_masks_[index] = word;
+  masks_[index] = word;
+}
+
+}  // namespace rpl
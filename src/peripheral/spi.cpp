@@ -1,5 +1,6 @@
 #include "rpl4/peripheral/spi.hpp"
 
+#include <algorithm>
 #include <array>
 #include <memory>
 
@@ -8,58 +9,223 @@
 
 namespace rpl {
 
-std::array<std::shared_ptr<Spi>, Spi::kNumOfInstances> Spi::instances_ = {
-    nullptr};
+// Bytes in each of the TX and RX FIFOs
+constexpr uint32_t kFifoSize = 64;
+
+InstanceRegistry<Spi, Spi::kNumOfInstances> Spi::instances_;
+
+Spi* Spi::GetInstance(Port port) {
+  size_t index = static_cast<size_t>(port);
+  if (index >= kNumOfInstances) {
+    RPL4_LOG(LogLevel::Fatal, "[SPI::GetInstance()] Invalid port %zu.", index);
+    return nullptr;
+  }
 
-std::shared_ptr<Spi> Spi::GetInstance(Port port) {
   if (!IsInitialized()) {
-    Log(LogLevel::Error, "[SPI::GetInstance()] RPL is not initialized.");
-  } else if (instances_[static_cast<size_t>(port)] == nullptr) {
+    RPL4_LOG(LogLevel::Error, "[SPI::GetInstance()] RPL is not initialized.");
+    return nullptr;
+  }
+  return instances_.GetOrCreate(index, [port]() -> Spi* {
     switch (port) {
       case Port::kSpi0:
-        instances_[static_cast<size_t>(port)] =
-            std::shared_ptr<Spi>(new Spi(REG_SPI0));
-        break;
+        return new Spi(REG_SPI0, 0);
       case Port::kSpi3:
-        instances_[static_cast<size_t>(port)] =
-            std::shared_ptr<Spi>(new Spi(REG_SPI3));
-        break;
+        return new Spi(REG_SPI3, 3);
       case Port::kSpi4:
-        instances_[static_cast<size_t>(port)] =
-            std::shared_ptr<Spi>(new Spi(REG_SPI4));
-        break;
+        return new Spi(REG_SPI4, 4);
       case Port::kSpi5:
-        instances_[static_cast<size_t>(port)] =
-            std::shared_ptr<Spi>(new Spi(REG_SPI5));
-        break;
+        return new Spi(REG_SPI5, 5);
       case Port::kSpi6:
-        instances_[static_cast<size_t>(port)] =
-            std::shared_ptr<Spi>(new Spi(REG_SPI6));
-        break;
-      default:
-        Log(LogLevel::Fatal,
-            "[SPI::GetInstance()] Invalid port was given as an argument.");
-        break;
+        return new Spi(REG_SPI6, 6);
     }
+    return nullptr;
+  });
+}
+
+Spi::Spi(SpiRegisterMap* register_map, uint32_t instance)
+    : register_map_(register_map),
+      cs_(&register_map->cs, kTracePeripheral),
+      clk_(&register_map->clk, kTracePeripheral),
+      dc_(&register_map->dc, kTracePeripheral),
+      metrics_("spi", instance, true) {}
+
+void Spi::ApplyDeviceConfig(const DeviceConfig& config) {
+  cs_->cs = config.chip_select;
+  cs_->cpha = config.clock_phase;
+  cs_->cpol = config.clock_polarity;
+  switch (config.chip_select) {
+    case ChipSelect::kChipSelect0:
+      cs_->cspol0 = config.cs_polarity;
+      break;
+    case ChipSelect::kChipSelect1:
+      cs_->cspol1 = config.cs_polarity;
+      break;
+    case ChipSelect::kChipSelect2:
+      cs_->cspol2 = config.cs_polarity;
+      break;
+    default:
+      break;
   }
-  return instances_[static_cast<size_t>(port)];
+  cs_.CommitChanged();
+  SetClockDivider(config.clock_divider);
 }
 
-Spi::Spi(SpiRegisterMap* register_map) : register_map_(register_map) {}
+void Spi::SetLossiOutputHoldDelay(uint8_t apb_clocks) {
+  if (apb_clocks > 15) {
+    RPL4_LOG(LogLevel::Error,
+             "[Spi::SetLossiOutputHoldDelay()] Invalid APB clocks: %d. Must "
+             "be 0 ~ 15",
+             static_cast<int>(apb_clocks));
+    return;
+  }
+  register_map_->ltoh.toh = static_cast<uint32_t>(apb_clocks);
+  Trace::CountRead(kTracePeripheral);
+  Trace::CountWrite(kTracePeripheral);
+}
 
 void Spi::TransmitAndReceiveBlocking(const uint8_t* transmit_buf,
                                      uint8_t* receive_buf,
                                      uint32_t data_length) {
+  PeripheralMetrics::Timer timer(metrics_);
+  metrics_.AddOperation(data_length);
   StartTransmission();
   for (uint32_t i = 0; i < data_length; ++i) {
     ClearTxAndRxFifo();
-    while (!IsTxFifoWritable()) {}
+    SpinUntil(kTracePeripheral, [this]() { return IsTxFifoWritable(); });
     WriteDataToTxFifo(static_cast<uint32_t>(transmit_buf[i]));
-    while (!IsTransmissionCompleted()) {}
-    while (!IsRxFifoReadable()) {}
+    SpinUntil(kTracePeripheral, [this]() { return IsTransmissionCompleted(); });
+    SpinUntil(kTracePeripheral, [this]() { return IsRxFifoReadable(); });
     receive_buf[i] = static_cast<uint8_t>(ReadDataFromRxFifo());
   }
   EndTransmission();
 }
 
+void Spi::TransmitBlocking(const uint8_t* transmit_buf,
+                           uint32_t data_length) {
+  PeripheralMetrics::Timer timer(metrics_);
+  metrics_.AddOperation(data_length);
+  ClearFifoAndStartTransmission();
+  uint32_t tx_counter = 0;
+  while (tx_counter < data_length) {
+    while (tx_counter < data_length && IsTxFifoWritable()) {
+      WriteDataToTxFifo(static_cast<uint32_t>(transmit_buf[tx_counter++]));
+    }
+    // The controller stops shifting while the RX FIFO is full. Drop the
+    // received bytes all at once instead of reading them one by one.
+    Trace::CountRead(kTracePeripheral);
+    if (register_map_->cs.rxr == SpiRegisterMap::CS::RXR::kNearlyFull) {
+      ClearRxFifo();
+    }
+  }
+  SpinUntil(kTracePeripheral, [this]() {
+    if (IsTransmissionCompleted()) { return true; }
+    Trace::CountRead(kTracePeripheral);
+    if (register_map_->cs.rxf == SpiRegisterMap::CS::RXF::kFull) {
+      ClearRxFifo();
+    }
+    return false;
+  });
+  EndTransmission();
+}
+
+void Spi::ReceiveBlocking(uint8_t* receive_buf, uint32_t data_length,
+                          uint8_t fill) {
+  PeripheralMetrics::Timer timer(metrics_);
+  metrics_.AddOperation(data_length);
+  ClearFifoAndStartTransmission();
+  uint32_t tx_counter = 0;
+  uint32_t rx_counter = 0;
+  while (rx_counter < data_length) {
+    while (tx_counter < data_length && IsTxFifoWritable()) {
+      WriteDataToTxFifo(static_cast<uint32_t>(fill));
+      ++tx_counter;
+    }
+    while (rx_counter < data_length && IsRxFifoReadable()) {
+      receive_buf[rx_counter++] = static_cast<uint8_t>(ReadDataFromRxFifo());
+    }
+  }
+  SpinUntil(kTracePeripheral, [this]() { return IsTransmissionCompleted(); });
+  EndTransmission();
+}
+
+void Spi::Transfer(const SpiSegment* segments, size_t num_segments) {
+  PeripheralMetrics::Timer timer(metrics_);
+  metrics_.AddOperation(GetTotalLength(segments, num_segments));
+  SegmentCursor tx(segments, num_segments);
+  SegmentCursor rx(segments, num_segments);
+  ClearFifoAndStartTransmission();
+  while (!rx.AtEnd()) {
+    // The controller stops shifting while the RX FIFO is full, so the TX
+    // FIFO can be filled as far as it accepts data.
+    while (!tx.AtEnd() && IsTxFifoWritable()) {
+      WriteDataToTxFifo(static_cast<uint32_t>(tx.Transmit()));
+      tx.Next();
+    }
+    while (!rx.AtEnd() && IsRxFifoReadable()) {
+      rx.Receive(static_cast<uint8_t>(ReadDataFromRxFifo()));
+      rx.Next();
+    }
+  }
+  SpinUntil(kTracePeripheral, [this]() { return IsTransmissionCompleted(); });
+  EndTransmission();
+}
+
+void Spi::TransmitAndReceivePackedBlocking(const uint8_t* transmit_buf,
+                                           uint8_t* receive_buf,
+                                           uint32_t data_length) {
+  if (data_length == 0 || data_length > 0xffff) {
+    RPL4_LOG(LogLevel::Error,
+             "[Spi::TransmitAndReceivePackedBlocking()] Invalid data "
+             "length: %u. Must be 1 ~ 65535",
+             data_length);
+    metrics_.AddError();
+    return;
+  }
+  PeripheralMetrics::Timer timer(metrics_);
+  metrics_.AddOperation(data_length);
+
+  // Clear the FIFOs, enable DMA mode and start the transfer with one write.
+  using CS = SpiRegisterMap::CS;
+  CS::DMAEN dmaen = ReadField(register_map_->cs, SpiFields::CS::kDmaen);
+  SetDataLength(static_cast<uint16_t>(data_length));
+  ModifyRegister(register_map_->cs,
+                 SpiFields::CS::kClear(CS::CLEAR::kClearBothFifo) |
+                     SpiFields::CS::kDmaen(CS::DMAEN::kEnable) |
+                     SpiFields::CS::kTa(CS::TA::kActive));
+  Trace::CountRead(kTracePeripheral, 2);
+  Trace::CountWrite(kTracePeripheral);
+
+  // Every FIFO access moves a whole word, but RXD is set by a single byte,
+  // so a word popped while its bytes are still being clocked is partial.
+  // The transfer runs in chunks of at most one FIFO: the chunk is written,
+  // DONE tells all of it has been clocked, and then it is read. Neither
+  // FIFO can overrun and only whole words, or the final bytes, are read.
+  uint32_t counter = 0;
+  while (counter < data_length) {
+    uint32_t chunk_end = std::min(counter + kFifoSize, data_length);
+    for (uint32_t tx_counter = counter; tx_counter < chunk_end;) {
+      SpinUntil(kTracePeripheral, [this]() { return IsTxFifoWritable(); });
+      // The least significant byte is shifted out first.
+      uint32_t word = 0;
+      for (uint32_t i = 0; i < 4 && tx_counter < chunk_end; ++i) {
+        word |= static_cast<uint32_t>(transmit_buf[tx_counter++]) << (i * 8);
+      }
+      WriteDataToTxFifo(word);
+    }
+    SpinUntil(kTracePeripheral, [this]() { return IsTransmissionCompleted(); });
+    while (counter < chunk_end) {
+      uint32_t word = ReadDataFromRxFifo();
+      for (uint32_t i = 0; i < 4 && counter < chunk_end; ++i) {
+        receive_buf[counter++] = static_cast<uint8_t>(word >> (i * 8));
+      }
+    }
+  }
+
+  // Restore the DMA mode of the caller, e.g. a Dma driving this port.
+  ModifyRegister(register_map_->cs, SpiFields::CS::kTa(CS::TA::kInactive) |
+                                        SpiFields::CS::kDmaen(dmaen));
+  Trace::CountRead(kTracePeripheral);
+  Trace::CountWrite(kTracePeripheral);
+}
+
 }  // namespace rpl
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include "rpl4/peripheral/ws2812.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "rpl4/system/dma_memory.hpp"
+#include "rpl4/system/system.hpp"
+
+namespace rpl {
+
+Ws2812Encoder::Ws2812Encoder(ColorOrder order) {
+  switch (order) {
+    case ColorOrder::kGrb:
+      shifts_ = {8, 16, 0, 0};
+      bytes_per_led_ = 3;
+      break;
+    case ColorOrder::kRgb:
+      shifts_ = {16, 8, 0, 0};
+      bytes_per_led_ = 3;
+      break;
+    case ColorOrder::kBrg:
+      shifts_ = {0, 16, 8, 0};
+      bytes_per_led_ = 3;
+      break;
+    case ColorOrder::kGrbw:
+      shifts_ = {8, 16, 0, 24};
+      bytes_per_led_ = 4;
+      break;
+    case ColorOrder::kRgbw:
+    default:
+      shifts_ = {16, 8, 0, 24};
+      bytes_per_led_ = 4;
+      break;
+  }
+  SetBrightness(255);
+}
+
+void Ws2812Encoder::SetBrightness(uint8_t brightness) {
+  for (uint32_t value = 0; value < 256; ++value) {
+    uint32_t scaled = (value * (static_cast<uint32_t>(brightness) + 1)) >> 8;
+    uint32_t pattern = 0;
+    for (int bit = 7; bit >= 0; --bit) {
+      pattern = (pattern << 3) | (((scaled >> bit) & 1) ? 0b110 : 0b100);
+    }
+    table_[value] = pattern;
+  }
+}
+
+void Ws2812Encoder::Encode(const uint32_t* pixels, size_t num_leds,
+                           uint32_t* out) const {
+  // Holds up to 31 pending bits and the 24 bits of the next byte.
+  uint64_t accumulator = 0;
+  uint32_t bits = 0;
+  for (size_t i = 0; i < num_leds; ++i) {
+    uint32_t pixel = pixels[i];
+    for (uint32_t byte = 0; byte < bytes_per_led_; ++byte) {
+      accumulator = (accumulator << 24) |
+                    table_[(pixel >> shifts_[byte]) & 0xff];
+      bits += 24;
+      if (bits >= 32) {
+        bits -= 32;
+        *out++ = static_cast<uint32_t>(accumulator >> bits);
+      }
+    }
+  }
+  if (bits > 0) { *out = static_cast<uint32_t>(accumulator << (32 - bits)); }
+}
+
+std::unique_ptr<Ws2812> Ws2812::Create(const Config& config) {
+  if (config.num_leds == 0) {
+    RPL4_LOG(LogLevel::Error, "[Ws2812::Create()] No LED is configured.");
+    return nullptr;
+  }
+  Pwm* pwm = Pwm::GetInstance(config.port);
+  Dma* dma = Dma::GetInstance(config.dma_channel);
+  if (pwm == nullptr || dma == nullptr) { return nullptr; }
+  if (!Pwm::ConfigureGpioPin(config.port, config.channel, config.pin)) {
+    return nullptr;
+  }
+  // The serializer needs its own bit rate, which the shared clock cannot
+  // have while the other port runs at another frequency.
+  if (pwm->IsClockUsedByOtherPort() &&
+      std::fabs(pwm->GetClockFrequency() - kBitFrequency * 3) >
+          kBitFrequency * 3 * 0.01) {
+    RPL4_LOG(LogLevel::Error,
+             "[Ws2812::Create()] The PWM clock is in use at %f Hz. Create the "
+             "strip before the other port is started.",
+             pwm->GetClockFrequency());
+    return nullptr;
+  }
+
+  std::unique_ptr<Ws2812> strip(new Ws2812(config, pwm, dma));
+  if (!strip->AllocateFrameBuffer(strip->buffers_[0]) ||
+      !strip->AllocateFrameBuffer(strip->buffers_[1])) {
+    RPL4_LOG(LogLevel::Error,
+             "[Ws2812::Create()] Cannot allocate the frame buffers.");
+    return nullptr;
+  }
+  strip->SetUpPwm();
+  return strip;
+}
+
+Ws2812::Ws2812(const Config& config, Pwm* pwm, Dma* dma)
+    : config_(config),
+      pwm_(pwm),
+      dma_(dma),
+      encoder_(config.order),
+      pixels_(config.num_leds, 0) {
+  encoder_.SetBrightness(config.brightness);
+  constexpr double kSerializerFrequency = kBitFrequency * 3;
+  size_t reset_words =
+      static_cast<size_t>(std::ceil(kResetTime * kSerializerFrequency / 32));
+  data_words_ = encoder_.GetNumOfWords(config.num_leds);
+  total_words_ = data_words_ + reset_words;
+  num_control_blocks_ =
+      (total_words_ * sizeof(uint32_t) + kMaxControlBlockLength - 1) /
+      kMaxControlBlockLength;
+  double frame_ms = total_words_ * 32 / kSerializerFrequency * 1000.0;
+  timeout_ms_ = static_cast<uint32_t>(frame_ms * 2) + 10;
+}
+
+Ws2812::~Ws2812() {
+  if (in_flight_) { Wait(); }
+  if (buffers_[0].words != nullptr && buffers_[1].words != nullptr) {
+    pwm_->Disable(config_.channel);
+    pwm_->DisableDma();
+  }
+  FreeFrameBuffer(buffers_[0]);
+  FreeFrameBuffer(buffers_[1]);
+}
+
+bool Ws2812::Show() {
+  // Encode while the previous frame is still being sent.
+  FrameBuffer& buffer = buffers_[back_];
+  encoder_.Encode(pixels_.data(), pixels_.size(), buffer.words);
+  if (!Wait()) { return false; }
+
+  // Start() writes back the END flag read as 1, which clears it for the next
+  // WaitForCompletion().
+  dma_->SetControlBlockAddress(buffer.control_blocks_physical);
+  dma_->Start();
+  in_flight_ = true;
+  back_ ^= 1;
+  return true;
+}
+
+bool Ws2812::Wait() {
+  if (!in_flight_) { return true; }
+  in_flight_ = false;
+  if (!dma_->WaitForCompletion(timeout_ms_)) {
+    dma_->Abort();
+    return false;
+  }
+  return true;
+}
+
+bool Ws2812::AllocateFrameBuffer(FrameBuffer& buffer) {
+  DmaMemory& memory = DmaMemory::GetInstance();
+  buffer.words = static_cast<uint32_t*>(
+      memory.Allocate(total_words_ * sizeof(uint32_t)));
+  buffer.control_blocks = static_cast<DmaControlBlock*>(
+      memory.Allocate(num_control_blocks_ * sizeof(DmaControlBlock)));
+  if (buffer.words == nullptr || buffer.control_blocks == nullptr) {
+    return false;
+  }
+
+  // The reset time after the LEDs is never encoded, so it is cleared once.
+  DmaMemory::FillWords(buffer.words + data_words_, total_words_ - data_words_,
+                       0);
+
+  uint32_t words_physical = memory.GetPhysicalAddress(buffer.words);
+  buffer.control_blocks_physical =
+      memory.GetPhysicalAddress(buffer.control_blocks);
+  uint32_t fifo_physical = pwm_->GetFifoPhysicalAddress();
+  DmaRegisterMap::TI::PERMAP dreq = pwm_->GetDreq();
+
+  // The frame is split so that each control block also fits a lite channel.
+  uint32_t total_length =
+      static_cast<uint32_t>(total_words_ * sizeof(uint32_t));
+  uint32_t offset = 0;
+  for (size_t i = 0; i < num_control_blocks_; ++i) {
+    uint32_t length = std::min(kMaxControlBlockLength, total_length - offset);
+    DmaControlBlock* control_block = &buffer.control_blocks[i];
+    Dma::ConfigureMemoryToPeripheral(control_block, words_physical + offset,
+                                     fifo_physical, length, dreq);
+    control_block->next_control_block =
+        i + 1 < num_control_blocks_
+            ? buffer.control_blocks_physical +
+                  static_cast<uint32_t>((i + 1) * sizeof(DmaControlBlock))
+            : 0;
+    offset += length;
+  }
+  return true;
+}
+
+void Ws2812::FreeFrameBuffer(FrameBuffer& buffer) {
+  DmaMemory& memory = DmaMemory::GetInstance();
+  if (buffer.words != nullptr) { memory.Free(buffer.words); }
+  if (buffer.control_blocks != nullptr) {
+    memory.Free(buffer.control_blocks);
+  }
+  buffer = FrameBuffer();
+}
+
+void Ws2812::SetUpPwm() {
+  // Each FIFO word is shifted out as 32 serializer bits, MSB first.
+  pwm_->Disable(config_.channel);
+  pwm_->InitializeClock(kBitFrequency * 3);
+  pwm_->SetMode(config_.channel, PwmRegisterMap::CTL::MODE::kSerializerMode);
+  pwm_->SetRange(config_.channel, 32);
+  pwm_->EnableFifo(config_.channel);
+  pwm_->ClearFifo();
+  pwm_->EnableDma();
+  pwm_->Enable(config_.channel);
+  dma_->Enable();
+}
+
+}  // namespace rpl
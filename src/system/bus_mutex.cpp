@@ -0,0 +1,33 @@
+#include "rpl4/system/bus_mutex.hpp"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace rpl {
+
+void BusMutex::LockSlow() {
+  // Spin first: bus transactions are usually short, and sleeping costs two
+  // system calls.
+  for (int i = 0; i < kSpinCount; ++i) {
+    uint32_t expected = kUnlocked;
+    if (state_.compare_exchange_weak(expected, kLocked,
+                                     std::memory_order_acquire)) {
+      return;
+    }
+  }
+
+  // Mark the lock as contended so that unlock() wakes us up, then sleep until
+  // it is released.
+  while (state_.exchange(kContended, std::memory_order_acquire) != kUnlocked) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&state_),
+            FUTEX_WAIT_PRIVATE, kContended, nullptr, nullptr, 0);
+  }
+}
+
+void BusMutex::WakeOne() {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&state_), FUTEX_WAKE_PRIVATE,
+          1, nullptr, nullptr, 0);
+}
+
+}  // namespace rpl
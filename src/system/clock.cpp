@@ -1,13 +1,40 @@
 #include "rpl4/system/clock.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
 
+#include "rpl4/peripheral/gpio.hpp"
 #include "rpl4/registers/registers.hpp"
+#include "rpl4/system/system.hpp"
 
 namespace rpl {
 
 constexpr uint32_t kClockPassword = 0x5a;
 
+// CM_xxxCTL bits
+constexpr uint32_t kClockSourceMask = 0xf;
+constexpr uint32_t kClockEnable = 1 << 4;
+constexpr uint32_t kClockKill = 1 << 5;
+constexpr uint32_t kClockBusy = 1 << 7;
+constexpr uint32_t kClockFlip = 1 << 8;
+constexpr uint32_t kClockMashShift = 9;
+constexpr uint32_t kClockMashMask = 3 << kClockMashShift;
+
+constexpr uint32_t kMaxDivi = 4095;
+// A clock that is being disabled stops at the end of its current cycle,
+// which takes less than 0.1 ms at the slowest setting.
+constexpr std::chrono::milliseconds kClockStopTimeout{10};
+// Highest output frequency, including the shortest period with MASH.
+constexpr double kMaxOutputFrequency = 125000000.0;
+
+// Range of the divisor around DIVI for each MASH level, from the datasheet.
+constexpr int32_t kMashMinOffset[] = {0, 0, -1, -3};
+constexpr int32_t kMashMaxOffset[] = {0, 1, 2, 4};
+// DIVI must be at least this for each MASH level.
+constexpr uint32_t kMashMinDivi[] = {1, 2, 3, 5};
+
 void SetCmCtl(volatile uint32_t& reg, uint32_t data) {
   reg = (kClockPassword << 24) | data;
 }
@@ -16,21 +43,276 @@ void SetCmDiv(volatile uint32_t& reg, uint32_t divi, uint32_t divf) {
   reg = (kClockPassword << 24) | (divi << 12) | divf;
 }
 
+/**
+ * @brief Disable the clock and wait until it has stopped.
+ * @details Source and MASH must not be changed while BUSY is set. If it does
+ *          not clear in time, the clock generator is killed.
+ *
+ * @return false if the clock had to be killed
+ */
+static bool StopClock(volatile uint32_t& reg_ctl) {
+  uint32_t keep = reg_ctl & (kClockSourceMask | kClockFlip | kClockMashMask);
+  SetCmCtl(reg_ctl, keep);
+
+  auto deadline = std::chrono::steady_clock::now() + kClockStopTimeout;
+  while (reg_ctl & kClockBusy) {
+    if (std::chrono::steady_clock::now() >= deadline) {
+      RPL4_LOG(LogLevel::Warning,
+               "[Clock] The clock did not stop in time and was killed.");
+      SetCmCtl(reg_ctl, keep | kClockKill);
+      SetCmCtl(reg_ctl, keep);
+      return false;
+    }
+  }
+  return true;
+}
+
+static void StartClock(volatile uint32_t& reg_ctl, volatile uint32_t& reg_div,
+                       ClockSource src, uint32_t divi, uint32_t divf,
+                       uint8_t mash) {
+  uint32_t ctl = static_cast<uint32_t>(src) |
+                 ((static_cast<uint32_t>(mash) & 3) << kClockMashShift);
+  // Source and MASH are set before the clock is enabled, never together.
+  SetCmCtl(reg_ctl, ctl);
+  SetCmDiv(reg_div, divi, divf);
+  SetCmCtl(reg_ctl, ctl | kClockEnable);
+}
+
 void ClockConfig(volatile uint32_t& reg_ctl, volatile uint32_t& reg_div,
                  ClockSource src, double div, uint8_t mash) {
-  SetCmCtl(reg_ctl, reg_ctl & 0xffef);  // disable clock
-
   uint16_t divi = static_cast<uint16_t>(div) & 0b111111111111;
-  uint16_t divf = static_cast<uint16_t>((div - static_cast<uint16_t>(div)) * 4096) &
-                  0b111111111111;
+  uint16_t divf =
+      static_cast<uint16_t>((div - static_cast<uint16_t>(div)) * 4096) &
+      0b111111111111;
 
-  while (reg_ctl & 0x0080)
-    ;  // wait for the end of clock
+  StopClock(reg_ctl);
+  StartClock(reg_ctl, reg_div, src, divi, divf, mash);
+}
 
-  SetCmCtl(reg_ctl, static_cast<uint32_t>(src) |
-                        ((mash & 3) << 9));  // set clock source and mash
-  SetCmDiv(reg_div, divi, divf);
-  SetCmCtl(reg_ctl, reg_ctl | (1 << 4));  // enable clock
+static double GetSourceFrequency(ClockSource source) {
+  switch (source) {
+    case ClockSource::kOsc:
+      return kOscFrequency;
+    case ClockSource::kPllC:
+      return kPllCFrequency;
+    case ClockSource::kPllD:
+      return kPllDFrequency;
+    default:
+      return 0.0;
+  }
+}
+
+// Fill in the frequency and the jitter of a plan from its settings.
+static ClockPlan MakePlan(ClockSource source, uint32_t divi, uint32_t divf,
+                          uint8_t mash, double requested) {
+  ClockPlan plan;
+  plan.source = source;
+  plan.divi = static_cast<uint16_t>(divi);
+  plan.divf = static_cast<uint16_t>(mash == 0 ? 0 : divf);
+  plan.mash = mash;
+  double source_frequency = GetSourceFrequency(source);
+  double divisor = plan.divi + plan.divf / 4096.0;
+  plan.frequency = source_frequency / divisor;
+  if (requested > 0.0) {
+    plan.error = (plan.frequency - requested) / requested;
+  }
+  if (plan.divf != 0) {
+    plan.jitter_ns = (kMashMaxOffset[mash] - kMashMinOffset[mash]) /
+                     source_frequency * 1e9;
+  }
+  return plan;
+}
+
+// Whether plan a is better than plan b for the request.
+static bool IsBetterPlan(const ClockPlan& a, const ClockPlan& b,
+                         double tolerance) {
+  if (!b.IsValid()) { return true; }
+  bool a_within = std::fabs(a.error) <= tolerance;
+  bool b_within = std::fabs(b.error) <= tolerance;
+  if (a_within != b_within) { return a_within; }
+  if (a_within) { return a.jitter_ns < b.jitter_ns; }
+  if (std::fabs(a.error) != std::fabs(b.error)) {
+    return std::fabs(a.error) < std::fabs(b.error);
+  }
+  return a.jitter_ns < b.jitter_ns;
+}
+
+InstanceRegistry<ClockManager, 1> ClockManager::instance_;
+
+ClockManager* ClockManager::GetInstance() {
+  if (!IsInitialized()) {
+    RPL4_LOG(LogLevel::Error,
+             "[ClockManager::GetInstance()] RPL is not initialized.");
+    return nullptr;
+  }
+  return instance_.GetOrCreate(0, []() { return new ClockManager(); });
+}
+
+ClockPlan ClockManager::Plan(const ClockRequest& request) {
+  ClockPlan best;
+  if (request.frequency <= 0.0 || request.frequency > kMaxOutputFrequency) {
+    RPL4_LOG(LogLevel::Error, "[ClockManager::Plan()] Invalid frequency: %f",
+             request.frequency);
+    return best;
+  }
+  uint8_t max_mash = request.max_mash > 3 ? 3 : request.max_mash;
+
+  // In order of preference when the plans are equally good.
+  static constexpr ClockSource kSources[] = {
+      ClockSource::kOsc, ClockSource::kPllD, ClockSource::kPllC};
+  for (ClockSource source : kSources) {
+    if (source == ClockSource::kPllC && !request.allow_pllc) { continue; }
+    double source_frequency = GetSourceFrequency(source);
+    double divisor = source_frequency / request.frequency;
+
+    for (uint8_t mash = 0; mash <= max_mash; ++mash) {
+      uint32_t divi = 0;
+      uint32_t divf = 0;
+      if (mash == 0) {
+        divi = static_cast<uint32_t>(std::lround(divisor));
+      } else {
+        uint32_t scaled = static_cast<uint32_t>(
+            std::min(std::lround(divisor * 4096.0), 4096L * (kMaxDivi + 1)));
+        divi = scaled >> 12;
+        divf = scaled & 0xfff;
+        // MASH only adds jitter to an integer divisor.
+        if (divf == 0) { continue; }
+      }
+      if (divi < kMashMinDivi[mash] || divi > kMaxDivi) { continue; }
+      // The shortest period must not exceed the output limit.
+      if (source_frequency / (divi + kMashMinOffset[mash]) >
+          kMaxOutputFrequency) {
+        continue;
+      }
+      ClockPlan plan = MakePlan(source, divi, divf, mash, request.frequency);
+      if (IsBetterPlan(plan, best, request.tolerance)) { best = plan; }
+    }
+  }
+  return best;
+}
+
+// The DIV register follows the CTL register of each clock.
+static volatile uint32_t& GetControlRegister(ClockManager::Clock clock) {
+  switch (clock) {
+    case ClockManager::Clock::kGp0:
+      return REG_CLK->CM_GP0CTL;
+    case ClockManager::Clock::kGp1:
+      return REG_CLK->CM_GP1CTL;
+    case ClockManager::Clock::kGp2:
+      return REG_CLK->CM_GP2CTL;
+    case ClockManager::Clock::kPcm:
+      return REG_CLK->CM_PCMCTL;
+    case ClockManager::Clock::kPwm:
+    default:
+      return REG_CLK->CM_PWMCTL;
+  }
+}
+
+ClockPlan ClockManager::SetFrequency(Clock clock,
+                                     const ClockRequest& request) {
+  ClockPlan plan = Plan(request);
+  if (!plan.IsValid() || !Apply(clock, plan)) { return ClockPlan(); }
+  return plan;
+}
+
+bool ClockManager::Apply(Clock clock, const ClockPlan& plan) {
+  size_t index = static_cast<size_t>(clock);
+  if (index >= kNumOfClocks || !plan.IsValid()) {
+    RPL4_LOG(LogLevel::Error, "[ClockManager::Apply()] Invalid clock %zu.",
+             index);
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  State& state = states_[index];
+  if (!state.known) { LoadState(clock, state); }
+  if (state.enabled && state.plan.source == plan.source &&
+      state.plan.divi == plan.divi && state.plan.divf == plan.divf &&
+      state.plan.mash == plan.mash) {
+    return true;
+  }
+
+  volatile uint32_t& reg_ctl = GetControlRegister(clock);
+  volatile uint32_t& reg_div = (&reg_ctl)[1];
+  if (!StopClock(reg_ctl)) {
+    // The kill may glitch the output, so the clock is left stopped rather
+    // than restarted as if nothing happened.
+    state.enabled = false;
+    return false;
+  }
+  StartClock(reg_ctl, reg_div, plan.source, plan.divi, plan.divf, plan.mash);
+  state.enabled = true;
+  state.plan = plan;
+  return true;
+}
+
+void ClockManager::Stop(Clock clock) {
+  size_t index = static_cast<size_t>(clock);
+  if (index >= kNumOfClocks) { return; }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  State& state = states_[index];
+  StopClock(GetControlRegister(clock));
+  state.known = true;
+  state.enabled = false;
+}
+
+ClockPlan ClockManager::GetPlan(Clock clock) {
+  size_t index = static_cast<size_t>(clock);
+  if (index >= kNumOfClocks) { return ClockPlan(); }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  State& state = states_[index];
+  if (!state.known) { LoadState(clock, state); }
+  return state.enabled ? state.plan : ClockPlan();
+}
+
+void ClockManager::LoadState(Clock clock, State& state) {
+  volatile uint32_t& reg_ctl = GetControlRegister(clock);
+  uint32_t ctl = reg_ctl;
+  uint32_t div = (&reg_ctl)[1];
+  ClockSource source = static_cast<ClockSource>(ctl & kClockSourceMask);
+  uint32_t divi = (div >> 12) & kMaxDivi;
+  uint8_t mash =
+      static_cast<uint8_t>((ctl & kClockMashMask) >> kClockMashShift);
+
+  state.known = true;
+  // A clock running from a source of unknown frequency is reprogrammed on the
+  // next Apply().
+  state.enabled = (ctl & kClockEnable) != 0 && divi != 0 &&
+                  GetSourceFrequency(source) > 0.0;
+  if (state.enabled) {
+    state.plan = MakePlan(source, divi, div & 0xfff, mash, 0.0);
+  }
+}
+
+bool ClockManager::ConfigureGpioPin(Clock clock, uint8_t pin) {
+  Gpio::AltFunction alt_function = Gpio::AltFunction::kAlt0;
+  bool valid = false;
+  switch (clock) {
+    case Clock::kGp0:
+      valid = pin == 4 || pin == 20 || pin == 32 || pin == 34;
+      if (pin == 20) { alt_function = Gpio::AltFunction::kAlt5; }
+      break;
+    case Clock::kGp1:
+      valid = pin == 5 || pin == 21 || pin == 42 || pin == 44;
+      if (pin == 21) { alt_function = Gpio::AltFunction::kAlt5; }
+      break;
+    case Clock::kGp2:
+      valid = pin == 6 || pin == 43;
+      break;
+    default:
+      break;
+  }
+  if (!valid) {
+    RPL4_LOG(LogLevel::Error,
+             "[ClockManager::ConfigureGpioPin()] GPIO %d has no function of "
+             "clock %zu",
+             pin, static_cast<size_t>(clock));
+    return false;
+  }
+  Gpio::SetAltFunction(pin, alt_function);
+  return true;
 }
 
-}  // namespace rpl
\ No newline at end of file
+}  // namespace rpl
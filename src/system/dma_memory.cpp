@@ -49,7 +49,7 @@ DmaMemory::~DmaMemory() {
 bool DmaMemory::InitializeMailbox() {
   mailbox_fd_ = open("/dev/vcio", O_RDWR);
   if (mailbox_fd_ < 0) {
-    Log(LogLevel::Error, "[DmaMemory] Failed to open /dev/vcio");
+    RPL4_LOG(LogLevel::Error, "[DmaMemory] Failed to open /dev/vcio");
     return false;
   }
   return true;
@@ -64,7 +64,7 @@ void DmaMemory::CloseMailbox() {
 
 bool DmaMemory::AllocateBlock(size_t size, MemoryBlock& block) {
   if (mailbox_fd_ < 0) {
-    Log(LogLevel::Error, "[DmaMemory] Mailbox not initialized");
+    RPL4_LOG(LogLevel::Error, "[DmaMemory] Mailbox not initialized");
     return false;
   }
 
@@ -86,12 +86,12 @@ bool DmaMemory::AllocateBlock(size_t size, MemoryBlock& block) {
   message[8] = 0;  // end tag
 
   if (ioctl(mailbox_fd_, _IOWR(100, 0, char*), message) < 0) {
-    Log(LogLevel::Error, "[DmaMemory] ioctl failed for memory allocation");
+    RPL4_LOG(LogLevel::Error, "[DmaMemory] ioctl failed for memory allocation");
     return false;
   }
 
   if (message[1] != kMailboxResponseSuccess) {
-    Log(LogLevel::Error, "[DmaMemory] Mailbox response error");
+    RPL4_LOG(LogLevel::Error, "[DmaMemory] Mailbox response error");
     return false;
   }
 
@@ -109,12 +109,12 @@ bool DmaMemory::AllocateBlock(size_t size, MemoryBlock& block) {
   message[6] = 0;
 
   if (ioctl(mailbox_fd_, _IOWR(100, 0, char*), message) < 0) {
-    Log(LogLevel::Error, "[DmaMemory] ioctl failed for memory lock");
+    RPL4_LOG(LogLevel::Error, "[DmaMemory] ioctl failed for memory lock");
     return false;
   }
 
   if (message[1] != kMailboxResponseSuccess) {
-    Log(LogLevel::Error, "[DmaMemory] Mailbox lock response error");
+    RPL4_LOG(LogLevel::Error, "[DmaMemory] Mailbox lock response error");
     return false;
   }
 
@@ -123,7 +123,7 @@ bool DmaMemory::AllocateBlock(size_t size, MemoryBlock& block) {
   // Map physical memory to user space
   int mem_fd = open("/dev/mem", O_RDWR | O_SYNC);
   if (mem_fd < 0) {
-    Log(LogLevel::Error, "[DmaMemory] Failed to open /dev/mem");
+    RPL4_LOG(LogLevel::Error, "[DmaMemory] Failed to open /dev/mem");
     return false;
   }
 
@@ -134,7 +134,7 @@ bool DmaMemory::AllocateBlock(size_t size, MemoryBlock& block) {
   close(mem_fd);
 
   if (block.virtual_addr == MAP_FAILED) {
-    Log(LogLevel::Error, "[DmaMemory] mmap failed");
+    RPL4_LOG(LogLevel::Error, "[DmaMemory] mmap failed");
     return false;
   }
 
@@ -223,7 +223,7 @@ void DmaMemory::Free(void* ptr) {
     }
   }
 
-  Log(LogLevel::Warning, "[DmaMemory] Attempted to free unknown pointer");
+  RPL4_LOG(LogLevel::Warning, "[DmaMemory] Attempted to free unknown pointer");
 }
 
 uint32_t DmaMemory::GetPhysicalAddress(void* virtual_addr) {
@@ -242,9 +242,30 @@ uint32_t DmaMemory::GetPhysicalAddress(void* virtual_addr) {
     }
   }
 
-  Log(LogLevel::Error,
-      "[DmaMemory] Virtual address not found in allocated blocks");
+  RPL4_LOG(LogLevel::Error,
+           "[DmaMemory] Virtual address not found in allocated blocks");
   return 0;
 }
 
+bool DmaMemory::Contains(const void* virtual_addr, size_t size) const {
+  const uint8_t* begin = static_cast<const uint8_t*>(virtual_addr);
+  for (const auto& block : blocks_) {
+    const uint8_t* block_begin =
+        static_cast<const uint8_t*>(block.virtual_addr);
+    if (!block.in_use || begin < block_begin) {
+      continue;
+    }
+    size_t offset = static_cast<size_t>(begin - block_begin);
+    if (offset < block.size && size <= block.size - offset) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void DmaMemory::FillWords(volatile uint32_t* words, size_t count,
+                          uint32_t value) {
+  for (size_t i = 0; i < count; ++i) { words[i] = value; }
+}
+
 }  // namespace rpl
@@ -1,45 +1,517 @@
 #include "rpl4/system/log.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
-
-#ifdef RPL4_LOG_LEVEL
-    #include <cstdarg>
-#endif
+#include <mutex>
+#include <thread>
 
 namespace rpl {
 
-void Log(LogLevel level, const char* format, ...){
-#ifdef RPL4_LOG_LEVEL
-    if (level <= RPL4_LOG_LEVEL) {
-        char buffer[256];
-        va_list args;
-        va_start(args, format);
-        vsnprintf(buffer, sizeof(buffer), format, args);
-        va_end(args);
-        std::string message =  std::string(buffer);
-
-        if (level == LogLevel::Fatal) {
-            std::cout << "\033[1;35m[RPL4 Fatal] " << message << "\033[m" << std::endl;
-            std::cout << "\033[1;35m  **Program will terminate...\033[m" << std::endl;
-            exit(-1);
+namespace {
+
+// Conversion specification of a printf format string.
+struct FormatSpec {
+  const char* begin;     // '%'
+  const char* modifier;  // Length modifier, or the conversion if there is none
+  const char* end;       // One past the conversion
+  int num_stars;         // '*' given as the width or the precision
+  char length;           // First character of the length modifier or '\0'
+  char conversion;       // '\0' if the format string ends in the spec
+};
+
+// Parses the specification that starts at the '%' pointed to by p.
+FormatSpec ParseFormatSpec(const char* p) {
+  FormatSpec spec = {p, nullptr, nullptr, 0, '\0', '\0'};
+  ++p;
+  while (*p != '\0' && std::strchr("-+ #0'", *p) != nullptr) { ++p; }
+  if (*p == '*') {
+    ++spec.num_stars;
+    ++p;
+  }
+  while (*p >= '0' && *p <= '9') { ++p; }
+  if (*p == '.') {
+    ++p;
+    if (*p == '*') {
+      ++spec.num_stars;
+      ++p;
+    }
+    while (*p >= '0' && *p <= '9') { ++p; }
+  }
+  spec.modifier = p;
+  if (*p != '\0' && std::strchr("hljztLq", *p) != nullptr) {
+    spec.length = *p;
+    ++p;
+    if ((*p == 'h' || *p == 'l') && *p == spec.length) { ++p; }
+  }
+  spec.conversion = *p;
+  spec.end = *p == '\0' ? p : p + 1;
+  return spec;
+}
+
+bool IsSignedConversion(char c) { return c == 'd' || c == 'i'; }
+bool IsUnsignedConversion(char c) {
+  return c != '\0' && std::strchr("ouxX", c) != nullptr;
+}
+bool IsFloatingConversion(char c) {
+  return c != '\0' && std::strchr("fFeEgGaA", c) != nullptr;
+}
+
+union LogArg {
+  int64_t integer;
+  uint64_t unsigned_integer;
+  double real;
+  const void* pointer;
+};
+
+constexpr size_t kMaxArgs = 8;
+constexpr size_t kStringCapacity = 128;
+
+// A message as pushed by Log(). The format string is referenced, as it is a
+// literal in practice, and the arguments are copied.
+struct Record {
+  std::atomic<size_t> sequence;
+  LogLevel level;
+  uint8_t num_args;
+  bool truncated;
+  const char* format;
+  LogArg args[kMaxArgs];
+  // Copies of the %s arguments. The last byte is always '\0' and is used for
+  // strings that do not fit.
+  char strings[kStringCapacity + 1];
+};
+
+// Copies the arguments of format into record. Stops at the arguments that do
+// not fit and marks the record as truncated.
+void EncodeRecord(Record& record, const char* format, va_list args) {
+  record.num_args = 0;
+  record.truncated = false;
+  size_t used = 0;
+  const char* p = format;
+  while (*p != '\0') {
+    if (*p != '%') {
+      ++p;
+      continue;
+    }
+    FormatSpec spec = ParseFormatSpec(p);
+    p = spec.end;
+    if (spec.conversion == '%') { continue; }
+    if (spec.conversion == '\0') { break; }
+    if (record.num_args + spec.num_stars + 1 > static_cast<int>(kMaxArgs)) {
+      record.truncated = true;
+      return;
+    }
+    for (int i = 0; i < spec.num_stars; ++i) {
+      record.args[record.num_args++].integer = va_arg(args, int);
+    }
+
+    LogArg& arg = record.args[record.num_args++];
+    const char c = spec.conversion;
+    const bool is_long_long = spec.length == 'q' ||
+                              (spec.length == 'l' && spec.modifier[1] == 'l');
+    const bool is_char = spec.length == 'h' && spec.modifier[1] == 'h';
+    if (IsSignedConversion(c)) {
+      if (is_long_long) {
+        arg.integer = va_arg(args, long long);
+      } else if (spec.length == 'l') {
+        arg.integer = va_arg(args, long);
+      } else if (spec.length == 'j') {
+        arg.integer = va_arg(args, intmax_t);
+      } else if (spec.length == 'z') {
+        arg.integer = static_cast<int64_t>(va_arg(args, size_t));
+      } else if (spec.length == 't') {
+        arg.integer = va_arg(args, ptrdiff_t);
+      } else if (is_char) {
+        arg.integer = static_cast<signed char>(va_arg(args, int));
+      } else if (spec.length == 'h') {
+        arg.integer = static_cast<int16_t>(va_arg(args, int));
+      } else {
+        arg.integer = va_arg(args, int);
+      }
+    } else if (IsUnsignedConversion(c)) {
+      if (is_long_long) {
+        arg.unsigned_integer = va_arg(args, unsigned long long);
+      } else if (spec.length == 'l') {
+        arg.unsigned_integer = va_arg(args, unsigned long);
+      } else if (spec.length == 'j') {
+        arg.unsigned_integer = va_arg(args, uintmax_t);
+      } else if (spec.length == 'z') {
+        arg.unsigned_integer = va_arg(args, size_t);
+      } else if (spec.length == 't') {
+        arg.unsigned_integer = static_cast<uint64_t>(va_arg(args, ptrdiff_t));
+      } else if (is_char) {
+        arg.unsigned_integer = static_cast<uint8_t>(va_arg(args, unsigned int));
+      } else if (spec.length == 'h') {
+        arg.unsigned_integer =
+            static_cast<uint16_t>(va_arg(args, unsigned int));
+      } else {
+        arg.unsigned_integer = va_arg(args, unsigned int);
+      }
+    } else if (IsFloatingConversion(c)) {
+      if (spec.length == 'L') {
+        arg.real = static_cast<double>(va_arg(args, long double));
+      } else {
+        arg.real = va_arg(args, double);
+      }
+    } else if (c == 'c') {
+      arg.integer = va_arg(args, int);
+    } else if (c == 's') {
+      const char* string = va_arg(args, const char*);
+      if (string == nullptr) { string = "(null)"; }
+      size_t room = kStringCapacity - used;
+      size_t length = strnlen(string, room);
+      if (length == room) {
+        record.truncated = true;
+        if (room == 0) {
+          arg.integer = kStringCapacity;
+          continue;
         }
-        else if (level == LogLevel::Error)
-            std::cout << "\033[1;31m[RPL4 Error] " << message << "\033[m" << std::endl;
-        else if (level == LogLevel::Warning)
-            std::cout << "\033[33m[RPL4 Warning] " << message << "\033[m" << std::endl;
-        else if (level == LogLevel::Info)
-            std::cout << "\033[34m[RPL4 Info] " << message << "\033[m" << std::endl;
-        else if (level == LogLevel::Debug)
-            std::cout << "[RPL4 Debug] " << message << std::endl;
+        --length;
+      }
+      std::memcpy(record.strings + used, string, length);
+      record.strings[used + length] = '\0';
+      arg.integer = static_cast<int64_t>(used);
+      used += length + 1;
+    } else if (c == 'p' || c == 'n') {
+      // The target of %n is not written.
+      arg.pointer = va_arg(args, void*);
+    } else {
+      // Unknown conversion. Its argument cannot be read safely.
+      --record.num_args;
+      record.truncated = true;
+      return;
     }
-#else
-    (void) format;  // Suppress unused variable warning
-    if (level == LogLevel::Fatal) {
-        std::cout << "[RPL4] Fatal Error occured. Program will terminate..." << std::endl;
-        exit(-1);
+  }
+}
+
+// Formats record into buffer the way vsnprintf() would have formatted the
+// original arguments.
+void FormatRecord(const Record& record, char* buffer, size_t size) {
+  size_t out = 0;
+  size_t next_arg = 0;
+  const char* p = record.format;
+  while (*p != '\0' && out + 1 < size) {
+    if (*p != '%') {
+      buffer[out++] = *p++;
+      continue;
+    }
+    FormatSpec spec = ParseFormatSpec(p);
+    p = spec.end;
+    if (spec.conversion == '%') {
+      buffer[out++] = '%';
+      continue;
+    }
+    if (spec.conversion == '\0') { break; }
+    if (next_arg + spec.num_stars + 1 > record.num_args) {
+      out += std::snprintf(buffer + out, size - out, "[truncated]");
+      break;
+    }
+
+    // Rebuild the spec with the '*' replaced by their values and with a
+    // length modifier that matches the type the argument was stored as.
+    char spec_text[64];
+    size_t spec_length = 0;
+    for (const char* c = spec.begin; c < spec.modifier; ++c) {
+      if (spec_length + 12 >= sizeof(spec_text)) { break; }
+      if (*c == '*') {
+        spec_length += std::snprintf(
+            spec_text + spec_length, sizeof(spec_text) - spec_length, "%d",
+            static_cast<int>(record.args[next_arg++].integer));
+      } else {
+        spec_text[spec_length++] = *c;
+      }
+    }
+    const char c = spec.conversion;
+    if (IsSignedConversion(c) || IsUnsignedConversion(c)) {
+      spec_text[spec_length++] = 'l';
+      spec_text[spec_length++] = 'l';
+    }
+    spec_text[spec_length++] = c;
+    spec_text[spec_length] = '\0';
+
+    const LogArg& arg = record.args[next_arg++];
+    int written = 0;
+    if (IsSignedConversion(c)) {
+      written = std::snprintf(buffer + out, size - out, spec_text,
+                              static_cast<long long>(arg.integer));
+    } else if (IsUnsignedConversion(c)) {
+      written =
+          std::snprintf(buffer + out, size - out, spec_text,
+                        static_cast<unsigned long long>(arg.unsigned_integer));
+    } else if (IsFloatingConversion(c)) {
+      written = std::snprintf(buffer + out, size - out, spec_text, arg.real);
+    } else if (c == 'c') {
+      written = std::snprintf(buffer + out, size - out, spec_text,
+                              static_cast<int>(arg.integer));
+    } else if (c == 's') {
+      written = std::snprintf(buffer + out, size - out, spec_text,
+                              record.strings + arg.integer);
+    } else if (c == 'p') {
+      written = std::snprintf(buffer + out, size - out, spec_text, arg.pointer);
+    }
+    if (written > 0) { out += static_cast<size_t>(written); }
+  }
+  if (out >= size) { out = size - 1; }
+  buffer[out] = '\0';
+}
+
+void WriteMessage(LogLevel level, const char* message, bool flush) {
+  if (level == LogLevel::Fatal) {
+    std::cout << "\033[1;35m[RPL4 Fatal] " << message << "\033[m" << std::endl;
+    std::cout << "\033[1;35m  **Program will terminate...\033[m" << std::endl;
+    exit(-1);
+  } else if (level == LogLevel::Error) {
+    std::cout << "\033[1;31m[RPL4 Error] " << message << "\033[m";
+  } else if (level == LogLevel::Warning) {
+    std::cout << "\033[33m[RPL4 Warning] " << message << "\033[m";
+  } else if (level == LogLevel::Info) {
+    std::cout << "\033[34m[RPL4 Info] " << message << "\033[m";
+  } else if (level == LogLevel::Debug) {
+    std::cout << "[RPL4 Debug] " << message;
+  }
+  if (flush) {
+    std::cout << std::endl;
+  } else {
+    std::cout << '\n';
+  }
+}
+
+/**
+ * @brief Backend of the asynchronous mode.
+ * @details The records are kept in a bounded multi-producer single-consumer
+ *          ring. Each slot has a sequence number that tells whether it is
+ *          free for the producer of a position or filled for the consumer, so
+ *          a push is one compare-and-swap on the write position plus the copy
+ *          of the record, and never waits for the consumer.
+ */
+class AsyncLogger {
+ public:
+  AsyncLogger() {
+    for (size_t i = 0; i < kCapacity; ++i) {
+      records_[i].sequence.store(i, std::memory_order_relaxed);
+      records_[i].strings[kStringCapacity] = '\0';
+    }
+  }
+
+  ~AsyncLogger() { Stop(); }
+
+  inline bool IsRunning() const {
+    return running_.load(std::memory_order_acquire);
+  }
+
+  // Returns false without touching args if the logger is not running, so
+  // that the message is written synchronously instead.
+  bool Push(LogLevel level, const char* format, va_list args) {
+    // Announced before running_ is checked, so Stop() either sees this push
+    // in pushing_ or the push sees running_ cleared.
+    pushing_.fetch_add(1, std::memory_order_seq_cst);
+    if (!running_.load(std::memory_order_seq_cst)) {
+      pushing_.fetch_sub(1, std::memory_order_release);
+      return false;
+    }
+    PushRecord(level, format, args);
+    pushing_.fetch_sub(1, std::memory_order_release);
+    return true;
+  }
+
+  void Start() {
+    std::lock_guard<std::mutex> mode_lock(mode_mutex_);
+    if (IsRunning()) { return; }
+    stop_requested_ = false;
+    thread_ = std::thread(&AsyncLogger::Run, this);
+    running_.store(true, std::memory_order_release);
+  }
+
+  void Stop() {
+    std::lock_guard<std::mutex> mode_lock(mode_mutex_);
+    if (!IsRunning()) { return; }
+    // New messages are written synchronously from here on.
+    running_.store(false, std::memory_order_seq_cst);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_requested_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+    // Callers that saw the running flag just before it was cleared may still
+    // be claiming or filling their slots. Drain() stops at the first slot
+    // that is not filled, so the records are written once all of them are
+    // published, before any message is written synchronously after Stop().
+    while (pushing_.load(std::memory_order_acquire) != 0) {
+      std::this_thread::yield();
+    }
+    Drain();
+  }
+
+  void Flush() {
+    if (!IsRunning()) { return; }
+    const size_t target = write_position_.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(mutex_);
+    wake_.notify_one();
+    while (read_position_.load(std::memory_order_acquire) < target &&
+           !stop_requested_) {
+      drained_.wait_for(lock, kPollInterval);
+    }
+  }
+
+  LogStats GetStats() const {
+    LogStats stats;
+    stats.queued = queued_.load(std::memory_order_relaxed);
+    stats.written = written_.load(std::memory_order_relaxed);
+    stats.dropped = dropped_.load(std::memory_order_relaxed);
+    stats.truncated = truncated_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+ private:
+  static constexpr size_t kCapacity = 1024;  // Must be a power of two
+  static constexpr size_t kMessageSize = 256;
+  // The producers never wake the consumer, so that a push stays free of
+  // system calls. The consumer polls at this interval while the ring is empty.
+  static constexpr std::chrono::milliseconds kPollInterval{10};
+
+  void PushRecord(LogLevel level, const char* format, va_list args) {
+    size_t position = write_position_.load(std::memory_order_relaxed);
+    Record* record;
+    while (true) {
+      record = &records_[position & (kCapacity - 1)];
+      size_t sequence = record->sequence.load(std::memory_order_acquire);
+      intptr_t diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+      if (diff == 0) {
+        if (write_position_.compare_exchange_weak(
+                position, position + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // The consumer has not freed this slot yet: the ring is full.
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+      } else {
+        position = write_position_.load(std::memory_order_relaxed);
+      }
+    }
+
+    record->level = level;
+    record->format = format;
+    EncodeRecord(*record, format, args);
+    if (record->truncated) {
+      truncated_.fetch_add(1, std::memory_order_relaxed);
+    }
+    record->sequence.store(position + 1, std::memory_order_release);
+    queued_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_requested_) {
+      lock.unlock();
+      size_t count = Drain();
+      lock.lock();
+      if (count > 0) {
+        drained_.notify_all();
+      } else {
+        wake_.wait_for(lock, kPollInterval);
+      }
+    }
+    lock.unlock();
+    Drain();
+    drained_.notify_all();
+  }
+
+  // Writes the records that are ready. Only one thread at a time calls this.
+  size_t Drain() {
+    char message[kMessageSize];
+    size_t count = 0;
+    size_t position = read_position_.load(std::memory_order_relaxed);
+    while (true) {
+      Record& record = records_[position & (kCapacity - 1)];
+      if (record.sequence.load(std::memory_order_acquire) != position + 1) {
+        break;
+      }
+      FormatRecord(record, message, sizeof(message));
+      WriteMessage(record.level, message, false);
+      record.sequence.store(position + kCapacity, std::memory_order_release);
+      read_position_.store(++position, std::memory_order_release);
+      ++count;
+    }
+    if (count > 0) {
+      std::cout.flush();
+      written_.fetch_add(count, std::memory_order_relaxed);
+    }
+    return count;
+  }
+
+  Record records_[kCapacity];
+  alignas(64) std::atomic<size_t> write_position_{0};
+  alignas(64) std::atomic<size_t> read_position_{0};
+
+  std::atomic<uint64_t> queued_{0};
+  std::atomic<uint64_t> written_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<uint64_t> truncated_{0};
+
+  std::atomic<bool> running_{false};
+  std::atomic<size_t> pushing_{0};  // Push() calls past the running_ check
+  std::mutex mode_mutex_;  // Serializes Start() and Stop()
+  std::mutex mutex_;       // Guards stop_requested_, used by the conditions
+  std::condition_variable wake_;
+  std::condition_variable drained_;
+  bool stop_requested_ = false;
+  std::thread thread_;
+};
+
+AsyncLogger async_logger;
+
+}  // namespace
+
+void Log(LogLevel level, const char* format, ...) {
+#ifdef RPL4_LOG_LEVEL
+  if (level <= RPL4_LOG_LEVEL) {
+    va_list args;
+    va_start(args, format);
+    if (level != LogLevel::Fatal && async_logger.IsRunning() &&
+        async_logger.Push(level, format, args)) {
+      va_end(args);
+      return;
     }
+    // The queued messages come before the fatal one.
+    if (level == LogLevel::Fatal) { async_logger.Flush(); }
+
+    char buffer[256];
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    WriteMessage(level, buffer, true);
+  }
+#else
+  (void)format;  // Suppress unused variable warning
+  if (level == LogLevel::Fatal) {
+    std::cout << "[RPL4] Fatal Error occured. Program will terminate..."
+              << std::endl;
+    exit(-1);
+  }
 #endif
-    
 }
 
-}
\ No newline at end of file
+void SetLogMode(LogMode mode) {
+  if (mode == LogMode::kAsynchronous) {
+    async_logger.Start();
+  } else {
+    async_logger.Stop();
+  }
+}
+
+LogMode GetLogMode() {
+  return async_logger.IsRunning() ? LogMode::kAsynchronous
+                                  : LogMode::kSynchronous;
+}
+
+void FlushLog() { async_logger.Flush(); }
+
+LogStats GetLogStats() { return async_logger.GetStats(); }
+
+}  // namespace rpl
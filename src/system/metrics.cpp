@@ -0,0 +1,186 @@
+#include "rpl4/system/metrics.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+
+namespace rpl {
+
+std::atomic<PeripheralMetrics*> Metrics::head_{nullptr};
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value) {
+  if (value < kSubBuckets) { return static_cast<size_t>(value); }
+  uint32_t msb = 63 - static_cast<uint32_t>(__builtin_clzll(value));
+  if (msb >= kMaxBits) { return kNumOfBuckets - 1; }
+  uint32_t shift = msb - kSubBucketBits;
+  uint32_t sub_bucket =
+      static_cast<uint32_t>(value >> shift) & (kSubBuckets - 1);
+  return (shift + 1) * kSubBuckets + sub_bucket;
+}
+
+uint64_t LatencyHistogram::GetBucketUpperBound(size_t index) {
+  if (index < kSubBuckets) { return index; }
+  uint32_t shift = static_cast<uint32_t>(index / kSubBuckets) - 1;
+  uint64_t lower = static_cast<uint64_t>(kSubBuckets + index % kSubBuckets)
+                   << shift;
+  return lower + (uint64_t{1} << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+  counts_[GetBucketIndex(value)].Add();
+  count_.Add();
+  sum_.Add(value);
+  if (value < min_.load(std::memory_order_relaxed)) {
+    min_.store(value, std::memory_order_relaxed);
+  }
+  if (value > max_.load(std::memory_order_relaxed)) {
+    max_.store(value, std::memory_order_relaxed);
+  }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::GetSnapshot() const {
+  Snapshot snapshot;
+  for (size_t i = 0; i < kNumOfBuckets; ++i) {
+    snapshot.counts[i] = counts_[i].Get();
+  }
+  snapshot.count = count_.Get();
+  snapshot.sum = sum_.Get();
+  snapshot.max = max_.load(std::memory_order_relaxed);
+  snapshot.min = snapshot.count > 0 ? min_.load(std::memory_order_relaxed) : 0;
+  return snapshot;
+}
+
+void LatencyHistogram::Reset() {
+  for (MetricsCounter& counter : counts_) { counter.Reset(); }
+  count_.Reset();
+  sum_.Reset();
+  min_.store(UINT64_MAX, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Snapshot::GetQuantile(double quantile) const {
+  // The buckets are read one by one while the drivers keep recording, so
+  // their sum is used instead of count.
+  uint64_t total = 0;
+  for (uint64_t bucket : counts) { total += bucket; }
+  if (total == 0) { return 0; }
+  quantile = std::min(std::max(quantile, 0.0), 1.0);
+  uint64_t rank = static_cast<uint64_t>(quantile * total + 0.5);
+  if (rank == 0) { rank = 1; }
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kNumOfBuckets; ++i) {
+    seen += counts[i];
+    if (seen >= rank) { return std::min(GetBucketUpperBound(i), max); }
+  }
+  return max;
+}
+
+PeripheralMetrics::PeripheralMetrics(const char* peripheral,
+                                     uint32_t instance, bool has_latency)
+    : peripheral_(peripheral),
+      instance_(instance),
+      latency_(has_latency ? new LatencyHistogram() : nullptr) {
+  Metrics::Register(this);
+}
+
+void PeripheralMetrics::Reset() {
+  operations_.Reset();
+  bytes_.Reset();
+  errors_.Reset();
+  timeouts_.Reset();
+  underflows_.Reset();
+  if (latency_ != nullptr) { latency_->Reset(); }
+}
+
+void Metrics::Register(PeripheralMetrics* metrics) {
+  PeripheralMetrics* head = head_.load(std::memory_order_relaxed);
+  do {
+    metrics->next_ = head;
+  } while (!head_.compare_exchange_weak(head, metrics,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed));
+}
+
+std::vector<Metrics::PeripheralSnapshot> Metrics::Snapshot() {
+  std::vector<PeripheralSnapshot> snapshots;
+  for (const PeripheralMetrics* m = head_.load(std::memory_order_acquire);
+       m != nullptr; m = m->next_) {
+    PeripheralSnapshot snapshot;
+    snapshot.peripheral = m->peripheral_;
+    snapshot.instance = m->instance_;
+    snapshot.operations = m->operations_.Get();
+    snapshot.bytes = m->bytes_.Get();
+    snapshot.errors = m->errors_.Get();
+    snapshot.timeouts = m->timeouts_.Get();
+    snapshot.underflows = m->underflows_.Get();
+    snapshot.has_latency = m->latency_ != nullptr;
+    if (snapshot.has_latency) { snapshot.latency = m->latency_->GetSnapshot(); }
+    snapshots.push_back(snapshot);
+  }
+  // The list is built by pushing to the front.
+  std::reverse(snapshots.begin(), snapshots.end());
+  return snapshots;
+}
+
+void Metrics::Reset() {
+  for (PeripheralMetrics* m = head_.load(std::memory_order_acquire);
+       m != nullptr; m = m->next_) {
+    m->Reset();
+  }
+}
+
+void Metrics::WriteText(FILE* stream) {
+  std::vector<PeripheralSnapshot> snapshots = Snapshot();
+
+  struct CounterInfo {
+    const char* name;
+    const char* help;
+    uint64_t PeripheralSnapshot::*value;
+  };
+  static constexpr CounterInfo kCounters[] = {
+      {"rpl4_operations_total",
+       "Transfers, DMA starts, FIFO writes and pin accesses.",
+       &PeripheralSnapshot::operations},
+      {"rpl4_bytes_total", "Bytes moved.", &PeripheralSnapshot::bytes},
+      {"rpl4_errors_total", "Errors reported by the peripheral.",
+       &PeripheralSnapshot::errors},
+      {"rpl4_timeouts_total", "Waits that timed out.",
+       &PeripheralSnapshot::timeouts},
+      {"rpl4_underflows_total", "FIFO underflows.",
+       &PeripheralSnapshot::underflows},
+  };
+  for (const CounterInfo& counter : kCounters) {
+    std::fprintf(stream, "# HELP %s %s\n# TYPE %s counter\n", counter.name,
+                 counter.help, counter.name);
+    for (const PeripheralSnapshot& s : snapshots) {
+      std::fprintf(stream,
+                   "%s{peripheral=\"%s\",instance=\"%" PRIu32 "\"} %" PRIu64
+                   "\n",
+                   counter.name, s.peripheral, s.instance, s.*counter.value);
+    }
+  }
+
+  static constexpr double kQuantiles[] = {0.5, 0.9, 0.99, 0.999, 1.0};
+  std::fprintf(stream,
+               "# HELP rpl4_latency_ns Latency of blocking transfers and DMA "
+               "transfers.\n# TYPE rpl4_latency_ns summary\n");
+  for (const PeripheralSnapshot& s : snapshots) {
+    if (!s.has_latency) { continue; }
+    for (double quantile : kQuantiles) {
+      std::fprintf(stream,
+                   "rpl4_latency_ns{peripheral=\"%s\",instance=\"%" PRIu32
+                   "\",quantile=\"%g\"} %" PRIu64 "\n",
+                   s.peripheral, s.instance, quantile,
+                   s.latency.GetQuantile(quantile));
+    }
+    std::fprintf(stream,
+                 "rpl4_latency_ns_sum{peripheral=\"%s\",instance=\"%" PRIu32
+                 "\"} %" PRIu64 "\n",
+                 s.peripheral, s.instance, s.latency.sum);
+    std::fprintf(stream,
+                 "rpl4_latency_ns_count{peripheral=\"%s\",instance=\"%" PRIu32
+                 "\"} %" PRIu64 "\n",
+                 s.peripheral, s.instance, s.latency.count);
+  }
+}
+
+}  // namespace rpl
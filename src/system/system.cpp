@@ -36,6 +36,10 @@ DmaRegisterMap*  REG_DMA12;
 DmaRegisterMap*  REG_DMA13;
 DmaRegisterMap*  REG_DMA14;
 DmaEnableRegisterMap* REG_DMA_ENABLE;
+Dma4RegisterMap* REG_DMA4_CHANNEL11;
+Dma4RegisterMap* REG_DMA4_CHANNEL12;
+Dma4RegisterMap* REG_DMA4_CHANNEL13;
+Dma4RegisterMap* REG_DMA4_CHANNEL14;
 GpioRegisterMap* REG_GPIO;
 PwmRegisterMap*  REG_PWM0;
 PwmRegisterMap*  REG_PWM1;
@@ -56,9 +60,9 @@ UART_AUX_Typedef*  REG_UART1;
 bool IsAvailable(void){
     std::ifstream file("/proc/cpuinfo");
     if (!file) {
-      Log(LogLevel::Warning,
-          "Failed to open /proc/cpuinfo. "
-          "Cannot determine if this is a Raspberry Pi system.");
+      RPL4_LOG(LogLevel::Warning,
+               "Failed to open /proc/cpuinfo. "
+               "Cannot determine if this is a Raspberry Pi system.");
       return false;
     }
   
@@ -69,9 +73,9 @@ bool IsAvailable(void){
         return true;
       }
     }
-    Log(LogLevel::Warning,
-        "This system does not appear to be a Raspberry Pi. "
-        "RPL4 may not work as expected.");
+    RPL4_LOG(LogLevel::Warning,
+             "This system does not appear to be a Raspberry Pi. "
+             "RPL4 may not work as expected.");
     return false;
 }
 
@@ -79,19 +83,24 @@ bool IsInitialized(void){
     return system_initialized;
 }
 
-uint8_t Init(void){
-	int fd;
-	if ((fd = open("/dev/mem", O_RDWR|O_SYNC)) < 0) {
-        Log(LogLevel::Fatal, "Can't open /dev/mem. Root privileges required.");
-        return -1;
+// Maps a peripheral region. With fd < 0 the region is backed by zeroed
+// normal memory instead of the device.
+static uint32_t* MapRegion(int fd, uint32_t base, uint32_t size) {
+    void* region;
+    if (fd < 0) {
+        region = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    } else {
+        region = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, base);
     }
+    return reinterpret_cast<uint32_t*>(region);
+}
 
+static uint8_t MapRegisters(int fd){
     constexpr static uint32_t region0_base = 0xfe007000;
     constexpr static uint32_t region0_size = 0x1000;
-    uint32_t* region0 = reinterpret_cast<uint32_t*>(mmap(NULL, region0_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, region0_base));
+    uint32_t* region0 = MapRegion(fd, region0_base, region0_size);
     if (region0 == MAP_FAILED) {
-        Log(LogLevel::Fatal, "mmap failed for region0.");
-        close(fd);
+        RPL4_LOG(LogLevel::Fatal, "mmap failed for region0.");
         return -1;
     }
     REG_DMA0 = reinterpret_cast<DmaRegisterMap*>(region0 + (kDma0AddressBase - region0_base) / 4);
@@ -109,23 +118,25 @@ uint8_t Init(void){
     REG_DMA12 = reinterpret_cast<DmaRegisterMap*>(region0 + (kDma12AddressBase - region0_base) / 4);
     REG_DMA13 = reinterpret_cast<DmaRegisterMap*>(region0 + (kDma13AddressBase - region0_base) / 4);
     REG_DMA_ENABLE = reinterpret_cast<DmaEnableRegisterMap*>(region0 + (kDmaEnableAddressBase - region0_base) / 4);
+    REG_DMA4_CHANNEL11 = reinterpret_cast<Dma4RegisterMap*>(region0 + (kDma4Channel11AddressBase - region0_base) / 4);
+    REG_DMA4_CHANNEL12 = reinterpret_cast<Dma4RegisterMap*>(region0 + (kDma4Channel12AddressBase - region0_base) / 4);
+    REG_DMA4_CHANNEL13 = reinterpret_cast<Dma4RegisterMap*>(region0 + (kDma4Channel13AddressBase - region0_base) / 4);
+    REG_DMA4_CHANNEL14 = reinterpret_cast<Dma4RegisterMap*>(region0 + (kDma4Channel14AddressBase - region0_base) / 4);
 
     constexpr static uint32_t region1_base = 0xfe101000;
     constexpr static uint32_t region1_size = 0x1000;
-    uint32_t* region1 = reinterpret_cast<uint32_t*>(mmap(NULL, region1_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, region1_base));
+    uint32_t* region1 = MapRegion(fd, region1_base, region1_size);
     if (region1 == MAP_FAILED) {
-        Log(LogLevel::Fatal, "mmap failed for region1.");
-        close(fd);
+        RPL4_LOG(LogLevel::Fatal, "mmap failed for region1.");
         return -1;
     }
     REG_CLK = reinterpret_cast<ClockRegisterMap*>(region1 + (kClockAddressBase - region1_base) / 4);
 
     constexpr static uint32_t region2_base = 0xfe200000;
     constexpr static uint32_t region2_size = 0x2000;
-    uint32_t* region2 = reinterpret_cast<uint32_t*>(mmap(NULL, region2_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, region2_base));
+    uint32_t* region2 = MapRegion(fd, region2_base, region2_size);
     if (region2 == MAP_FAILED) {
-        Log(LogLevel::Fatal, "mmap failed for region2.");
-        close(fd);
+        RPL4_LOG(LogLevel::Fatal, "mmap failed for region2.");
         return -1;
     }
     REG_GPIO = reinterpret_cast<GpioRegisterMap*>(region2 + (kGpioAddressBase - region2_base) / 4);
@@ -137,10 +148,9 @@ uint8_t Init(void){
 
     constexpr static uint32_t region3_base = 0xfe204000;
     constexpr static uint32_t region3_size = 0x2000;
-    uint32_t* region3 = reinterpret_cast<uint32_t*>(mmap(NULL, region3_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, region3_base));
+    uint32_t* region3 = MapRegion(fd, region3_base, region3_size);
     if (region3 == MAP_FAILED) {
-        Log(LogLevel::Fatal, "mmap failed for region3.");
-        close(fd);
+        RPL4_LOG(LogLevel::Fatal, "mmap failed for region3.");
         return -1;
     }
     REG_SPI0 = reinterpret_cast<SpiRegisterMap*>(region3 + (kSpi0AddressBase - region3_base) / 4);
@@ -156,10 +166,9 @@ uint8_t Init(void){
 
     constexpr static uint32_t region4_base = 0xfe20c000;
     constexpr static uint32_t region4_size = 0x1000;
-    uint32_t* region4 = reinterpret_cast<uint32_t*>(mmap(NULL, region4_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, region4_base));
+    uint32_t* region4 = MapRegion(fd, region4_base, region4_size);
     if (region4 == MAP_FAILED) {
-        Log(LogLevel::Fatal, "mmap failed for region4.");
-        close(fd);
+        RPL4_LOG(LogLevel::Fatal, "mmap failed for region4.");
         return -1;
     }
     REG_PWM0 = reinterpret_cast<PwmRegisterMap*>(region4 + (kPwm0AddressBase - region4_base) / 4);
@@ -167,10 +176,9 @@ uint8_t Init(void){
 
     constexpr static uint32_t region5_base = 0xfe215000;
     constexpr static uint32_t region5_size = 0x1000;
-    uint32_t* region5 = reinterpret_cast<uint32_t*>(mmap(NULL, region5_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, region5_base));
+    uint32_t* region5 = MapRegion(fd, region5_base, region5_size);
     if (region5 == MAP_FAILED) {
-        Log(LogLevel::Fatal, "mmap failed for region5.");
-        close(fd);
+        RPL4_LOG(LogLevel::Fatal, "mmap failed for region5.");
         return -1;
     }
     REG_AUX = reinterpret_cast<AuxRegisterMap*>(region5 + (kAuxAddressBase - region5_base) / 4);
@@ -179,27 +187,41 @@ uint8_t Init(void){
 
     constexpr static uint32_t region6_base = 0xfe804000;
     constexpr static uint32_t region6_size = 0x1000;
-    uint32_t* region6 = reinterpret_cast<uint32_t*>(mmap(NULL, region6_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, region6_base));
+    uint32_t* region6 = MapRegion(fd, region6_base, region6_size);
     if (region6 == MAP_FAILED) {
-        Log(LogLevel::Fatal, "mmap failed for region6.");
-        close(fd);
+        RPL4_LOG(LogLevel::Fatal, "mmap failed for region6.");
         return -1;
     }
     REG_BSC1 = reinterpret_cast<BSC_Typedef*>(region6 + (BSC1_BASE - region6_base) / 4);
 
     constexpr static uint32_t region7_base = 0xfee05000;
     constexpr static uint32_t region7_size = 0x1000;
-    uint32_t* region7 = reinterpret_cast<uint32_t*>(mmap(NULL, region7_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, region7_base));
+    uint32_t* region7 = MapRegion(fd, region7_base, region7_size);
     if (region7 == MAP_FAILED) {
-        Log(LogLevel::Fatal, "mmap failed for region7.");
-        close(fd);
+        RPL4_LOG(LogLevel::Fatal, "mmap failed for region7.");
         return -1;
     }
     REG_DMA14 = reinterpret_cast<DmaRegisterMap*>(region7 + (kDma14AddressBase - region7_base) / 4);
 
     system_initialized = true;
-    close(fd);
 	return 0;
 }
 
+uint8_t Init(void){
+	int fd;
+	if ((fd = open("/dev/mem", O_RDWR|O_SYNC)) < 0) {
+        RPL4_LOG(LogLevel::Fatal, "Can't open /dev/mem. Root privileges required.");
+        return -1;
+    }
+    uint8_t result = MapRegisters(fd);
+    close(fd);
+    return result;
+}
+
+uint8_t InitWithMemoryBackedRegisters(void){
+    RPL4_LOG(LogLevel::Warning,
+             "Registers are backed by normal memory. No peripheral will be driven.");
+    return MapRegisters(-1);
+}
+
 }
\ No newline at end of file
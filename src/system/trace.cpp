@@ -0,0 +1,112 @@
+#include "rpl4/system/trace.hpp"
+
+#include <atomic>
+#include <cinttypes>
+
+namespace rpl {
+
+namespace {
+
+struct AtomicCounters {
+  std::atomic<uint64_t> reads{0};
+  std::atomic<uint64_t> writes{0};
+  std::atomic<uint64_t> waits{0};
+  std::atomic<uint64_t> spins{0};
+  std::atomic<int64_t> wait_time_ns{0};
+};
+
+std::array<AtomicCounters, Trace::kNumOfPeripherals> counters;
+
+#ifdef RPL4_TRACE
+std::atomic<bool> dump_at_exit{true};
+#else
+std::atomic<bool> dump_at_exit{false};
+#endif
+
+// Prints the counters when static objects are destroyed at exit.
+struct ExitDumper {
+  ~ExitDumper() {
+    if (dump_at_exit.load(std::memory_order_relaxed)) { Trace::Dump(); }
+  }
+} exit_dumper;
+
+}  // namespace
+
+#ifdef RPL4_TRACE
+void Trace::CountRead(Peripheral peripheral, uint32_t count) {
+  counters[static_cast<size_t>(peripheral)].reads.fetch_add(
+      count, std::memory_order_relaxed);
+}
+
+void Trace::CountWrite(Peripheral peripheral, uint32_t count) {
+  counters[static_cast<size_t>(peripheral)].writes.fetch_add(
+      count, std::memory_order_relaxed);
+}
+
+void Trace::AddWait(Peripheral peripheral, uint64_t spins,
+                    std::chrono::nanoseconds wait_time) {
+  AtomicCounters& counter = counters[static_cast<size_t>(peripheral)];
+  counter.waits.fetch_add(1, std::memory_order_relaxed);
+  counter.spins.fetch_add(spins, std::memory_order_relaxed);
+  counter.wait_time_ns.fetch_add(wait_time.count(), std::memory_order_relaxed);
+}
+#endif
+
+Trace::Snapshot Trace::GetSnapshot() {
+  Snapshot snapshot;
+  for (size_t i = 0; i < kNumOfPeripherals; ++i) {
+    snapshot[i].reads = counters[i].reads.load(std::memory_order_relaxed);
+    snapshot[i].writes = counters[i].writes.load(std::memory_order_relaxed);
+    snapshot[i].waits = counters[i].waits.load(std::memory_order_relaxed);
+    snapshot[i].spins = counters[i].spins.load(std::memory_order_relaxed);
+    snapshot[i].wait_time = std::chrono::nanoseconds(
+        counters[i].wait_time_ns.load(std::memory_order_relaxed));
+  }
+  return snapshot;
+}
+
+void Trace::Reset() {
+  for (AtomicCounters& counter : counters) {
+    counter.reads.store(0, std::memory_order_relaxed);
+    counter.writes.store(0, std::memory_order_relaxed);
+    counter.waits.store(0, std::memory_order_relaxed);
+    counter.spins.store(0, std::memory_order_relaxed);
+    counter.wait_time_ns.store(0, std::memory_order_relaxed);
+  }
+}
+
+void Trace::Dump(FILE* stream) {
+  Snapshot snapshot = GetSnapshot();
+  std::fprintf(stream, "[RPL4 Trace] %-8s %12s %12s %10s %12s %14s\n",
+               "periph", "reads", "writes", "waits", "spins", "wait[ns]");
+  for (size_t i = 0; i < kNumOfPeripherals; ++i) {
+    const Counters& c = snapshot[i];
+    if (c.reads == 0 && c.writes == 0 && c.waits == 0) { continue; }
+    std::fprintf(stream,
+                 "[RPL4 Trace] %-8s %12" PRIu64 " %12" PRIu64 " %10" PRIu64
+                 " %12" PRIu64 " %14" PRId64 "\n",
+                 GetPeripheralName(static_cast<Peripheral>(i)), c.reads,
+                 c.writes, c.waits, c.spins,
+                 static_cast<int64_t>(c.wait_time.count()));
+  }
+}
+
+void Trace::SetDumpAtExit(bool enable) {
+  dump_at_exit.store(enable, std::memory_order_relaxed);
+}
+
+const char* Trace::GetPeripheralName(Peripheral peripheral) {
+  switch (peripheral) {
+    case Peripheral::kSpi:
+      return "Spi";
+    case Peripheral::kAuxSpi:
+      return "AuxSpi";
+    case Peripheral::kDma:
+      return "Dma";
+    case Peripheral::kPwm:
+      return "Pwm";
+  }
+  return "Unknown";
+}
+
+}  // namespace rpl
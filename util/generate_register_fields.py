@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+"""Generate RegField definitions from the bitfield register maps.
+
+Usage: util/generate_register_fields.py [peripheral ...]
+
+For each peripheral, include/rpl4/registers/registers_<name>.hpp is parsed and
+include/rpl4/registers/fields_<name>.hpp is written. Without arguments all
+peripherals in PERIPHERALS are generated.
+"""
+
+import os
+import re
+import sys
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+REGISTERS_DIR = os.path.join(SCRIPT_DIR, "..", "include", "rpl4", "registers")
+
+# file name suffix, register map struct
+PERIPHERALS = [
+    ["spi", "SpiRegisterMap"],
+    ["dma", "DmaRegisterMap"],
+    ["dma4", "Dma4RegisterMap"],
+    ["pwm", "PwmRegisterMap"],
+]
+
+FIELD_PATTERN = re.compile(r"([A-Za-z_][\w:]*)\s+(\w+)\s*:\s*(\d+)\s*;")
+
+
+def strip_comments(text):
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    return re.sub(r"//[^\n]*", "", text)
+
+
+def find_block(text, start):
+    """Return the text between the brace at start and its closing brace."""
+    depth = 0
+    for i in range(start, len(text)):
+        if text[i] == "{":
+            depth += 1
+        elif text[i] == "}":
+            depth -= 1
+            if depth == 0:
+                return text[start + 1 : i]
+    raise ValueError("Unbalanced braces")
+
+
+def remove_nested_blocks(text):
+    """Remove enum bodies and other nested blocks of a register struct."""
+    result = ""
+    depth = 0
+    for c in text:
+        if c == "{":
+            depth += 1
+        elif c == "}":
+            depth -= 1
+        elif depth == 0:
+            result += c
+    return result
+
+
+def parse_registers(text, map_name):
+    """Return [[register, [[type, name, offset, width], ...]], ...]."""
+    text = strip_comments(text)
+    match = re.search(r"struct\s+" + map_name + r"\s*{", text)
+    if match is None:
+        raise ValueError(map_name + " not found")
+    body = find_block(text, match.end() - 1)
+
+    registers = []
+    for match in re.finditer(r"struct\s+(\w+)\s*{", body):
+        register = match.group(1)
+        fields = []
+        offset = 0
+        block = remove_nested_blocks(find_block(body, match.end() - 1))
+        for field in FIELD_PATTERN.finditer(block):
+            field_type, name = field.group(1), field.group(2)
+            width = int(field.group(3))
+            if not name.startswith("reserved"):
+                fields.append([field_type, name, offset, width])
+            offset += width
+        if offset > 32:
+            raise ValueError(register + " is wider than 32 bits")
+        if len(fields) != 0:
+            registers.append([register, fields])
+    return registers
+
+
+def to_constant_name(name):
+    return "k" + "".join(word.capitalize() for word in name.split("_"))
+
+
+def format_field(offset, width, field_type, name):
+    """Format one definition within 80 columns, as clang-format would."""
+    head = "    static constexpr RegField<Register, {}, {},".format(offset, width)
+    line = "{} {}> {}{{}};".format(head, field_type, name)
+    if len(line) <= 80:
+        return [line]
+    line = "{} {}>".format(head, field_type)
+    if len(line) <= 80:
+        return [line, "        " + name + "{};"]
+    indent = " " * len("    static constexpr RegField<")
+    return [head, indent + field_type + ">", "        " + name + "{};"]
+
+
+def generate(suffix, map_name):
+    source = "registers_" + suffix + ".hpp"
+    with open(os.path.join(REGISTERS_DIR, source)) as f:
+        registers = parse_registers(f.read(), map_name)
+
+    guard = "RPL4_REGISTERS_FIELDS_" + suffix.upper() + "_HPP_"
+    fields_name = map_name.replace("RegisterMap", "Fields")
+    lines = [
+        "// Generated by util/generate_register_fields.py from " + source + ".",
+        "// Do not edit by hand.",
+        "",
+        "#ifndef " + guard,
+        "#define " + guard,
+        "",
+        '#include "rpl4/registers/register_field.hpp"',
+        '#include "rpl4/registers/' + source + '"',
+        "",
+        "namespace rpl {",
+        "",
+        "struct " + fields_name + " {",
+    ]
+    for index, (register, fields) in enumerate(registers):
+        if index != 0:
+            lines.append("")
+        lines.append("  struct " + register + " {")
+        lines.append("    using Register = " + map_name + "::" + register + ";")
+        for field_type, name, offset, width in fields:
+            if field_type != "uint32_t":
+                field_type = "Register::" + field_type
+            lines += format_field(offset, width, field_type, to_constant_name(name))
+        lines.append("  };")
+    lines += [
+        "};",
+        "",
+        "}  // namespace rpl",
+        "",
+        "#endif  // " + guard,
+    ]
+
+    output = os.path.join(REGISTERS_DIR, "fields_" + suffix + ".hpp")
+    with open(output, "w") as f:
+        f.write("\n".join(lines) + "\n")
+    print("Generated " + os.path.relpath(output))
+
+
+if __name__ == "__main__":
+    targets = sys.argv[1:] if len(sys.argv) > 1 else [p[0] for p in PERIPHERALS]
+    for suffix, map_name in PERIPHERALS:
+        if suffix in targets:
+            generate(suffix, map_name)